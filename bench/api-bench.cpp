@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <deque>
+
+#if defined(Q_WS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <QApplication>
+#include <QStringList>
+#include <QByteArray>
+#include <QTemporaryFile>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+
+#include <jansson.h>
+
+#include "api/requests.h"
+#include "api/api-stats.h"
+#include "api/server-repo.h"
+#include "api/file-uploader.h"
+#include "api/file-downloader.h"
+#include "ui/repo-item.h"
+#include "ui/repo-search-index.h"
+#include "fake-seahub-server.h"
+#include "api-bench.h"
+
+namespace {
+
+const int kDefaultIterations = 5;
+const char *kBenchRepoId = "00000000-0000-4000-8000-000000000000";
+// Every this many repos change between two lists in --items
+const int kChangedRepoInterval = 100;
+
+// in kB
+long peakRss()
+{
+#if defined(Q_WS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_WS_MAC)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+/**
+ * Parse the same body in memory, to tell the parse time apart from the
+ * network time
+ */
+qint64 parseOnlyUsecs(const QByteArray& body)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    json_error_t error;
+    json_t *root = json_loads(body.data(), 0, &error);
+    std::vector<ServerRepo> repos = ServerRepo::listFromJSON(root, &error);
+    json_decref(root);
+
+    return timer.nsecsElapsed() / 1000;
+}
+
+void usage()
+{
+    printf("Usage: seafile-api-bench [options]\n"
+           "  --repos N1,N2,...    repo list sizes (default 100,1000,10000,50000)\n"
+           "  --iterations N       requests per size (default %d)\n"
+           "  --latency MS         server side delay of every response\n"
+           "  --error-rate R       fraction of requests answered with 500\n"
+           "  --chunked            use chunked transfer encoding\n"
+           "  --no-gzip            never compress responses\n"
+           "  --upload MB          upload a file of this size instead of listing repos\n"
+           "  --download MB        download a file of this size instead of listing repos\n"
+           "  --parallel N         chunks uploaded, or connections downloading, at the\n"
+           "                       same time (default 1)\n"
+           "  --items              measure the repo items built from each list, and the\n"
+           "                       time to apply a list with 1%% of the repos changed\n",
+           kDefaultIterations);
+}
+
+} // namespace
+
+ApiBench::ApiBench(const Account& account)
+    : account_(account)
+{
+}
+
+ApiBench::Result ApiBench::listRepos()
+{
+    result_.ok = false;
+    result_.total_usecs = 0;
+    result_.repos = 0;
+
+    ListReposRequest req(account_);
+    connect(&req, SIGNAL(success(const std::vector<ServerRepo>&)),
+            this, SLOT(onSuccess(const std::vector<ServerRepo>&)));
+    connect(&req, SIGNAL(failed(int)), this, SLOT(onFailed(int)));
+
+    timer_.start();
+    req.send();
+    loop_.exec();
+
+    return result_;
+}
+
+ApiBench::Result ApiBench::uploadFile(const QString& path, int parallel_chunks)
+{
+    result_.ok = false;
+    result_.total_usecs = 0;
+    result_.repos = 0;
+
+    FileUploader uploader(account_, kBenchRepoId, "/", path);
+    uploader.setParallelChunks(parallel_chunks);
+    connect(&uploader, SIGNAL(finished()), this, SLOT(onTransferFinished()));
+    connect(&uploader, SIGNAL(failed(const QString&)),
+            this, SLOT(onTransferFailed(const QString&)));
+
+    timer_.start();
+    uploader.start();
+    loop_.exec();
+
+    return result_;
+}
+
+ApiBench::Result ApiBench::downloadFile(const QString& local_path, int connections)
+{
+    result_.ok = false;
+    result_.total_usecs = 0;
+    result_.repos = 0;
+
+    FileDownloader downloader(account_, kBenchRepoId,
+                              "/" + QFileInfo(local_path).fileName(), local_path);
+    downloader.setParallelConnections(connections);
+    connect(&downloader, SIGNAL(finished()), this, SLOT(onTransferFinished()));
+    connect(&downloader, SIGNAL(failed(const QString&)),
+            this, SLOT(onTransferFailed(const QString&)));
+
+    timer_.start();
+    downloader.start();
+    loop_.exec();
+
+    return result_;
+}
+
+void ApiBench::onTransferFinished()
+{
+    result_.ok = true;
+    result_.total_usecs = timer_.nsecsElapsed() / 1000;
+    loop_.quit();
+}
+
+void ApiBench::onTransferFailed(const QString& error)
+{
+    fprintf(stderr, "transfer failed: %s\n", error.toUtf8().data());
+    result_.ok = false;
+    result_.total_usecs = timer_.nsecsElapsed() / 1000;
+    loop_.quit();
+}
+
+void ApiBench::onSuccess(const std::vector<ServerRepo>& repos)
+{
+    result_.ok = true;
+    result_.total_usecs = timer_.nsecsElapsed() / 1000;
+    result_.repos = repos.size();
+    loop_.quit();
+}
+
+void ApiBench::onFailed(int /* code */)
+{
+    result_.ok = false;
+    result_.total_usecs = timer_.nsecsElapsed() / 1000;
+    loop_.quit();
+}
+
+namespace {
+
+/**
+ * Upload a file of upload_mb MB filled with junk, and report the throughput
+ */
+int runUploadBench(ApiBench *bench, int upload_mb, int parallel_chunks, int iterations)
+{
+    QTemporaryFile file;
+    if (!file.open()) {
+        fprintf(stderr, "failed to create a temporary file\n");
+        return 1;
+    }
+
+    QByteArray block(1024 * 1024, 'x');
+    for (int i = 0; i < upload_mb; i++) {
+        file.write(block);
+    }
+    file.flush();
+
+    printf("%8s %10s %12s %12s %10s\n", "size(MB)", "ok", "total(ms)", "MB/s", "rss(kB)");
+
+    int ok = 0;
+    qint64 total = 0;
+    for (int i = 0; i < iterations; i++) {
+        ApiBench::Result result = bench->uploadFile(file.fileName(), parallel_chunks);
+        if (result.ok) {
+            ok++;
+            total += result.total_usecs;
+        }
+    }
+
+    qint64 avg = ok > 0 ? total / ok : 0;
+    printf("%8d %7d/%-2d %12.2f %12.2f %10ld\n",
+           upload_mb, ok, iterations, avg / 1000.0,
+           avg > 0 ? upload_mb * 1000000.0 / avg : 0.0, peakRss());
+
+    return ok == iterations ? 0 : 1;
+}
+
+/**
+ * Download a file of download_mb MB from the stand-in seahub, in ranges over
+ * the given number of connections, and report the throughput
+ */
+int runDownloadBench(ApiBench *bench, int download_mb, int connections, int iterations)
+{
+    QString local_path = QDir::temp().filePath("seafile-api-bench-download");
+    qint64 size = (qint64)download_mb * 1024 * 1024;
+
+    printf("%8s %10s %12s %12s %10s\n", "size(MB)", "ok", "total(ms)", "MB/s", "rss(kB)");
+
+    int ok = 0;
+    qint64 total = 0;
+    for (int i = 0; i < iterations; i++) {
+        ApiBench::Result result = bench->downloadFile(local_path, connections);
+        if (result.ok && QFileInfo(local_path).size() == size) {
+            ok++;
+            total += result.total_usecs;
+        }
+        QFile::remove(local_path);
+    }
+
+    qint64 avg = ok > 0 ? total / ok : 0;
+    printf("%8d %7d/%-2d %12.2f %12.2f %10ld\n",
+           download_mb, ok, iterations, avg / 1000.0,
+           avg > 0 ? download_mb * 1000000.0 / avg : 0.0, peakRss());
+
+    return ok == iterations ? 0 : 1;
+}
+
+// Heap taken by the data of a string, the empty ones share a static one
+qint64 stringBytes(const QString& s)
+{
+    if (s.isEmpty()) {
+        return 0;
+    }
+    return 3 * sizeof(void *) + (s.capacity() + 1) * sizeof(QChar);
+}
+
+// The strings of a repo not shared with other repos, see internStrings()
+qint64 serverRepoBytes(const ServerRepo& repo)
+{
+    return stringBytes(repo.id) + stringBytes(repo.name) + stringBytes(repo.description)
+        + stringBytes(repo.root);
+}
+
+// As RepoTreeModel does, the items share the data of these strings
+void internStrings(QSet<QString> *pool, ServerRepo *repo)
+{
+    QString *strings[] = { &repo->type, &repo->owner, &repo->permission, &repo->group_name };
+    for (int i = 0, n = sizeof(strings) / sizeof(strings[0]); i < n; i++) {
+        QString& s = *strings[i];
+        if (s.isEmpty()) {
+            continue;
+        }
+        QSet<QString>::const_iterator it = pool->constFind(s);
+        if (it != pool->constEnd()) {
+            s = *it;
+        } else {
+            pool->insert(s);
+        }
+    }
+}
+
+// The fields compared by RepoTreeModel before it updates an item
+bool isRepoChanged(const ServerRepo& a, const ServerRepo& b)
+{
+    return a.id != b.id
+        || a.mtime != b.mtime
+        || a.root != b.root
+        || a.name != b.name
+        || a.description != b.description
+        || a.size != b.size
+        || a.encrypted != b.encrypted
+        || a.permission != b.permission
+        || a.owner != b.owner
+        || a.group_name != b.group_name;
+}
+
+QString searchTextOf(const ServerRepo& repo)
+{
+    return repo.name + '\n' + repo.description + '\n' + repo.owner + '\n' + repo.group_name;
+}
+
+/**
+ * Build the repo items of each list size the way RepoTreeModel does, one
+ * per slot, and report what they take per repo. The strings of a parsed
+ * list end up owned by the items, so they are counted too, the pooled ones
+ * once for the whole list.
+ *
+ * Then apply a second list with every kChangedRepoInterval-th repo changed
+ * the way RepoTreeModel::setAccountRepos() does: look up the slot of each
+ * repo, compare it and update the item and its search text if it changed.
+ * The model itself needs the applet, so its row moves and signals are not
+ * part of the timing.
+ */
+int runItemsBench(FakeSeahubServer *server, FakeSeahubOptions options, const QList<int>& sizes)
+{
+    printf("sizeof(RepoItem) = %d, sizeof(ServerRepo) = %d\n",
+           (int)sizeof(RepoItem), (int)sizeof(ServerRepo));
+    printf("%8s %12s %12s %12s %12s %12s %10s\n",
+           "repos", "item(B)", "strings(B)", "total(B)", "build(ms)", "apply(ms)", "rss(kB)");
+
+    for (int s = 0; s < sizes.size(); s++) {
+        options.repos = sizes[s];
+        server->setOptions(options);
+
+        json_error_t error;
+        json_t *root = json_loads(server->reposBody().data(), 0, &error);
+        std::vector<ServerRepo> repos = ServerRepo::listFromJSON(root, &error);
+        json_decref(root);
+        if (repos.empty()) {
+            continue;
+        }
+
+        std::deque<RepoItem> items;
+        RepoSearchIndex index;
+        QHash<QString, int> slots;
+        QSet<QString> pool;
+        qint64 strings = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0, n = repos.size(); i < n; i++) {
+            ServerRepo& repo = repos[i];
+            internStrings(&pool, &repo);
+            items.push_back(RepoItem(repo));
+            index.insert(i, searchTextOf(repo));
+            slots.insert(repo.id, i);
+        }
+        qint64 build_usecs = timer.nsecsElapsed() / 1000;
+
+        for (int i = 0, n = repos.size(); i < n; i++) {
+            strings += serverRepoBytes(repos[i]);
+        }
+        foreach (const QString& s, pool) {
+            strings += stringBytes(s);
+        }
+
+        std::vector<ServerRepo> next = repos;
+        for (int i = 0, n = next.size(); i < n; i += kChangedRepoInterval) {
+            next[i].mtime++;
+            next[i].name += " (renamed)";
+        }
+
+        timer.start();
+        for (int i = 0, n = next.size(); i < n; i++) {
+            const ServerRepo& repo = next[i];
+            int slot = slots.value(repo.id, -1);
+            if (slot >= 0 && isRepoChanged(items[slot].repo(), repo)) {
+                ServerRepo changed = repo;
+                internStrings(&pool, &changed);
+                items[slot].setRepo(changed);
+                index.insert(slot, searchTextOf(changed));
+            }
+        }
+        qint64 apply_usecs = timer.nsecsElapsed() / 1000;
+
+        int n = repos.size();
+        printf("%8d %12d %12lld %12lld %12.2f %12.2f %10ld\n",
+               n, (int)sizeof(RepoItem), (long long)(strings / n),
+               (long long)(sizeof(RepoItem) + strings / n),
+               build_usecs / 1000.0, apply_usecs / 1000.0, peakRss());
+    }
+
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv, false);
+
+    QList<int> sizes;
+    sizes << 100 << 1000 << 10000 << 50000;
+    int iterations = kDefaultIterations;
+    int upload_mb = 0;
+    int download_mb = 0;
+    int parallel_chunks = 1;
+    bool items = false;
+    FakeSeahubOptions options;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); i++) {
+        const QString& arg = args[i];
+        if (arg == "--repos" && i + 1 < args.size()) {
+            sizes.clear();
+            foreach (const QString& n, args[++i].split(',')) {
+                sizes << n.toInt();
+            }
+        } else if (arg == "--iterations" && i + 1 < args.size()) {
+            iterations = args[++i].toInt();
+        } else if (arg == "--latency" && i + 1 < args.size()) {
+            options.latency = args[++i].toInt();
+        } else if (arg == "--error-rate" && i + 1 < args.size()) {
+            options.error_rate = args[++i].toDouble();
+        } else if (arg == "--chunked") {
+            options.chunked = true;
+        } else if (arg == "--no-gzip") {
+            options.gzip = false;
+        } else if (arg == "--upload" && i + 1 < args.size()) {
+            upload_mb = args[++i].toInt();
+        } else if (arg == "--download" && i + 1 < args.size()) {
+            download_mb = args[++i].toInt();
+        } else if (arg == "--parallel" && i + 1 < args.size()) {
+            parallel_chunks = args[++i].toInt();
+        } else if (arg == "--items") {
+            items = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    FakeSeahubServer server;
+    if (!server.start()) {
+        fprintf(stderr, "failed to start the stand-in seahub server\n");
+        return 1;
+    }
+
+    Account account(server.url(), "bench@example.com",
+                    "0123456789abcdef0123456789abcdef01234567");
+    ApiBench bench(account);
+
+    if (upload_mb > 0) {
+        server.setOptions(options);
+        return runUploadBench(&bench, upload_mb, parallel_chunks, iterations);
+    }
+
+    if (download_mb > 0) {
+        options.download_size = (qint64)download_mb * 1024 * 1024;
+        server.setOptions(options);
+        return runDownloadBench(&bench, download_mb, parallel_chunks, iterations);
+    }
+
+    if (items) {
+        return runItemsBench(&server, options, sizes);
+    }
+
+    printf("%8s %10s %12s %12s %12s %10s %10s\n",
+           "repos", "ok", "total(ms)", "parse(ms)", "network(ms)", "wire(kB)", "rss(kB)");
+
+    for (int s = 0; s < sizes.size(); s++) {
+        options.repos = sizes[s];
+        server.setOptions(options);
+
+        QList<ApiEndpointStats> before = ApiStats::instance()->endpoints();
+
+        int ok = 0;
+        qint64 total = 0;
+        for (int i = 0; i < iterations; i++) {
+            ApiBench::Result result = bench.listRepos();
+            if (result.ok) {
+                ok++;
+                total += result.total_usecs;
+            }
+        }
+
+        qint64 parse = parseOnlyUsecs(server.reposBody());
+
+        qint64 wire = 0;
+        QList<ApiEndpointStats> after = ApiStats::instance()->endpoints();
+        for (int i = 0; i < after.size(); i++) {
+            wire += after[i].wire_bytes_in;
+        }
+        for (int i = 0; i < before.size(); i++) {
+            wire -= before[i].wire_bytes_in;
+        }
+
+        qint64 avg = ok > 0 ? total / ok : 0;
+        printf("%8d %7d/%-2d %12.2f %12.2f %12.2f %10lld %10ld\n",
+               options.repos, ok, iterations,
+               avg / 1000.0, parse / 1000.0, qMax((qint64)0, avg - parse) / 1000.0,
+               ok > 0 ? (long long)(wire / ok / 1024) : 0LL, peakRss());
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef SEAFILE_CLIENT_BENCH_API_BENCH_H
+#define SEAFILE_CLIENT_BENCH_API_BENCH_H
+
+#include <vector>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+#include "account.h"
+#include "api/server-repo.h"
+
+/**
+ * Runs ListReposRequest, uploads a file with FileUploader or downloads one
+ * with FileDownloader, against the stand-in seahub and collects timings
+ */
+class ApiBench : public QObject {
+    Q_OBJECT
+
+public:
+    struct Result {
+        bool ok;
+        // From send() to the parsed repo list
+        qint64 total_usecs;
+        int repos;
+    };
+
+    explicit ApiBench(const Account& account);
+
+    Result listRepos();
+    Result uploadFile(const QString& path, int parallel_chunks);
+    Result downloadFile(const QString& local_path, int connections);
+
+private slots:
+    void onSuccess(const std::vector<ServerRepo>& repos);
+    void onFailed(int code);
+    void onTransferFinished();
+    void onTransferFailed(const QString& error);
+
+private:
+    Account account_;
+    QEventLoop loop_;
+    QElapsedTimer timer_;
+    Result result_;
+};
+
+#endif // SEAFILE_CLIENT_BENCH_API_BENCH_H
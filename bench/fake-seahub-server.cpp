@@ -0,0 +1,456 @@
+#include <string.h>
+#include <zlib.h>
+
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QStringList>
+
+#include "fake-seahub-server.h"
+
+namespace {
+
+const char *kToken = "0123456789abcdef0123456789abcdef01234567";
+const int kReposPerGroup = 20;
+
+QByteArray fakeRepoId(int i)
+{
+    return QString().sprintf("%08x-0000-4000-8000-%012x", i, i).toUtf8();
+}
+
+QByteArray statusText(int status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 206:
+        return "Partial Content";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 416:
+        return "Requested Range Not Satisfiable";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+QByteArray gzipCompress(const QByteArray& data)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // 15 + 16: gzip wrapper
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray out;
+    out.resize(deflateBound(&zs, data.size()));
+    zs.next_in = (Bytef *)data.data();
+    zs.avail_in = data.size();
+    zs.next_out = (Bytef *)out.data();
+    zs.avail_out = out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    return out;
+}
+
+} // namespace
+
+FakeSeahubServer::FakeSeahubServer(QObject *parent)
+    : QTcpServer(parent),
+      repos_body_count_(-1),
+      requests_served_(0)
+{
+}
+
+void FakeSeahubServer::setOptions(const FakeSeahubOptions& options)
+{
+    options_ = options;
+}
+
+bool FakeSeahubServer::start(quint16 port)
+{
+    return listen(QHostAddress::LocalHost, port);
+}
+
+QUrl FakeSeahubServer::url() const
+{
+    return QUrl(QString("http://127.0.0.1:%1").arg(serverPort()));
+}
+
+void FakeSeahubServer::incomingConnection(int socket_descriptor)
+{
+    QTcpSocket *socket = new QTcpSocket(this);
+    socket->setSocketDescriptor(socket_descriptor);
+
+    buffers_.insert(socket, QByteArray());
+
+    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+}
+
+void FakeSeahubServer::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    buffers_.remove(socket);
+    socket->deleteLater();
+}
+
+void FakeSeahubServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    QByteArray& buf = buffers_[socket];
+    buf += socket->readAll();
+
+    // Keep-alive connections may carry several requests
+    Request req;
+    while (parseRequest(&buf, &req)) {
+        requests_served_++;
+
+        Response resp;
+        if (options_.error_rate > 0 && qrand() < options_.error_rate * RAND_MAX) {
+            resp.status = 500;
+            resp.body = "{\"error_msg\": \"fake failure\"}";
+        } else {
+            resp = handleRequest(req);
+        }
+
+        QByteArray data = serialize(req, resp);
+        if (options_.latency > 0) {
+            delayed_.append(qMakePair(socket, data));
+            QTimer::singleShot(options_.latency, this, SLOT(sendDelayedResponse()));
+        } else {
+            socket->write(data);
+        }
+    }
+}
+
+void FakeSeahubServer::sendDelayedResponse()
+{
+    if (delayed_.isEmpty()) {
+        return;
+    }
+
+    QPair<QTcpSocket*, QByteArray> item = delayed_.takeFirst();
+    // The client may have gone away meanwhile
+    if (buffers_.contains(item.first)) {
+        item.first->write(item.second);
+    }
+}
+
+bool FakeSeahubServer::parseRequest(QByteArray *buf, Request *req)
+{
+    int header_end = buf->indexOf("\r\n\r\n");
+    if (header_end < 0) {
+        return false;
+    }
+
+    QList<QByteArray> lines = buf->left(header_end).split('\n');
+    QList<QByteArray> request_line = lines[0].trimmed().split(' ');
+    if (request_line.size() < 2) {
+        buf->clear();
+        return false;
+    }
+
+    Request r;
+    r.method = request_line[0];
+    QByteArray target = request_line[1];
+    int q = target.indexOf('?');
+    r.path = q < 0 ? target : target.left(q);
+    r.query = q < 0 ? QByteArray() : target.mid(q + 1);
+
+    for (int i = 1; i < lines.size(); i++) {
+        int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            r.headers.insert(lines[i].left(colon).trimmed().toLower(),
+                             lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    int content_length = r.headers.value("content-length", "0").toInt();
+    int total = header_end + 4 + content_length;
+    if (buf->size() < total) {
+        // Wait for the rest of the body
+        return false;
+    }
+
+    r.body = buf->mid(header_end + 4, content_length);
+    buf->remove(0, total);
+
+    *req = r;
+    return true;
+}
+
+const QByteArray& FakeSeahubServer::reposBody()
+{
+    if (repos_body_count_ != options_.repos) {
+        repos_body_ = buildReposBody(false);
+        repos_body_count_ = options_.repos;
+    }
+
+    return repos_body_;
+}
+
+QByteArray FakeSeahubServer::buildReposBody(bool mine_only)
+{
+    QByteArray body;
+    body.reserve(options_.repos * 300);
+    body += "[";
+    bool first = true;
+    for (int i = 0; i < options_.repos; i++) {
+        // 40% personal, 20% shared, 40% group repos
+        int kind = i % 5;
+        if (mine_only && kind >= 2) {
+            continue;
+        }
+
+        if (!first) {
+            body += ", ";
+        }
+        first = false;
+
+        QByteArray type = kind < 2 ? "repo" : (kind == 2 ? "srepo" : "grepo");
+        QByteArray owner = "owner@example.com";
+        QByteArray group;
+        if (type == "grepo") {
+            int group_id = i / kReposPerGroup + 1;
+            owner = "group " + QByteArray::number(group_id);
+            group = ", \"groupid\": " + QByteArray::number(group_id);
+        }
+
+        body += "{\"id\": \"" + fakeRepoId(i) + "\", "
+            + "\"name\": \"library " + QByteArray::number(i) + "\", "
+            + "\"desc\": \"description of library " + QByteArray::number(i) + "\", "
+            + "\"mtime\": " + QByteArray::number(1380000000 + i * 60) + ", "
+            + "\"size\": " + QByteArray::number((i * 7919) % 100000000) + ", "
+            + "\"root\": \"" + QByteArray::number(i * 31337, 16).rightJustified(40, '0') + "\", "
+            + "\"encrypted\": " + (i % 17 == 0 ? "true" : "false") + ", "
+            + "\"type\": \"" + type + "\", "
+            + "\"owner\": \"" + owner + "\", "
+            + "\"permission\": \"rw\""
+            + group + "}";
+    }
+    body += "]";
+
+    return body;
+}
+
+FakeSeahubServer::Response FakeSeahubServer::handleRequest(const Request& req)
+{
+    Response resp;
+
+    if (req.path == "/api2/auth-token/" && req.method == "POST") {
+        resp.body = QByteArray("{\"token\": \"") + kToken + "\"}";
+    } else if (req.path == "/api2/repos/" && req.method == "GET") {
+        resp.body = req.query.contains("type=mine") ? buildReposBody(true) : reposBody();
+    } else if (req.path.startsWith("/api2/repos/") && req.path.endsWith("/upload-link/")) {
+        resp.body = "\"" + url().toString().toUtf8() + "/upload-api/" + kToken + "\"";
+    } else if (req.path.startsWith("/api2/repos/") && req.path.endsWith("/file-uploaded-bytes/")) {
+        QUrl query_url;
+        query_url.setEncodedQuery(req.query);
+        QByteArray file_name = query_url.queryItemValue("file_name").toUtf8();
+        resp.body = "{\"uploadedBytes\": " + QByteArray::number(uploadedBytes(file_name)) + "}";
+    } else if (req.path.startsWith("/upload-api/") && req.method == "POST") {
+        resp = handleUpload(req);
+    } else if (req.path.startsWith("/api2/repos/") && req.path.endsWith("/file/")) {
+        QUrl query_url;
+        query_url.setEncodedQuery(req.query);
+        QByteArray name = QUrl::toPercentEncoding(
+            query_url.queryItemValue("p").section('/', -1));
+        resp.body = "\"" + url().toString().toUtf8() + "/files/" + kToken + "/" + name + "\"";
+    } else if (req.path.startsWith("/files/")
+               && (req.method == "GET" || req.method == "HEAD")) {
+        resp = handleDownload(req);
+    } else if (req.path == "/api2/msgs_count/") {
+        resp.body = "{\"group_messages\": 0, \"personal_messages\": 0}";
+    } else if (req.path.startsWith("/api2/repos/") && req.path.endsWith("/download-info/")) {
+        QByteArray repo_id = req.path.split('/').value(3);
+        resp.body = "{\"relay_id\": \"0000000000000000000000000000000000000000\", "
+            "\"relay_addr\": \"127.0.0.1\", \"relay_port\": \"10001\", "
+            "\"email\": \"bench@example.com\", \"token\": \"" + QByteArray(kToken) + "\", "
+            "\"repo_id\": \"" + repo_id + "\", \"repo_name\": \"library\", "
+            "\"encrypted\": \"\", \"enc_version\": 1, \"magic\": \"\", \"random_key\": \"\"}";
+    } else {
+        resp.status = 404;
+        resp.body = "{\"error_msg\": \"not found\"}";
+    }
+
+    return resp;
+}
+
+/**
+ * Find the file part of the multipart body, and record the range of the file
+ * it holds. The data itself is dropped.
+ */
+FakeSeahubServer::Response FakeSeahubServer::handleUpload(const Request& req)
+{
+    Response resp;
+
+    QByteArray content_type = req.headers.value("content-type");
+    int b = content_type.indexOf("boundary=");
+    if (b < 0) {
+        resp.status = 400;
+        resp.body = "{\"error_msg\": \"no boundary\"}";
+        return resp;
+    }
+    QByteArray boundary = "--" + content_type.mid(b + 9);
+
+    int part = req.body.indexOf("name=\"file\"");
+    int data_start = part < 0 ? -1 : req.body.indexOf("\r\n\r\n", part);
+    int data_end = data_start < 0 ? -1 : req.body.indexOf("\r\n" + boundary, data_start + 4);
+    if (data_end < 0) {
+        resp.status = 400;
+        resp.body = "{\"error_msg\": \"no file\"}";
+        return resp;
+    }
+    qint64 length = data_end - (data_start + 4);
+
+    QByteArray file_name = "upload";
+    QByteArray disposition = req.headers.value("content-disposition");
+    int f = disposition.indexOf("filename=\"");
+    if (f >= 0) {
+        file_name = disposition.mid(f + 10);
+        file_name.chop(1);
+    }
+
+    // e.g. "bytes 0-8388607/20971520"
+    qint64 start = 0, end = length, total = length;
+    QByteArray range = req.headers.value("content-range");
+    if (!range.isEmpty()) {
+        QList<QByteArray> parts = range.mid(6).split('/');
+        QList<QByteArray> bounds = parts.value(0).split('-');
+        start = bounds.value(0).toLongLong();
+        end = bounds.value(1).toLongLong() + 1;
+        total = parts.value(1).toLongLong();
+    }
+
+    if (end - start != length) {
+        resp.status = 400;
+        resp.body = "{\"error_msg\": \"bad range\"}";
+        return resp;
+    }
+
+    uploads_[file_name].insert(start, end);
+    if (uploadedBytes(file_name) >= total) {
+        uploads_.remove(file_name);
+    }
+
+    resp.body = "\"" + fakeRepoId(requests_served_) + "\"";
+    return resp;
+}
+
+const QByteArray& FakeSeahubServer::downloadBody()
+{
+    if (download_body_.size() != options_.download_size) {
+        download_body_.resize(options_.download_size);
+        char *data = download_body_.data();
+        for (int i = 0, n = download_body_.size(); i < n; i++) {
+            data[i] = 'a' + i % 26;
+        }
+    }
+
+    return download_body_;
+}
+
+/**
+ * Serve the file, or the range of it asked for. Only a single range of the
+ * form "bytes=<start>-[<end>]" is understood, as sent by FileDownloader.
+ */
+FakeSeahubServer::Response FakeSeahubServer::handleDownload(const Request& req)
+{
+    Response resp;
+    resp.content_type = "application/octet-stream";
+
+    const QByteArray& file = downloadBody();
+    qint64 total = file.size();
+    resp.headers.append(qMakePair(QByteArray("Accept-Ranges"), QByteArray("bytes")));
+    resp.headers.append(qMakePair(QByteArray("ETag"),
+                                  "\"" + QByteArray::number(total, 16) + "\""));
+
+    // e.g. "bytes=0-4194303"
+    QByteArray range = req.headers.value("range");
+    if (range.isEmpty() || !range.startsWith("bytes=")) {
+        resp.body = file;
+        return resp;
+    }
+
+    QList<QByteArray> bounds = range.mid(6).split('-');
+    qint64 start = bounds.value(0).toLongLong();
+    qint64 end = bounds.value(1).isEmpty() ? total - 1 : bounds.value(1).toLongLong();
+    end = qMin(end, total - 1);
+    if (start > end) {
+        resp.status = 416;
+        resp.headers.append(qMakePair(QByteArray("Content-Range"),
+                                      "bytes */" + QByteArray::number(total)));
+        return resp;
+    }
+
+    resp.status = 206;
+    resp.body = file.mid(start, end - start + 1);
+    resp.headers.append(qMakePair(QByteArray("Content-Range"),
+                                  "bytes " + QByteArray::number(start) + "-"
+                                  + QByteArray::number(end) + "/"
+                                  + QByteArray::number(total)));
+    return resp;
+}
+
+qint64 FakeSeahubServer::uploadedBytes(const QByteArray& file_name) const
+{
+    const QMap<qint64, qint64> ranges = uploads_.value(file_name);
+
+    qint64 received = 0;
+    QMap<qint64, qint64>::const_iterator it;
+    for (it = ranges.begin(); it != ranges.end() && it.key() <= received; ++it) {
+        received = qMax(received, it.value());
+    }
+
+    return received;
+}
+
+QByteArray FakeSeahubServer::serialize(const Request& req, const Response& resp)
+{
+    QByteArray body = resp.body;
+    bool gzipped = false;
+    // File contents are sent as they are, their ranges are of the file itself
+    if (options_.gzip && resp.content_type == "application/json"
+        && req.headers.value("accept-encoding").contains("gzip")) {
+        body = gzipCompress(body);
+        gzipped = true;
+    }
+
+    QByteArray out;
+    out += "HTTP/1.1 " + QByteArray::number(resp.status) + " " + statusText(resp.status) + "\r\n";
+    out += "Content-Type: " + resp.content_type + "\r\n";
+    if (gzipped) {
+        out += "Content-Encoding: gzip\r\n";
+    }
+    for (int i = 0; i < resp.headers.size(); i++) {
+        out += resp.headers[i].first + ": " + resp.headers[i].second + "\r\n";
+    }
+
+    // The headers of a GET, without the body
+    if (req.method == "HEAD") {
+        out += "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+        return out;
+    }
+
+    if (!options_.chunked) {
+        out += "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+        out += body;
+        return out;
+    }
+
+    out += "Transfer-Encoding: chunked\r\n\r\n";
+    for (int pos = 0; pos < body.size(); pos += options_.chunk_size) {
+        QByteArray chunk = body.mid(pos, options_.chunk_size);
+        out += QByteArray::number(chunk.size(), 16) + "\r\n" + chunk + "\r\n";
+    }
+    out += "0\r\n\r\n";
+
+    return out;
+}
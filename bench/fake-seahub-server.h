@@ -0,0 +1,128 @@
+#ifndef SEAFILE_CLIENT_BENCH_FAKE_SEAHUB_SERVER_H
+#define SEAFILE_CLIENT_BENCH_FAKE_SEAHUB_SERVER_H
+
+#include <QTcpServer>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QUrl>
+
+class QTcpSocket;
+
+struct FakeSeahubOptions {
+    // Number of repos returned by /api2/repos/
+    int repos;
+    // Delay of every response, in msecs
+    int latency;
+    // Fraction (0 - 1) of requests answered with "500 Internal Server Error"
+    double error_rate;
+    // Send responses with "Transfer-Encoding: chunked"
+    bool chunked;
+    int chunk_size;
+    // Compress responses if the client accepts gzip
+    bool gzip;
+    // Size of every file served under /files/, in bytes
+    qint64 download_size;
+
+    FakeSeahubOptions()
+        : repos(100),
+          latency(0),
+          error_rate(0),
+          chunked(false),
+          chunk_size(16 * 1024),
+          gzip(true),
+          download_size(16 * 1024 * 1024) {}
+};
+
+/**
+ * A stand-in seahub serving the web api used by the client, on localhost:
+ *
+ *   POST /api2/auth-token/
+ *   GET  /api2/repos/[?type=mine]
+ *   GET  /api2/repos/<repo_id>/download-info/
+ *   GET  /api2/msgs_count/
+ *   GET  /api2/repos/<repo_id>/upload-link/
+ *   GET  /api2/repos/<repo_id>/file-uploaded-bytes/?file_name=<name>
+ *   POST /upload-api/<token>      (ranges of a file, see FileUploader)
+ *   GET  /api2/repos/<repo_id>/file/?p=<path>
+ *   HEAD /files/<token>/<name>
+ *   GET  /files/<token>/<name>    (with or without a Range, see FileDownloader)
+ *
+ * It runs in the event loop of the calling thread.
+ */
+class FakeSeahubServer : public QTcpServer {
+    Q_OBJECT
+
+public:
+    explicit FakeSeahubServer(QObject *parent=0);
+
+    void setOptions(const FakeSeahubOptions& options);
+    const FakeSeahubOptions& options() const { return options_; }
+
+    // Listen on localhost. A port of 0 picks a free one.
+    bool start(quint16 port=0);
+    QUrl url() const;
+
+    int requestsServed() const { return requests_served_; }
+
+    // Bytes of the file received from its start without a gap
+    qint64 uploadedBytes(const QByteArray& file_name) const;
+
+    // The uncompressed body of /api2/repos/
+    const QByteArray& reposBody();
+    // The body of /api2/repos/?type=mine
+    QByteArray buildReposBody(bool mine_only);
+    // The content of every file under /files/
+    const QByteArray& downloadBody();
+
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        QByteArray query;
+        QHash<QByteArray, QByteArray> headers;
+        QByteArray body;
+    };
+
+    struct Response {
+        int status;
+        QByteArray content_type;
+        QByteArray body;
+        QList<QPair<QByteArray, QByteArray> > headers;
+
+        Response() : status(200), content_type("application/json") {}
+    };
+
+protected:
+    void incomingConnection(int socket_descriptor);
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+    void sendDelayedResponse();
+
+private:
+    Q_DISABLE_COPY(FakeSeahubServer)
+
+    bool parseRequest(QByteArray *buf, Request *req);
+    Response handleRequest(const Request& req);
+    QByteArray serialize(const Request& req, const Response& resp);
+    Response handleUpload(const Request& req);
+    Response handleDownload(const Request& req);
+
+    FakeSeahubOptions options_;
+    QHash<QTcpSocket*, QByteArray> buffers_;
+
+    QList<QPair<QTcpSocket*, QByteArray> > delayed_;
+
+    QByteArray repos_body_;
+    int repos_body_count_;
+
+    QByteArray download_body_;
+
+    int requests_served_;
+
+    // File name => received ranges, start => end (exclusive)
+    QHash<QByteArray, QMap<qint64, qint64> > uploads_;
+};
+
+#endif // SEAFILE_CLIENT_BENCH_FAKE_SEAHUB_SERVER_H
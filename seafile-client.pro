@@ -27,6 +27,7 @@ HEADERS += ui_clone-tasks-dialog.h \
            ui_download-repo-dialog.h \
            ui_server-status-dialog.h \
            src/account-mgr.h \
+           src/account-store.h \
            src/account.h \
            src/ccnet-init.h \
            src/configurator.h \
@@ -36,33 +37,50 @@ HEADERS += ui_clone-tasks-dialog.h \
            src/settings-mgr.h \
            src/traynotificationmanager.h \
            src/traynotificationwidget.h \
+           src/api/api-cache.h \
            src/api/api-client.h \
            src/api/api-request.h \
+           src/api/api-stats.h \
+           src/api/chunk-body-device.h \
+           src/api/circuit-breaker.h \
+           src/api/file-downloader.h \
+           src/api/file-uploader.h \
+           src/api/reply-body-reader.h \
            src/api/requests.h \
+           src/api/server-dirent.h \
            src/api/server-repo.h \
+           src/api/transfer-rate.h \
            src/rpc/clone-task.h \
            src/rpc/local-repo.h \
            src/rpc/rpc-client.h \
+           src/ui/api-diagnostics-dialog.h \
+           src/ui/bulk-download-dialog.h \
            src/ui/clone-tasks-dialog.h \
            src/ui/clone-tasks-table-model.h \
            src/ui/clone-tasks-table-view.h \
            src/ui/cloud-view.h \
            src/ui/create-repo-dialog.h \
            src/ui/download-repo-dialog.h \
+           src/ui/file-download-dialog.h \
            src/ui/init-seafile-dialog.h \
            src/ui/local-repos-list-model.h \
            src/ui/local-repos-list-view.h \
            src/ui/local-view.h \
            src/ui/login-dialog.h \
            src/ui/main-window.h \
+           src/ui/repo-browser-dialog.h \
+           src/ui/repo-browser-model.h \
            src/ui/repo-detail-dialog.h \
+           src/ui/repo-filter-proxy-model.h \
            src/ui/repo-item-delegate.h \
            src/ui/repo-item.h \
+           src/ui/repo-search-index.h \
            src/ui/repo-tree-model.h \
            src/ui/repo-tree-view.h \
            src/ui/server-status-dialog.h \
            src/ui/settings-dialog.h \
            src/ui/tray-icon.h \
+           src/ui/upload-dialog.h \
            src/ui/welcome-dialog.h \
            src/utils/log.h \
            src/utils/process.h \
@@ -81,6 +99,7 @@ FORMS += ui/clone-tasks-dialog.ui \
          ui/settings-dialog.ui \
          ui/welcome-dialog.ui
 SOURCES += src/account-mgr.cpp \
+           src/account-store.cpp \
            src/ccnet-init.cpp \
            src/configurator.cpp \
            src/daemon-mgr.cpp \
@@ -90,33 +109,50 @@ SOURCES += src/account-mgr.cpp \
            src/settings-mgr.cpp \
            src/traynotificationmanager.cpp \
            src/traynotificationwidget.cpp \
+           src/api/api-cache.cpp \
            src/api/api-client.cpp \
            src/api/api-request.cpp \
+           src/api/api-stats.cpp \
+           src/api/chunk-body-device.cpp \
+           src/api/circuit-breaker.cpp \
+           src/api/file-downloader.cpp \
+           src/api/file-uploader.cpp \
+           src/api/reply-body-reader.cpp \
            src/api/requests.cpp \
+           src/api/server-dirent.cpp \
            src/api/server-repo.cpp \
+           src/api/transfer-rate.cpp \
            src/rpc/clone-task.cpp \
            src/rpc/local-repo.cpp \
            src/rpc/rpc-client.cpp \
+           src/ui/api-diagnostics-dialog.cpp \
+           src/ui/bulk-download-dialog.cpp \
            src/ui/clone-tasks-dialog.cpp \
            src/ui/clone-tasks-table-model.cpp \
            src/ui/clone-tasks-table-view.cpp \
            src/ui/cloud-view.cpp \
            src/ui/create-repo-dialog.cpp \
            src/ui/download-repo-dialog.cpp \
+           src/ui/file-download-dialog.cpp \
            src/ui/init-seafile-dialog.cpp \
            src/ui/local-repos-list-model.cpp \
            src/ui/local-repos-list-view.cpp \
            src/ui/local-view.cpp \
            src/ui/login-dialog.cpp \
            src/ui/main-window.cpp \
+           src/ui/repo-browser-dialog.cpp \
+           src/ui/repo-browser-model.cpp \
            src/ui/repo-detail-dialog.cpp \
+           src/ui/repo-filter-proxy-model.cpp \
            src/ui/repo-item-delegate.cpp \
            src/ui/repo-item.cpp \
+           src/ui/repo-search-index.cpp \
            src/ui/repo-tree-model.cpp \
            src/ui/repo-tree-view.cpp \
            src/ui/server-status-dialog.cpp \
            src/ui/settings-dialog.cpp \
            src/ui/tray-icon.cpp \
+           src/ui/upload-dialog.cpp \
            src/ui/welcome-dialog.cpp \
            src/utils/log.c \
            src/utils/rsa.cpp \
@@ -133,7 +169,7 @@ TRANSLATIONS += i18n/seafile_de_DE.ts \
 ICON = seafile.icns
 CONFIG += debug_and_release_target
 CONFIG += warn_on link_pkgconfig resources
-PKGCONFIG += libsearpc libccnet libseafile glib-2.0 sqlite3 jansson openssl
+PKGCONFIG += libsearpc libccnet libseafile glib-2.0 sqlite3 jansson openssl zlib
 
 win32 {
     SOURCES += src/utils/process-win.cpp
@@ -1,70 +1,65 @@
-#include <sqlite3.h>
-#include <glib.h>
-#include <errno.h>
-#include <stdio.h>
 #include <algorithm>
 
+#include <QDir>
 #include <QDateTime>
+#include <QThread>
+#include <QMetaType>
 
 #include "account-mgr.h"
+#include "account-store.h"
 #include "configurator.h"
 #include "seafile-applet.h"
 #include "utils/utils.h"
 
 AccountManager::AccountManager()
+    : store_(NULL),
+      thread_(NULL)
 {
+    // Accounts are passed to the store through queued calls
+    qRegisterMetaType<Account>("Account");
 }
 
 AccountManager::~AccountManager()
 {
-    if (db)
-        sqlite3_close(db);
+    stop();
 }
 
 int AccountManager::start()
 {
-    const char *errmsg;
-    const char *sql;
-
     QString db_path = QDir(seafApplet->configurator()->seafileDir()).filePath("accounts.db");
-    if (sqlite3_open (toCStr(db_path), &db)) {
-        errmsg = sqlite3_errmsg (db);
-        qDebug("failed to open account database %s: %s",
-               toCStr(db_path), errmsg ? errmsg : "no error given");
 
+    store_ = new AccountStore;
+    if (store_->open(db_path) < 0) {
+        delete store_;
+        store_ = NULL;
         seafApplet->errorAndExit(tr("failed to open account databse"));
         return -1;
     }
 
-    sql = "CREATE TABLE IF NOT EXISTS Accounts (url VARCHAR(24), "
-        "username VARCHAR(15), token VARCHAR(40), lastVisited INTEGER, "
-        "PRIMARY KEY(url, username))";
-    sqlite_query_exec (db, sql);
+    accounts_.clear();
+    store_->loadAccounts(&accounts_);
+
+    thread_ = new QThread(this);
+    store_->moveToThread(thread_);
+    thread_->start();
 
-    loadAccounts();
     return 0;
 }
 
-bool AccountManager::loadAccountsCB(sqlite3_stmt *stmt, void *data)
+void AccountManager::stop()
 {
-    AccountManager *mgr = (AccountManager *)data;
-    const char *url = (const char *)sqlite3_column_text (stmt, 0);
-    const char *username = (const char *)sqlite3_column_text (stmt, 1);
-    const char *token = (const char *)sqlite3_column_text (stmt, 2);
-    qint64 atime = (qint64)sqlite3_column_int64 (stmt, 3);
-
-    Account account = Account(QUrl(QString(url)), QString(username), QString(token), atime);
-    mgr->accounts_.push_back(account);
-    return true;
-}
+    if (!thread_) {
+        return;
+    }
 
-const std::vector<Account>& AccountManager::loadAccounts()
-{
-    const char *sql = "SELECT url, username, token, lastVisited FROM Accounts "
-        "ORDER BY lastVisited DESC";
-    accounts_.clear();
-    sqlite_foreach_selected_row (db, sql, loadAccountsCB, this);
-    return accounts_;
+    QMetaObject::invokeMethod(store_, "flush", Qt::BlockingQueuedConnection);
+    thread_->quit();
+    thread_->wait();
+
+    delete store_;
+    store_ = NULL;
+    delete thread_;
+    thread_ = NULL;
 }
 
 int AccountManager::saveAccount(const Account& account)
@@ -76,14 +71,16 @@ int AccountManager::saveAccount(const Account& account)
         }
     }
 
-    accounts_.push_back(account);
-
-    QString url = account.serverUrl.toEncoded().data();
     qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
 
-    QString sql = "REPLACE INTO Accounts VALUES ('%1', '%2', '%3', %4) ";
-    sql = sql.arg(url).arg(account.username).arg(account.token).arg(QString::number(timestamp));
-    sqlite_query_exec (db, toCStr(sql));
+    Account saved = account;
+    saved.lastVisited = timestamp;
+    accounts_.push_back(saved);
+
+    if (store_) {
+        QMetaObject::invokeMethod(store_, "saveAccount", Qt::QueuedConnection,
+                                  Q_ARG(Account, saved), Q_ARG(qint64, timestamp));
+    }
 
     emit accountAdded(account);
 
@@ -92,15 +89,14 @@ int AccountManager::saveAccount(const Account& account)
 
 int AccountManager::removeAccount(const Account& account)
 {
-    QString url = account.serverUrl.toEncoded().data();
-
-    QString sql = "DELETE FROM Accounts WHERE url = '%1' AND username = '%2'";
-    sql = sql.arg(url).arg(account.username);
-    sqlite_query_exec (db, toCStr(sql));
-
     accounts_.erase(std::remove(accounts_.begin(), accounts_.end(), account),
                     accounts_.end());
 
+    if (store_) {
+        QMetaObject::invokeMethod(store_, "removeAccount", Qt::QueuedConnection,
+                                  Q_ARG(Account, account));
+    }
+
     emit accountRemoved(account);
 
     return 0;
@@ -108,12 +104,17 @@ int AccountManager::removeAccount(const Account& account)
 
 void AccountManager::updateAccountLastVisited(const Account& account)
 {
-    const char *url = account.serverUrl.toEncoded().data();
+    qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
 
-    QString sql = "UPDATE Accounts SET lastVisited = %1 "
-        "WHERE username = '%2' AND url = '%3'";
+    for (int i = 0; i < accounts_.size(); i++) {
+        if (accounts_[i].serverUrl == account.serverUrl
+            && accounts_[i].username == account.username) {
+            accounts_[i].lastVisited = timestamp;
+        }
+    }
 
-    qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
-    sql = sql.arg(QString::number(timestamp)).arg(account.username).arg(url);
-    sqlite_query_exec (db, toCStr(sql));
+    if (store_) {
+        QMetaObject::invokeMethod(store_, "updateAccountLastVisited", Qt::QueuedConnection,
+                                  Q_ARG(Account, account), Q_ARG(qint64, timestamp));
+    }
 }
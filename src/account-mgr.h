@@ -7,11 +7,15 @@
 
 #include "account.h"
 
-struct sqlite3;
-struct sqlite3_stmt;
+class QThread;
+class AccountStore;
 
 /**
  * Load/Save seahub accounts
+ *
+ * The accounts are loaded once in start(). From then on accounts_ is
+ * authoritative, and changes are written behind by an AccountStore on a
+ * worker thread, so the GUI never waits for the disk.
  */
 class AccountManager : public QObject {
     Q_OBJECT
@@ -19,10 +23,11 @@ class AccountManager : public QObject {
 public:
     AccountManager();
     int start();
+    // Write the pending changes and stop the worker
+    void stop();
 
     int saveAccount(const Account& account);
     int removeAccount(const Account& account);
-    const std::vector<Account>& loadAccounts();
     void updateAccountLastVisited(const Account& account);
 
     // accessors
@@ -34,12 +39,12 @@ signals:
 
 private:
     ~AccountManager();
-    static bool loadAccountsCB(struct sqlite3_stmt *stmt, void *data);
 
 private:
     Q_DISABLE_COPY(AccountManager)
 
-    struct sqlite3 *db;
+    AccountStore *store_;
+    QThread *thread_;
     std::vector<Account> accounts_;
 };
 
@@ -0,0 +1,203 @@
+#include <sqlite3.h>
+
+#include <QTimer>
+
+#include "utils/utils.h"
+#include "account-store.h"
+
+namespace {
+
+// Changes arriving within this window are written in the same transaction
+const int kFlushDelayMsecs = 200;
+
+const char *kSaveAccountSql =
+    "REPLACE INTO Accounts (url, username, token, lastVisited) VALUES (?, ?, ?, ?)";
+const char *kRemoveAccountSql =
+    "DELETE FROM Accounts WHERE url = ? AND username = ?";
+const char *kUpdateLastVisitedSql =
+    "UPDATE Accounts SET lastVisited = ? WHERE url = ? AND username = ?";
+
+void bindText(sqlite3_stmt *stmt, int pos, const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+    sqlite3_bind_text(stmt, pos, utf8.data(), utf8.size(), SQLITE_TRANSIENT);
+}
+
+} // namespace
+
+AccountStore::AccountStore()
+    : db_(NULL),
+      save_stmt_(NULL),
+      remove_stmt_(NULL),
+      update_stmt_(NULL)
+{
+    // Created on the GUI thread and moved to the worker along with the store
+    flush_timer_ = new QTimer(this);
+    flush_timer_->setSingleShot(true);
+    flush_timer_->setInterval(kFlushDelayMsecs);
+    connect(flush_timer_, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+AccountStore::~AccountStore()
+{
+    sqlite3_finalize(save_stmt_);
+    sqlite3_finalize(remove_stmt_);
+    sqlite3_finalize(update_stmt_);
+
+    if (db_)
+        sqlite3_close(db_);
+}
+
+int AccountStore::open(const QString& db_path)
+{
+    if (sqlite3_open(toCStr(db_path), &db_)) {
+        const char *errmsg = sqlite3_errmsg(db_);
+        qDebug("failed to open account database %s: %s\n",
+               toCStr(db_path), errmsg ? errmsg : "no error given");
+        return -1;
+    }
+
+    // With WAL a commit appends to the log instead of rewriting the database,
+    // and NORMAL only syncs it at checkpoints
+    exec("PRAGMA journal_mode=WAL");
+    exec("PRAGMA synchronous=NORMAL");
+
+    return exec("CREATE TABLE IF NOT EXISTS Accounts (url VARCHAR(24), "
+                "username VARCHAR(15), token VARCHAR(40), lastVisited INTEGER, "
+                "PRIMARY KEY(url, username))");
+}
+
+int AccountStore::loadAccounts(std::vector<Account> *accounts)
+{
+    sqlite3_stmt *stmt = sqlite_query_prepare(
+        db_, "SELECT url, username, token, lastVisited FROM Accounts "
+        "ORDER BY lastVisited DESC");
+    if (!stmt) {
+        return -1;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *url = (const char *)sqlite3_column_text(stmt, 0);
+        const char *username = (const char *)sqlite3_column_text(stmt, 1);
+        const char *token = (const char *)sqlite3_column_text(stmt, 2);
+        qint64 atime = (qint64)sqlite3_column_int64(stmt, 3);
+
+        accounts->push_back(Account(QUrl(QString::fromUtf8(url)),
+                                    QString::fromUtf8(username),
+                                    QString::fromUtf8(token),
+                                    atime));
+    }
+
+    sqlite3_finalize(stmt);
+    return 0;
+}
+
+void AccountStore::saveAccount(const Account& account, qint64 timestamp)
+{
+    enqueue(OP_SAVE, account, timestamp);
+}
+
+void AccountStore::removeAccount(const Account& account)
+{
+    enqueue(OP_REMOVE, account, 0);
+}
+
+void AccountStore::updateAccountLastVisited(const Account& account, qint64 timestamp)
+{
+    enqueue(OP_UPDATE_LAST_VISITED, account, timestamp);
+}
+
+void AccountStore::enqueue(OpType type, const Account& account, qint64 timestamp)
+{
+    Op op;
+    op.type = type;
+    op.account = account;
+    op.timestamp = timestamp;
+    pending_.push_back(op);
+
+    if (!flush_timer_->isActive()) {
+        flush_timer_->start();
+    }
+}
+
+void AccountStore::flush()
+{
+    flush_timer_->stop();
+    if (pending_.isEmpty() || !db_) {
+        return;
+    }
+
+    QList<Op> ops = pending_;
+    pending_.clear();
+
+    if (exec("BEGIN TRANSACTION") < 0) {
+        return;
+    }
+
+    for (int i = 0, n = ops.size(); i < n; i++) {
+        execOp(ops[i]);
+    }
+
+    if (exec("COMMIT") < 0) {
+        exec("ROLLBACK");
+    }
+}
+
+sqlite3_stmt *AccountStore::prepare(sqlite3_stmt **stmt, const char *sql)
+{
+    if (!*stmt) {
+        *stmt = sqlite_query_prepare(db_, sql);
+    }
+    return *stmt;
+}
+
+int AccountStore::execOp(const Op& op)
+{
+    QString url = op.account.serverUrl.toEncoded().data();
+    sqlite3_stmt *stmt = NULL;
+
+    switch (op.type) {
+    case OP_SAVE:
+        if (!(stmt = prepare(&save_stmt_, kSaveAccountSql))) {
+            return -1;
+        }
+        bindText(stmt, 1, url);
+        bindText(stmt, 2, op.account.username);
+        bindText(stmt, 3, op.account.token);
+        sqlite3_bind_int64(stmt, 4, op.timestamp);
+        break;
+    case OP_REMOVE:
+        if (!(stmt = prepare(&remove_stmt_, kRemoveAccountSql))) {
+            return -1;
+        }
+        bindText(stmt, 1, url);
+        bindText(stmt, 2, op.account.username);
+        break;
+    case OP_UPDATE_LAST_VISITED:
+        if (!(stmt = prepare(&update_stmt_, kUpdateLastVisitedSql))) {
+            return -1;
+        }
+        sqlite3_bind_int64(stmt, 1, op.timestamp);
+        bindText(stmt, 2, url);
+        bindText(stmt, 3, op.account.username);
+        break;
+    }
+
+    int result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (result != SQLITE_DONE) {
+        const char *errmsg = sqlite3_errmsg(db_);
+        qDebug("failed to write account %s: %s\n",
+               toCStr(op.account.username), errmsg ? errmsg : "no error given");
+        return -1;
+    }
+
+    return 0;
+}
+
+int AccountStore::exec(const char *sql)
+{
+    return sqlite_query_exec(db_, sql);
+}
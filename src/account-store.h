@@ -0,0 +1,71 @@
+#ifndef _SEAF_ACCOUNT_STORE_H
+#define _SEAF_ACCOUNT_STORE_H
+
+#include <vector>
+
+#include <QObject>
+#include <QList>
+
+#include "account.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+class QTimer;
+
+/**
+ * Writes accounts to the account database, on the thread of
+ * AccountManager's persistence worker.
+ *
+ * Changes are queued and written in one transaction, with statements
+ * prepared once, so a burst of account switches costs a single commit.
+ */
+class AccountStore : public QObject {
+    Q_OBJECT
+
+public:
+    AccountStore();
+    ~AccountStore();
+
+    // Called on the GUI thread, before the store is moved to the worker
+    int open(const QString& db_path);
+    int loadAccounts(std::vector<Account> *accounts);
+
+public slots:
+    void saveAccount(const Account& account, qint64 timestamp);
+    void removeAccount(const Account& account);
+    void updateAccountLastVisited(const Account& account, qint64 timestamp);
+
+    // Write the queued changes now
+    void flush();
+
+private:
+    Q_DISABLE_COPY(AccountStore)
+
+    enum OpType {
+        OP_SAVE,
+        OP_REMOVE,
+        OP_UPDATE_LAST_VISITED
+    };
+
+    struct Op {
+        OpType type;
+        Account account;
+        qint64 timestamp;
+    };
+
+    void enqueue(OpType type, const Account& account, qint64 timestamp);
+    sqlite3_stmt *prepare(sqlite3_stmt **stmt, const char *sql);
+    int execOp(const Op& op);
+    int exec(const char *sql);
+
+    struct sqlite3 *db_;
+
+    sqlite3_stmt *save_stmt_;
+    sqlite3_stmt *remove_stmt_;
+    sqlite3_stmt *update_stmt_;
+
+    QList<Op> pending_;
+    QTimer *flush_timer_;
+};
+
+#endif  // _SEAF_ACCOUNT_STORE_H
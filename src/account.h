@@ -31,6 +31,11 @@ struct Account {
     bool isValid() const {
         return token.length() > 0;
     }
+
+    // Identifies the account across logins, i.e. regardless of the token
+    QString key() const {
+        return serverUrl.toString() + "\t" + username;
+    }
 };
 
 Q_DECLARE_METATYPE(Account)
@@ -0,0 +1,190 @@
+#include <QDateTime>
+
+#include "api-cache.h"
+
+namespace {
+
+// Older results are left to the views to fetch again
+const qint64 kMaxReposAge = 1000 * 60; // 1 min
+const qint64 kMaxMessagesCountAge = 1000 * 60; // 1 min
+const qint64 kMaxDownloadInfoAge = 1000 * 60 * 10; // 10 min
+// About 20MB
+const int kMaxCachedDirents = 100000;
+
+qint64 now()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+QString downloadInfoKey(const Account& account, const QString& repo_id)
+{
+    return account.key() + "\t" + repo_id;
+}
+
+QString direntsKey(const Account& account, const QString& repo_id, const QString& dir_id)
+{
+    return account.key() + "\t" + repo_id + "\t" + dir_id;
+}
+
+} // namespace
+
+ApiCache* ApiCache::singleton_ = NULL;
+
+ApiCache::ApiCache()
+    : dirents_(kMaxCachedDirents)
+{
+}
+
+ApiCache* ApiCache::instance()
+{
+    if (!singleton_) {
+        singleton_ = new ApiCache;
+    }
+
+    return singleton_;
+}
+
+void ApiCache::setRepos(const Account& account, const std::vector<ServerRepo>& repos)
+{
+    CachedRepos cached;
+    cached.repos = repos;
+    cached.fetched_at = now();
+    repos_.insert(account.key(), cached);
+}
+
+bool ApiCache::takeRepos(const Account& account, std::vector<ServerRepo> *repos)
+{
+    if (!repos_.contains(account.key())) {
+        return false;
+    }
+
+    CachedRepos cached = repos_.take(account.key());
+    if (now() - cached.fetched_at > kMaxReposAge) {
+        return false;
+    }
+
+    repos->swap(cached.repos);
+    return true;
+}
+
+void ApiCache::setMessagesCount(const Account& account,
+                                int group_messages,
+                                int personal_messages)
+{
+    CachedMessagesCount cached;
+    cached.group_messages = group_messages;
+    cached.personal_messages = personal_messages;
+    cached.fetched_at = now();
+    messages_.insert(account.key(), cached);
+}
+
+bool ApiCache::takeMessagesCount(const Account& account,
+                                 int *group_messages,
+                                 int *personal_messages)
+{
+    if (!messages_.contains(account.key())) {
+        return false;
+    }
+
+    CachedMessagesCount cached = messages_.take(account.key());
+    if (now() - cached.fetched_at > kMaxMessagesCountAge) {
+        return false;
+    }
+
+    *group_messages = cached.group_messages;
+    *personal_messages = cached.personal_messages;
+    return true;
+}
+
+void ApiCache::setDownloadInfo(const Account& account, const RepoDownloadInfo& info)
+{
+    CachedDownloadInfo cached;
+    cached.info = info;
+    cached.fetched_at = now();
+    download_infos_.insert(downloadInfoKey(account, info.repo_id), cached);
+}
+
+bool ApiCache::downloadInfo(const Account& account,
+                            const QString& repo_id,
+                            RepoDownloadInfo *info)
+{
+    const QString key = downloadInfoKey(account, repo_id);
+    if (!download_infos_.contains(key)) {
+        return false;
+    }
+
+    const CachedDownloadInfo& cached = download_infos_[key];
+    if (now() - cached.fetched_at > kMaxDownloadInfoAge) {
+        download_infos_.remove(key);
+        return false;
+    }
+
+    *info = cached.info;
+    return true;
+}
+
+bool ApiCache::hasDownloadInfo(const Account& account, const QString& repo_id)
+{
+    RepoDownloadInfo info;
+    return downloadInfo(account, repo_id, &info);
+}
+
+void ApiCache::removeDownloadInfo(const Account& account, const QString& repo_id)
+{
+    download_infos_.remove(downloadInfoKey(account, repo_id));
+}
+
+void ApiCache::setDirents(const Account& account,
+                          const QString& repo_id,
+                          const QString& dir_id,
+                          const std::vector<ServerDirent>& dirents)
+{
+    if (dir_id.isEmpty()) {
+        return;
+    }
+
+    // Folders too large for the cache are not inserted
+    dirents_.insert(direntsKey(account, repo_id, dir_id),
+                    new std::vector<ServerDirent>(dirents),
+                    dirents.size() + 1);
+}
+
+bool ApiCache::dirents(const Account& account,
+                       const QString& repo_id,
+                       const QString& dir_id,
+                       std::vector<ServerDirent> *dirents)
+{
+    if (dir_id.isEmpty()) {
+        return false;
+    }
+
+    std::vector<ServerDirent> *cached = dirents_.object(direntsKey(account, repo_id, dir_id));
+    if (!cached) {
+        return false;
+    }
+
+    *dirents = *cached;
+    return true;
+}
+
+void ApiCache::removeAccount(const Account& account)
+{
+    const QString key = account.key();
+    repos_.remove(key);
+    messages_.remove(key);
+
+    const QString prefix = key + "\t";
+    QMutableHashIterator<QString, CachedDownloadInfo> it(download_infos_);
+    while (it.hasNext()) {
+        it.next();
+        if (it.key().startsWith(prefix)) {
+            it.remove();
+        }
+    }
+
+    foreach (const QString& dirents_key, dirents_.keys()) {
+        if (dirents_key.startsWith(prefix)) {
+            dirents_.remove(dirents_key);
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SEAFILE_CLIENT_API_CACHE_H
+#define SEAFILE_CLIENT_API_CACHE_H
+
+#include <vector>
+#include <QHash>
+#include <QCache>
+#include <QString>
+
+#include "account.h"
+#include "server-repo.h"
+#include "server-dirent.h"
+#include "requests.h"
+
+/**
+ * Results of api requests sent ahead of the views needing them, e.g. right
+ * after login, or when the mouse hovers a library.
+ *
+ * The repos list and the messages count are handed over once: the view
+ * taking them shows them at once instead of sending its own request. Download
+ * info stays cached for a while, since it is asked for again on every
+ * download and sync of the same library.
+ *
+ * Folder listings are keyed by the id of the folder object. The id changes
+ * with the content, so a cached listing never goes stale, and the root of an
+ * unchanged library is listed without a request.
+ */
+class ApiCache {
+public:
+    static ApiCache* instance();
+
+    void setRepos(const Account& account, const std::vector<ServerRepo>& repos);
+    // Return false if there is no recent list of this account
+    bool takeRepos(const Account& account, std::vector<ServerRepo> *repos);
+
+    void setMessagesCount(const Account& account, int group_messages, int personal_messages);
+    bool takeMessagesCount(const Account& account, int *group_messages, int *personal_messages);
+
+    void setDownloadInfo(const Account& account, const RepoDownloadInfo& info);
+    bool downloadInfo(const Account& account, const QString& repo_id, RepoDownloadInfo *info);
+    bool hasDownloadInfo(const Account& account, const QString& repo_id);
+    void removeDownloadInfo(const Account& account, const QString& repo_id);
+
+    void setDirents(const Account& account, const QString& repo_id,
+                    const QString& dir_id, const std::vector<ServerDirent>& dirents);
+    bool dirents(const Account& account, const QString& repo_id,
+                 const QString& dir_id, std::vector<ServerDirent> *dirents);
+
+    // Drop everything of this account, e.g. when it is removed
+    void removeAccount(const Account& account);
+
+private:
+    ApiCache();
+    Q_DISABLE_COPY(ApiCache)
+
+    static ApiCache *singleton_;
+
+    struct CachedRepos {
+        std::vector<ServerRepo> repos;
+        qint64 fetched_at;
+    };
+
+    struct CachedMessagesCount {
+        int group_messages;
+        int personal_messages;
+        qint64 fetched_at;
+    };
+
+    struct CachedDownloadInfo {
+        RepoDownloadInfo info;
+        qint64 fetched_at;
+    };
+
+    // Keyed by Account::key()
+    QHash<QString, CachedRepos> repos_;
+    QHash<QString, CachedMessagesCount> messages_;
+    // Keyed by Account::key() and repo id
+    QHash<QString, CachedDownloadInfo> download_infos_;
+    // Keyed by Account::key(), repo id and folder id, the cost is the number
+    // of entries
+    QCache<QString, std::vector<ServerDirent> > dirents_;
+};
+
+#endif // SEAFILE_CLIENT_API_CACHE_H
@@ -1,22 +1,39 @@
 #include <QUrl>
 #include <QtNetwork>
 
+#include "api-stats.h"
 #include "api-client.h"
 
 namespace {
 
 const char *kContentTypeForm = "application/x-www-form-urlencoded";
 const char *kAuthHeader = "Authorization";
+const char *kAcceptEncodingHeader = "Accept-Encoding";
+// Setting this header ourselves turns off the gzip-only transparent
+// decompression of QNetworkAccessManager, see ReplyBodyReader
+const char *kAcceptEncoding = "gzip, deflate";
 
 } // namespace
 
 QNetworkAccessManager* SeafileApiClient::na_mgr_ = NULL;
 
 SeafileApiClient::SeafileApiClient()
+    : priority_(QNetworkRequest::NormalPriority),
+      reply_(NULL),
+      last_error_(QNetworkReply::NoError),
+      first_byte_usecs_(-1),
+      bytes_out_(0)
+{
+    networkAccessManager();
+}
+
+QNetworkAccessManager* SeafileApiClient::networkAccessManager()
 {
     if (!na_mgr_) {
         na_mgr_ = new QNetworkAccessManager();
     }
+
+    return na_mgr_;
 }
 
 SeafileApiClient::~SeafileApiClient()
@@ -29,6 +46,8 @@ SeafileApiClient::~SeafileApiClient()
 void SeafileApiClient::get(const QUrl& url)
 {
     QNetworkRequest request(url);
+    request.setRawHeader(kAcceptEncodingHeader, kAcceptEncoding);
+    request.setPriority(priority_);
 
     if (token_.length() > 0) {
         char buf[1024];
@@ -40,8 +59,12 @@ void SeafileApiClient::get(const QUrl& url)
     //        request.url().toString().toUtf8().data(),
     //        request.rawHeader(kAuthHeader).data());
 
+    releaseReply();
+    startTiming(url, 0);
     reply_ = na_mgr_->get(request);
 
+    connect(reply_, SIGNAL(metaDataChanged()), this, SLOT(onMetaDataChanged()));
+
     connect(reply_, SIGNAL(sslErrors(const QList<QSslError>&)),
             this, SLOT(onSslErrors(const QList<QSslError>&)));
 
@@ -51,6 +74,8 @@ void SeafileApiClient::get(const QUrl& url)
 void SeafileApiClient::post(const QUrl& url, const QByteArray& encodedParams)
 {
     QNetworkRequest request(url);
+    request.setRawHeader(kAcceptEncodingHeader, kAcceptEncoding);
+    request.setPriority(priority_);
     if (token_.length() > 0) {
         char buf[1024];
         qsnprintf(buf, sizeof(buf), "Token %s", token_.toUtf8().data());
@@ -58,14 +83,53 @@ void SeafileApiClient::post(const QUrl& url, const QByteArray& encodedParams)
     }
     request.setHeader(QNetworkRequest::ContentTypeHeader, kContentTypeForm);
 
+    releaseReply();
+    startTiming(url, encodedParams.size());
     reply_ = na_mgr_->post(request, encodedParams);
 
+    connect(reply_, SIGNAL(metaDataChanged()), this, SLOT(onMetaDataChanged()));
+
     connect(reply_, SIGNAL(finished()), this, SLOT(httpRequestFinished()));
 
     connect(reply_, SIGNAL(sslErrors(const QList<QSslError>&)),
             this, SLOT(onSslErrors(const QList<QSslError>&)));
 }
 
+// A retried request reuses this client, so the reply of the previous attempt
+// must be dropped before a new one is sent
+void SeafileApiClient::releaseReply()
+{
+    if (reply_) {
+        reply_->disconnect(this);
+        reply_->deleteLater();
+        reply_ = NULL;
+    }
+}
+
+void SeafileApiClient::startTiming(const QUrl& url, qint64 bytes_out)
+{
+    url_ = url;
+    bytes_out_ = bytes_out;
+    first_byte_usecs_ = -1;
+    timer_.start();
+}
+
+// The response headers have arrived
+void SeafileApiClient::onMetaDataChanged()
+{
+    if (first_byte_usecs_ < 0) {
+        first_byte_usecs_ = timer_.nsecsElapsed() / 1000;
+    }
+}
+
+void SeafileApiClient::recordStats(int code)
+{
+    qint64 total_usecs = timer_.nsecsElapsed() / 1000;
+    qint64 first_byte_usecs = first_byte_usecs_ < 0 ? total_usecs : first_byte_usecs_;
+    ApiStats::instance()->recordRequest(url_, code, bytes_out_,
+                                        first_byte_usecs, total_usecs);
+}
+
 void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
 {
     emit sslErrors(reply_, errors);
@@ -74,6 +138,9 @@ void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
 void SeafileApiClient::httpRequestFinished()
 {
     int code = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    recordStats(code);
+    last_error_ = reply_->error();
+
     if (reply_->error() != QNetworkReply::NoError) {
         qDebug("http request failed: %s\n", reply_->errorString().toUtf8().data());
         emit requestFailed(code);
@@ -3,13 +3,16 @@
 
 #include <QString>
 #include <QObject>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QUrl>
 
 #include "account.h"
 #include "server-repo.h"
 
 class QNetworkAccessManager;
 class QByteArray;
-class QNetworkReply;
 class QSslError;
 
 /**
@@ -22,9 +25,16 @@ public:
     SeafileApiClient();
     ~SeafileApiClient();
     void setToken(const QString& token) { token_ = token; };
+    void setPriority(QNetworkRequest::Priority priority) { priority_ = priority; }
     void get(const QUrl& url);
     void post(const QUrl& url, const QByteArray& encodedParams);
 
+    // The network error of the last reply, NoError for an http error
+    QNetworkReply::NetworkError lastError() const { return last_error_; }
+
+    // Shared by all requests, so they reuse connections to the same server
+    static QNetworkAccessManager* networkAccessManager();
+
 signals:
     void requestSuccess(QNetworkReply& reply);
     void requestFailed(int code);
@@ -33,15 +43,28 @@ signals:
 private slots:
     void httpRequestFinished();
     void onSslErrors(const QList<QSslError>& errors);
+    void onMetaDataChanged();
 
 private:
     Q_DISABLE_COPY(SeafileApiClient)
 
+    void releaseReply();
+    void startTiming(const QUrl& url, qint64 bytes_out);
+    void recordStats(int code);
+
     static QNetworkAccessManager *na_mgr_;
 
     QString token_;
+    QNetworkRequest::Priority priority_;
 
     QNetworkReply *reply_;
+    QNetworkReply::NetworkError last_error_;
+
+    // Timing of the current reply, see ApiStats
+    QUrl url_;
+    QElapsedTimer timer_;
+    qint64 first_byte_usecs_;
+    qint64 bytes_out_;
 };
 
 #endif  // SEAFILE_API_CLIENT_H
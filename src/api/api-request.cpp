@@ -1,16 +1,41 @@
 #include <QtNetwork>
+#include <QTimer>
+#include <QElapsedTimer>
 
+#include "circuit-breaker.h"
+#include "api-stats.h"
+#include "reply-body-reader.h"
 #include "api-request.h"
 #include "api-client.h"
 
+namespace {
+
+const int kDefaultMaxRetries = 3;
+const int kRetryBaseDelay = 500; // 0.5 sec
+const int kRetryMaxDelay = 1000 * 8; // 8 sec
+
+} // namespace
+
 SeafileApiRequest::SeafileApiRequest(const QUrl& url, Method method,
                                      const QString& token, bool ignore_ssl_errors)
     : url_(url),
       method_(method),
       token_(token),
-      ignore_ssl_errors_(ignore_ssl_errors)
+      ignore_ssl_errors_(ignore_ssl_errors),
+      max_retries_(method == METHOD_GET ? kDefaultMaxRetries : 0),
+      retries_(0),
+      probe_(false)
 {
     api_client_ = new SeafileApiClient;
+
+    connect(api_client_, SIGNAL(requestSuccess(QNetworkReply&)),
+            this, SLOT(onRequestSuccess(QNetworkReply&)));
+
+    connect(api_client_, SIGNAL(requestFailed(int)),
+            this, SLOT(onRequestFailed(int)));
+
+    connect(api_client_, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError>&)),
+            this, SLOT(onSslErrors(QNetworkReply*, const QList<QSslError>&)));
 }
 
 SeafileApiRequest::~SeafileApiRequest()
@@ -24,12 +49,29 @@ void SeafileApiRequest::setParam(const QString& name, const QString& value)
                                 QUrl::toPercentEncoding(value));
 }
 
+void SeafileApiRequest::setPriority(QNetworkRequest::Priority priority)
+{
+    api_client_->setPriority(priority);
+}
+
 void SeafileApiRequest::send()
 {
     if (token_.size() > 0) {
         api_client_->setToken(token_);
     }
 
+    retries_ = 0;
+    sendRequest();
+}
+
+void SeafileApiRequest::sendRequest()
+{
+    if (!ApiCircuitBreaker::instance()->allowRequest(url_, &probe_)) {
+        // Callers expect the signal after send() returns
+        QTimer::singleShot(0, this, SLOT(rejectedByCircuitBreaker()));
+        return;
+    }
+
     switch (method_) {
     case METHOD_GET:
         api_client_->get(url_);
@@ -38,16 +80,73 @@ void SeafileApiRequest::send()
         api_client_->post(url_, params_.encodedQuery());
         break;
     }
+}
 
-    connect(api_client_, SIGNAL(requestSuccess(QNetworkReply&)),
-            this, SLOT(requestSuccess(QNetworkReply&)));
+void SeafileApiRequest::rejectedByCircuitBreaker()
+{
+    qDebug("[api] request to %s rejected: server is unreachable\n",
+           url_.toString().toUtf8().data());
+    emit failed(0);
+}
 
-    connect(api_client_, SIGNAL(requestFailed(int)),
-            this, SIGNAL(failed(int)));
+void SeafileApiRequest::onRequestSuccess(QNetworkReply& reply)
+{
+    ApiCircuitBreaker::instance()->recordSuccess(url_);
+    requestSuccess(reply);
+}
 
-    connect(api_client_, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError>&)),
-            this, SLOT(onSslErrors(QNetworkReply*, const QList<QSslError>&)));
-            
+bool SeafileApiRequest::shouldRetry(int code) const
+{
+    // A certificate the user has refused, or a request aborted on purpose,
+    // fails the same way every time and says nothing about the server
+    QNetworkReply::NetworkError error = api_client_->lastError();
+    if (error == QNetworkReply::SslHandshakeFailedError
+        || error == QNetworkReply::OperationCanceledError) {
+        return false;
+    }
+
+    // code 0 means a network error
+    return code == 0 || code == 429 || (code / 100) == 5;
+}
+
+/**
+ * The circuit breaker counts logical requests: one failure once the
+ * retries are used up, not one per attempt. Any http response, e.g. a 4xx,
+ * shows the server is reachable and counts as a success.
+ *
+ * The probe of a half open breaker is not retried, its retries would be
+ * turned away while it is still the probe. It re-opens the breaker at once.
+ */
+void SeafileApiRequest::onRequestFailed(int code)
+{
+    ApiCircuitBreaker *breaker = ApiCircuitBreaker::instance();
+
+    if (!shouldRetry(code)) {
+        if (code > 0) {
+            breaker->recordSuccess(url_);
+        } else if (probe_) {
+            breaker->releaseProbe(url_);
+        }
+        emit failed(code);
+        return;
+    }
+
+    if (probe_ || retries_ >= max_retries_) {
+        breaker->recordFailure(url_);
+        emit failed(code);
+        return;
+    }
+
+    // Full jitter: a random delay in [0, min(max, base * 2 ^ retries)]
+    int cap = qMin(kRetryMaxDelay, kRetryBaseDelay << retries_);
+    int delay = qrand() % (cap + 1);
+    retries_++;
+    ApiStats::instance()->recordRetry(url_);
+
+    qDebug("[api] retry %s in %d ms (%d/%d)\n",
+           url_.toString().toUtf8().data(), delay, retries_, max_retries_);
+
+    QTimer::singleShot(delay, this, SLOT(sendRequest()));
 }
 
 void SeafileApiRequest::onSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
@@ -59,10 +158,18 @@ void SeafileApiRequest::onSslErrors(QNetworkReply* reply, const QList<QSslError>
     }
 }
 
-json_t* SeafileApiRequest::parseJSON(QNetworkReply &reply, json_error_t *error)
+json_t* SeafileApiRequest::parseJSON(QNetworkReply &reply, json_error_t *error, size_t flags)
 {
-    QByteArray raw = reply.readAll();
-    //qDebug("\n%s\n", raw.data());
-    json_t *root = json_loads(raw.data(), 0, error);
+    QElapsedTimer timer;
+    timer.start();
+
+    // Decode (and inflate) the body piece by piece right into the parser
+    ReplyBodyReader reader(&reply);
+    json_t *root = json_load_callback(ReplyBodyReader::jsonLoadCallback,
+                                      &reader, flags, error);
+
+    ApiStats::instance()->recordResponse(url_, reader.wireBytes(), reader.decodedBytes(),
+                                         timer.nsecsElapsed() / 1000);
+
     return root;
 }
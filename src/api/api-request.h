@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QUrl>
 #include <QMap>
+#include <QNetworkRequest>
 #include <jansson.h>
 
 class QNetworkReply;
@@ -23,6 +24,15 @@ public:
     void send();
     void setIgnoreSslErrors(bool ignore) { ignore_ssl_errors_ = ignore; }
 
+    /**
+     * Idempotent (GET) requests are retried with jittered exponential
+     * backoff on network errors and 5xx responses. Pass 0 to disable.
+     */
+    void setMaxRetries(int retries) { max_retries_ = retries; }
+
+    // Background requests (prefetching) use QNetworkRequest::LowPriority
+    void setPriority(QNetworkRequest::Priority priority);
+
 signals:
     void failed(int code);
     void sslErrors(QNetworkReply*, const QList<QSslError>&);
@@ -31,6 +41,12 @@ protected slots:
     virtual void requestSuccess(QNetworkReply& reply) = 0;
     void onSslErrors(QNetworkReply *reply, const QList<QSslError>& errors);
 
+private slots:
+    void onRequestSuccess(QNetworkReply& reply);
+    void onRequestFailed(int code);
+    void sendRequest();
+    void rejectedByCircuitBreaker();
+
 protected:
     enum Method {
         METHOD_POST,
@@ -42,7 +58,8 @@ protected:
                       const QString& token = QString(),
                       bool ignore_ssl_errors_=true);
 
-    json_t* parseJSON(QNetworkReply &reply, json_error_t *error);
+    // flags are those of json_loads(), e.g. JSON_DECODE_ANY
+    json_t* parseJSON(QNetworkReply &reply, json_error_t *error, size_t flags=0);
 
     // Used with QScopedPointer for json_t
     struct JsonPointerCustomDeleter {
@@ -57,6 +74,8 @@ protected:
 private:
     Q_DISABLE_COPY(SeafileApiRequest)
 
+    bool shouldRetry(int code) const;
+
     QUrl url_;
     QUrl params_;
     Method method_;
@@ -64,6 +83,11 @@ private:
     SeafileApiClient* api_client_;
 
     bool ignore_ssl_errors_;
+
+    int max_retries_;
+    int retries_;
+    // Whether the last attempt is the probe of a half open circuit breaker
+    bool probe_;
 };
 
 #endif // SEAFILE_API_REQUEST_H
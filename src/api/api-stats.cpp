@@ -0,0 +1,96 @@
+#include <QUrl>
+#include <QRegExp>
+#include <QStringList>
+
+#include "circuit-breaker.h"
+#include "api-stats.h"
+
+namespace {
+
+const char *kRepoIdPlaceholder = ":repo_id";
+
+bool isRepoId(const QString& s)
+{
+    static QRegExp uuid("^[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$");
+    return uuid.exactMatch(s);
+}
+
+} // namespace
+
+const char *kFirstReposTiming = "first-libraries";
+
+ApiStats* ApiStats::singleton_ = NULL;
+
+ApiStats* ApiStats::instance()
+{
+    if (!singleton_) {
+        singleton_ = new ApiStats;
+    }
+
+    return singleton_;
+}
+
+QString ApiStats::endpointName(const QUrl& url)
+{
+    QStringList parts = url.path().split('/');
+    for (int i = 0, n = parts.size(); i < n; i++) {
+        if (isRepoId(parts[i])) {
+            parts[i] = kRepoIdPlaceholder;
+        }
+    }
+
+    return parts.join("/");
+}
+
+ApiEndpointStats& ApiStats::statsFor(const QUrl& url)
+{
+    QString server = ApiCircuitBreaker::serverKey(url);
+    QString endpoint = endpointName(url);
+    QString key = server + endpoint;
+
+    if (!stats_.contains(key)) {
+        ApiEndpointStats stats;
+        stats.server = server;
+        stats.endpoint = endpoint;
+        stats_.insert(key, stats);
+    }
+
+    return stats_[key];
+}
+
+void ApiStats::recordRequest(const QUrl& url, int status, qint64 bytes_out,
+                             qint64 first_byte_usecs, qint64 total_usecs)
+{
+    ApiEndpointStats& stats = statsFor(url);
+    stats.requests++;
+    stats.status_counts[status]++;
+    stats.bytes_out += bytes_out;
+    stats.first_byte_usecs += first_byte_usecs;
+    stats.total_usecs += total_usecs;
+    stats.max_total_usecs = qMax(stats.max_total_usecs, total_usecs);
+}
+
+void ApiStats::recordRetry(const QUrl& url)
+{
+    statsFor(url).retries++;
+}
+
+void ApiStats::recordResponse(const QUrl& url, qint64 wire_bytes, qint64 decoded_bytes,
+                              qint64 parse_usecs)
+{
+    ApiEndpointStats& stats = statsFor(url);
+    stats.responses++;
+    stats.wire_bytes_in += wire_bytes;
+    stats.decoded_bytes_in += decoded_bytes;
+    stats.parse_usecs += parse_usecs;
+}
+
+void ApiStats::recordTiming(const QString& name, qint64 usecs)
+{
+    ApiTimingStats& timing = timings_[name];
+    timing.name = name;
+    timing.count++;
+    timing.total_usecs += usecs;
+    timing.last_usecs = usecs;
+    timing.max_usecs = qMax(timing.max_usecs, usecs);
+}
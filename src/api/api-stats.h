@@ -0,0 +1,120 @@
+#ifndef SEAFILE_CLIENT_API_STATS_H
+#define SEAFILE_CLIENT_API_STATS_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+class QUrl;
+
+// Names of the timings recorded by the ui. They are keys, only translated
+// where they are shown.
+extern const char *kFirstReposTiming;
+
+/**
+ * Traffic counters of seahub api requests, per server and endpoint
+ *
+ * Times are in microseconds. Qt4 does not expose the dns lookup, tcp connect
+ * and ssl handshake of a QNetworkReply, so they are part of the time to the
+ * first byte.
+ */
+struct ApiEndpointStats {
+    QString server;
+    QString endpoint;
+
+    // Finished requests, including failed ones
+    qint64 requests;
+    qint64 retries;
+    // HTTP status code => count, 0 for network errors
+    QMap<int, qint64> status_counts;
+
+    // From sending the request to the response headers
+    qint64 first_byte_usecs;
+    // From sending the request to the end of the response
+    qint64 total_usecs;
+    qint64 max_total_usecs;
+    // Decoding and parsing the response body
+    qint64 parse_usecs;
+
+    // Bytes of request bodies
+    qint64 bytes_out;
+
+    qint64 responses;
+    // Bytes of response bodies as they came over the wire
+    qint64 wire_bytes_in;
+    // Bytes of response bodies after decompression
+    qint64 decoded_bytes_in;
+
+    ApiEndpointStats()
+        : requests(0),
+          retries(0),
+          first_byte_usecs(0),
+          total_usecs(0),
+          max_total_usecs(0),
+          parse_usecs(0),
+          bytes_out(0),
+          responses(0),
+          wire_bytes_in(0),
+          decoded_bytes_in(0) {}
+};
+
+/**
+ * Durations of user visible steps built on top of api requests, e.g. the
+ * time until the first libraries are shown
+ */
+struct ApiTimingStats {
+    QString name;
+    qint64 count;
+    qint64 total_usecs;
+    qint64 last_usecs;
+    qint64 max_usecs;
+
+    ApiTimingStats()
+        : count(0),
+          total_usecs(0),
+          last_usecs(0),
+          max_usecs(0) {}
+};
+
+/**
+ * All api requests are sent and finished on the main thread, so the counters
+ * are plain fields updated without any locking.
+ */
+class ApiStats {
+public:
+    static ApiStats* instance();
+
+    /**
+     * Path of the url with repo ids replaced by a placeholder, so all
+     * requests of the same api share one entry,
+     * e.g. "/api2/repos/:repo_id/download-info/"
+     */
+    static QString endpointName(const QUrl& url);
+
+    void recordRequest(const QUrl& url, int status, qint64 bytes_out,
+                       qint64 first_byte_usecs, qint64 total_usecs);
+    void recordRetry(const QUrl& url);
+    void recordResponse(const QUrl& url, qint64 wire_bytes, qint64 decoded_bytes,
+                        qint64 parse_usecs);
+
+    void recordTiming(const QString& name, qint64 usecs);
+
+    QList<ApiEndpointStats> endpoints() const { return stats_.values(); }
+    QList<ApiTimingStats> timings() const { return timings_.values(); }
+
+    void reset() { stats_.clear(); timings_.clear(); }
+
+private:
+    ApiStats() {}
+    Q_DISABLE_COPY(ApiStats)
+
+    ApiEndpointStats& statsFor(const QUrl& url);
+
+    static ApiStats *singleton_;
+
+    QHash<QString, ApiEndpointStats> stats_;
+    QMap<QString, ApiTimingStats> timings_;
+};
+
+#endif // SEAFILE_CLIENT_API_STATS_H
@@ -0,0 +1,98 @@
+#include <string.h>
+
+#include "chunk-body-device.h"
+
+ChunkBodyDevice::ChunkBodyDevice(const QString& path,
+                                 qint64 offset,
+                                 qint64 length,
+                                 const QByteArray& head,
+                                 const QByteArray& tail,
+                                 QObject *parent)
+    : QIODevice(parent),
+      file_(path),
+      offset_(offset),
+      length_(length),
+      head_(head),
+      tail_(tail),
+      pos_(0)
+{
+}
+
+bool ChunkBodyDevice::open(OpenMode mode)
+{
+    if (mode & WriteOnly) {
+        return false;
+    }
+
+    if (!file_.open(QIODevice::ReadOnly)) {
+        setErrorString(file_.errorString());
+        return false;
+    }
+
+    pos_ = 0;
+    // We keep our own position, reads go straight to the file
+    return QIODevice::open(mode | Unbuffered);
+}
+
+void ChunkBodyDevice::close()
+{
+    file_.close();
+    QIODevice::close();
+}
+
+qint64 ChunkBodyDevice::size() const
+{
+    return head_.size() + length_ + tail_.size();
+}
+
+bool ChunkBodyDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > size()) {
+        return false;
+    }
+
+    pos_ = pos;
+    return QIODevice::seek(pos);
+}
+
+qint64 ChunkBodyDevice::readData(char *data, qint64 maxlen)
+{
+    const qint64 head_end = head_.size();
+    const qint64 range_end = head_end + length_;
+
+    qint64 done = 0;
+    while (done < maxlen && pos_ < size()) {
+        qint64 n;
+        if (pos_ < head_end) {
+            n = qMin(maxlen - done, head_end - pos_);
+            memcpy(data + done, head_.constData() + pos_, n);
+
+        } else if (pos_ < range_end) {
+            qint64 file_pos = offset_ + pos_ - head_end;
+            if (file_.pos() != file_pos && !file_.seek(file_pos)) {
+                setErrorString(file_.errorString());
+                return done > 0 ? done : -1;
+            }
+            n = file_.read(data + done, qMin(maxlen - done, range_end - pos_));
+            if (n <= 0) {
+                // The file was truncated meanwhile
+                setErrorString(file_.errorString());
+                return done > 0 ? done : -1;
+            }
+
+        } else {
+            n = qMin(maxlen - done, size() - pos_);
+            memcpy(data + done, tail_.constData() + (pos_ - range_end), n);
+        }
+
+        done += n;
+        pos_ += n;
+    }
+
+    return done;
+}
+
+qint64 ChunkBodyDevice::writeData(const char * /* data */, qint64 /* len */)
+{
+    return -1;
+}
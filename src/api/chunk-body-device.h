@@ -0,0 +1,48 @@
+#ifndef SEAFILE_CLIENT_API_CHUNK_BODY_DEVICE_H
+#define SEAFILE_CLIENT_API_CHUNK_BODY_DEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QFile>
+
+/**
+ * The body of a request uploading a range of a file: a head, the range read
+ * from disk as the network asks for it, and a tail. Neither the range nor
+ * the file is ever held in memory.
+ *
+ * It is a random access device, so QNetworkAccessManager can rewind it when
+ * a request has to be sent again.
+ */
+class ChunkBodyDevice : public QIODevice {
+public:
+    ChunkBodyDevice(const QString& path,
+                    qint64 offset,
+                    qint64 length,
+                    const QByteArray& head,
+                    const QByteArray& tail,
+                    QObject *parent=0);
+
+    bool open(OpenMode mode);
+    void close();
+
+    bool isSequential() const { return false; }
+    qint64 size() const;
+    bool seek(qint64 pos);
+
+protected:
+    qint64 readData(char *data, qint64 maxlen);
+    qint64 writeData(const char *data, qint64 len);
+
+private:
+    Q_DISABLE_COPY(ChunkBodyDevice)
+
+    QFile file_;
+    qint64 offset_;
+    qint64 length_;
+    QByteArray head_;
+    QByteArray tail_;
+
+    qint64 pos_;
+};
+
+#endif // SEAFILE_CLIENT_API_CHUNK_BODY_DEVICE_H
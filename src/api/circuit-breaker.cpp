@@ -0,0 +1,166 @@
+#include <QUrl>
+#include <QDateTime>
+
+#include "circuit-breaker.h"
+
+namespace {
+
+const int kFailureThreshold = 5;
+const int kInitialCoolDown = 1000 * 30; // 30 sec
+const int kMaxCoolDown = 1000 * 60 * 5; // 5 min
+// A probe whose request vanished (e.g. deleted by its owner) must not keep
+// the breaker half open forever
+const int kProbeTimeout = 1000 * 60;
+
+qint64 now()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+ApiCircuitBreaker* ApiCircuitBreaker::singleton_ = NULL;
+
+ApiCircuitBreaker::ServerState::ServerState()
+    : state(STATE_CLOSED),
+      failures(0),
+      opened_at(0),
+      probe_started_at(0),
+      cool_down(kInitialCoolDown)
+{
+}
+
+ApiCircuitBreaker::ApiCircuitBreaker()
+{
+}
+
+ApiCircuitBreaker* ApiCircuitBreaker::instance()
+{
+    if (!singleton_) {
+        singleton_ = new ApiCircuitBreaker;
+    }
+
+    return singleton_;
+}
+
+QString ApiCircuitBreaker::serverKey(const QUrl& url)
+{
+    int default_port = url.scheme() == "https" ? 443 : 80;
+    return QString("%1://%2:%3").arg(url.scheme())
+        .arg(url.host())
+        .arg(url.port(default_port));
+}
+
+bool ApiCircuitBreaker::allowRequest(const QUrl& url, bool *probe)
+{
+    if (probe) {
+        *probe = false;
+    }
+
+    QString key = serverKey(url);
+    if (!servers_.contains(key)) {
+        return true;
+    }
+
+    ServerState& s = servers_[key];
+    switch (s.state) {
+    case STATE_CLOSED:
+        return true;
+    case STATE_OPEN:
+        if (now() - s.opened_at < s.cool_down) {
+            return false;
+        }
+        s.probe_started_at = now();
+        setState(key, &s, STATE_HALF_OPEN);
+        if (probe) {
+            *probe = true;
+        }
+        return true;
+    case STATE_HALF_OPEN:
+        if (now() - s.probe_started_at < kProbeTimeout) {
+            // Only one probe at a time
+            return false;
+        }
+        s.probe_started_at = now();
+        if (probe) {
+            *probe = true;
+        }
+        return true;
+    }
+
+    return true;
+}
+
+void ApiCircuitBreaker::recordSuccess(const QUrl& url)
+{
+    QString key = serverKey(url);
+    if (!servers_.contains(key)) {
+        return;
+    }
+
+    ServerState& s = servers_[key];
+    s.failures = 0;
+    s.cool_down = kInitialCoolDown;
+    setState(key, &s, STATE_CLOSED);
+}
+
+void ApiCircuitBreaker::recordFailure(const QUrl& url)
+{
+    QString key = serverKey(url);
+    ServerState& s = servers_[key];
+
+    s.failures++;
+    if (s.state == STATE_HALF_OPEN) {
+        s.cool_down = qMin(s.cool_down * 2, kMaxCoolDown);
+        s.opened_at = now();
+        setState(key, &s, STATE_OPEN);
+    } else if (s.state == STATE_CLOSED && s.failures >= kFailureThreshold) {
+        s.opened_at = now();
+        qDebug("[api] circuit breaker for %s is open after %d failures\n",
+               key.toUtf8().data(), s.failures);
+        setState(key, &s, STATE_OPEN);
+    }
+}
+
+void ApiCircuitBreaker::releaseProbe(const QUrl& url)
+{
+    QString key = serverKey(url);
+    if (!servers_.contains(key)) {
+        return;
+    }
+
+    ServerState& s = servers_[key];
+    if (s.state == STATE_HALF_OPEN) {
+        s.probe_started_at = 0;
+    }
+}
+
+void ApiCircuitBreaker::setState(const QString& server, ServerState *s, State state)
+{
+    if (s->state == state) {
+        return;
+    }
+    s->state = state;
+    emit stateChanged(server);
+}
+
+ApiCircuitBreaker::State ApiCircuitBreaker::state(const QString& server) const
+{
+    return servers_.value(server).state;
+}
+
+int ApiCircuitBreaker::consecutiveFailures(const QString& server) const
+{
+    return servers_.value(server).failures;
+}
+
+int ApiCircuitBreaker::secondsToRetry(const QString& server) const
+{
+    const ServerState s = servers_.value(server);
+    if (s.state != STATE_OPEN) {
+        return 0;
+    }
+
+    qint64 left = s.opened_at + s.cool_down - now();
+    return left > 0 ? (int)(left / 1000) + 1 : 0;
+}
@@ -0,0 +1,81 @@
+#ifndef SEAFILE_CLIENT_API_CIRCUIT_BREAKER_H
+#define SEAFILE_CLIENT_API_CIRCUIT_BREAKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class QUrl;
+
+/**
+ * Per-server circuit breaker for seahub api requests.
+ *
+ * After kFailureThreshold consecutive failed requests (network errors or
+ * 5xx, counted once a request has used up its retries) the breaker of that
+ * server is "open" and all requests to it fail immediately, without
+ * touching the network. When the cool down is over one probe request
+ * is let through ("half open"). A probe which gets any http response, 4xx
+ * included, closes the breaker again, a failed one re-opens it with a
+ * doubled cool down.
+ */
+class ApiCircuitBreaker : public QObject {
+    Q_OBJECT
+
+public:
+    enum State {
+        STATE_CLOSED,
+        STATE_OPEN,
+        STATE_HALF_OPEN
+    };
+
+    static ApiCircuitBreaker* instance();
+
+    // "scheme://host:port" of the url, which is the key of a server
+    static QString serverKey(const QUrl& url);
+
+    /**
+     * Whether a request to the server of url may be sent. probe is set to
+     * true when the request is let through as the probe of a half open
+     * breaker, which must then be given a result: the probe is not retried.
+     */
+    bool allowRequest(const QUrl& url, bool *probe=NULL);
+    void recordSuccess(const QUrl& url);
+    void recordFailure(const QUrl& url);
+    // The probe ended without telling anything of the server, e.g. it was
+    // aborted. The next request is let through as a new probe.
+    void releaseProbe(const QUrl& url);
+
+    State state(const QString& server) const;
+    int consecutiveFailures(const QString& server) const;
+    // Seconds until an open breaker lets the next probe through
+    int secondsToRetry(const QString& server) const;
+
+    QStringList servers() const { return servers_.keys(); }
+
+signals:
+    void stateChanged(const QString& server);
+
+private:
+    ApiCircuitBreaker();
+    Q_DISABLE_COPY(ApiCircuitBreaker)
+
+    struct ServerState {
+        State state;
+        int failures;
+        // msecs since epoch
+        qint64 opened_at;
+        qint64 probe_started_at;
+        int cool_down;
+
+        ServerState();
+    };
+
+    void setState(const QString& server, ServerState *s, State state);
+
+    static ApiCircuitBreaker *singleton_;
+
+    QHash<QString, ServerState> servers_;
+};
+
+#endif // SEAFILE_CLIENT_API_CIRCUIT_BREAKER_H
@@ -0,0 +1,650 @@
+#include <QtNetwork>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QTimer>
+
+#if defined(Q_WS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "utils/utils.h"
+#include "requests.h"
+#include "api-client.h"
+#include "api-stats.h"
+#include "file-downloader.h"
+
+namespace {
+
+const qint64 kSegmentSize = 4 * 1024 * 1024; // 4 MB
+const int kDefaultConnections = 4;
+const int kMaxConnections = 8;
+const int kMaxSegmentRetries = 3;
+const int kSegmentRetryDelay = 1000; // 1 sec
+// Read buffer when verifying the checksum
+const qint64 kVerifyBlockSize = 1024 * 1024;
+
+// Ranges are of the file itself, never of a compressed form of it
+const char *kAcceptEncodingHeader = "Accept-Encoding";
+const char *kIdentityEncoding = "identity";
+
+const char *kMapSizeKey = "size";
+const char *kMapEtagKey = "etag";
+const char *kMapSegmentKey = "segment";
+const char *kMapDoneKey = "done";
+
+// Done segments are synced to disk and written to the map in batches, since
+// a sync may block for long on a slow disk. A crash loses at most these.
+const int kMaxUnsyncedSegments = 16;
+const qint64 kMaxUnsyncedMsecs = 5 * 1000;
+
+// Flush the file down to the disk, not only out of the buffers of Qt
+bool syncToDisk(QFile *file)
+{
+    if (!file->flush()) {
+        return false;
+    }
+#if defined(Q_WS_WIN)
+    return _commit(file->handle()) == 0;
+#else
+    return fsync(file->handle()) == 0;
+#endif
+}
+
+} // namespace
+
+FileDownloader::FileDownloader(const Account& account,
+                               const QString& repo_id,
+                               const QString& path,
+                               const QString& local_path,
+                               QObject *parent)
+    : QObject(parent),
+      account_(account),
+      repo_id_(repo_id),
+      path_(path),
+      local_path_(local_path),
+      connections_(kDefaultConnections),
+      ignore_ssl_errors_(true),
+      running_(false),
+      link_req_(NULL),
+      head_reply_(NULL),
+      total_bytes_(-1),
+      done_bytes_(0),
+      ranges_supported_(false),
+      has_checksum_(false),
+      checksum_algorithm_(QCryptographicHash::Md5)
+{
+}
+
+FileDownloader::~FileDownloader()
+{
+    cancel();
+}
+
+void FileDownloader::setParallelConnections(int connections)
+{
+    connections_ = qBound(1, connections, kMaxConnections);
+}
+
+void FileDownloader::start()
+{
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+    rate_.start();
+
+    // Links are valid for a short while, ask for a new one every time
+    releaseLinkRequest();
+    link_req_ = new GetFileDownloadLinkRequest(account_, repo_id_, path_);
+    connect(link_req_, SIGNAL(success(const QString&)),
+            this, SLOT(onDownloadLink(const QString&)));
+    connect(link_req_, SIGNAL(failed(int)), this, SLOT(onDownloadLinkFailed(int)));
+    link_req_->send();
+}
+
+void FileDownloader::cancel()
+{
+    releaseLinkRequest();
+    abortReplies();
+    queue_.clear();
+    checkpoint();
+    part_.close();
+    map_.close();
+    running_ = false;
+}
+
+void FileDownloader::releaseLinkRequest()
+{
+    if (link_req_) {
+        link_req_->disconnect(this);
+        link_req_->deleteLater();
+        link_req_ = NULL;
+    }
+}
+
+void FileDownloader::onDownloadLink(const QString& link)
+{
+    releaseLinkRequest();
+    if (!running_) {
+        return;
+    }
+
+    link_ = QUrl(link);
+
+    // Size, etag, range support and checksum, before anything is written
+    QNetworkRequest request(link_);
+    request.setRawHeader(kAcceptEncodingHeader, kIdentityEncoding);
+    head_reply_ = SeafileApiClient::networkAccessManager()->head(request);
+    connect(head_reply_, SIGNAL(finished()), this, SLOT(onHeadFinished()));
+    connect(head_reply_, SIGNAL(sslErrors(const QList<QSslError>&)),
+            this, SLOT(onSslErrors(const QList<QSslError>&)));
+}
+
+// Servers with self-signed certificates work for downloads as for the api
+void FileDownloader::onSslErrors(const QList<QSslError>& errors)
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (ignore_ssl_errors_) {
+        reply->ignoreSslErrors();
+    } else if (!errors.isEmpty()) {
+        qWarning("ssl error when downloading %s: %s\n",
+                 toCStr(path_), toCStr(errors[0].errorString()));
+    }
+}
+
+void FileDownloader::onDownloadLinkFailed(int code)
+{
+    releaseLinkRequest();
+    if (!running_) {
+        return;
+    }
+
+    fail(tr("Failed to get a download link (error code %1)").arg(code));
+}
+
+void FileDownloader::onHeadFinished()
+{
+    QNetworkReply *reply = head_reply_;
+    head_reply_ = NULL;
+    reply->deleteLater();
+
+    int code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() == QNetworkReply::NoError && code == 200
+        && reply->header(QNetworkRequest::ContentLengthHeader).isValid()) {
+        total_bytes_ = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        etag_ = reply->rawHeader("ETag");
+        ranges_supported_ = reply->rawHeader("Accept-Ranges") == "bytes";
+        parseChecksum(reply);
+    } else {
+        // Some servers only answer GET, fetch it in one piece then
+        qDebug("HEAD of %s failed (%d), downloading it in one piece\n",
+               toCStr(path_), code);
+        total_bytes_ = -1;
+        etag_.clear();
+        ranges_supported_ = false;
+        has_checksum_ = false;
+    }
+
+    bool resume = ranges_supported_ && loadProgressMap();
+    if (!resume) {
+        planSegments();
+    }
+
+    if (!openFiles(resume)) {
+        return;
+    }
+
+    recordProgress();
+    sendSegments();
+}
+
+void FileDownloader::parseChecksum(const QNetworkReply *reply)
+{
+    has_checksum_ = false;
+
+    QByteArray md5 = reply->rawHeader("Content-MD5");
+    if (!md5.isEmpty()) {
+        has_checksum_ = true;
+        checksum_algorithm_ = QCryptographicHash::Md5;
+        checksum_ = QByteArray::fromBase64(md5);
+        return;
+    }
+
+    // RFC 3230, e.g. "Digest: SHA=thvDyvhfIqlvFe+A9MYgxAfm1q5="
+    foreach (const QByteArray& digest, reply->rawHeader("Digest").split(',')) {
+        int eq = digest.indexOf('=');
+        if (eq < 0) {
+            continue;
+        }
+        QByteArray algorithm = digest.left(eq).trimmed().toLower();
+        if (algorithm == "md5" || algorithm == "sha") {
+            has_checksum_ = true;
+            checksum_algorithm_ = algorithm == "md5" ? QCryptographicHash::Md5
+                : QCryptographicHash::Sha1;
+            checksum_ = QByteArray::fromBase64(digest.mid(eq + 1).trimmed());
+            return;
+        }
+    }
+}
+
+void FileDownloader::planSegments()
+{
+    segments_.clear();
+    queue_.clear();
+    done_bytes_ = 0;
+
+    if (!ranges_supported_ || total_bytes_ <= 0) {
+        fallbackToSingleStream();
+        return;
+    }
+
+    for (qint64 offset = 0; offset < total_bytes_; offset += kSegmentSize) {
+        Segment segment;
+        segment.offset = offset;
+        segment.length = qMin(kSegmentSize, total_bytes_ - offset);
+        segment.received = 0;
+        segment.retries = 0;
+        segment.done = false;
+        queue_.append(segments_.size());
+        segments_.push_back(segment);
+    }
+}
+
+void FileDownloader::fallbackToSingleStream()
+{
+    ranges_supported_ = false;
+    segments_.clear();
+    queue_.clear();
+    done_bytes_ = 0;
+
+    Segment segment;
+    segment.offset = 0;
+    segment.length = total_bytes_;
+    segment.received = 0;
+    segment.retries = 0;
+    segment.done = false;
+    queue_.append(0);
+    segments_.push_back(segment);
+}
+
+/**
+ * Read the progress map of an earlier attempt. It only holds when the file
+ * on the server is still the same.
+ */
+bool FileDownloader::loadProgressMap()
+{
+    QFile file(mapPath());
+    if (!QFileInfo(partPath()).exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    qint64 size = -1, segment_size = -1;
+    QByteArray etag;
+    QList<int> done;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString key, value;
+        in >> key;
+        value = in.readLine().trimmed();
+        if (key == kMapSizeKey) {
+            size = value.toLongLong();
+        } else if (key == kMapEtagKey) {
+            etag = value.toUtf8();
+        } else if (key == kMapSegmentKey) {
+            segment_size = value.toLongLong();
+        } else if (key == kMapDoneKey) {
+            done << value.toInt();
+        }
+    }
+
+    if (size != total_bytes_ || etag != etag_ || segment_size != kSegmentSize) {
+        qDebug("%s changed on the server, downloading it again\n", toCStr(path_));
+        return false;
+    }
+
+    planSegments();
+    foreach (int index, done) {
+        if (index >= 0 && index < (int)segments_.size() && !segments_[index].done) {
+            segments_[index].done = true;
+            done_bytes_ += segments_[index].length;
+            queue_.removeOne(index);
+        }
+    }
+
+    qDebug("resume downloading %s, %d of %d segments done\n",
+           toCStr(path_), done.size(), (int)segments_.size());
+    return true;
+}
+
+bool FileDownloader::openFiles(bool resume)
+{
+    part_.close();
+    map_.close();
+    unsynced_segments_.clear();
+    last_sync_.start();
+
+    part_.setFileName(partPath());
+    map_.setFileName(mapPath());
+
+    QIODevice::OpenMode mode = QIODevice::ReadWrite;
+    if (!resume) {
+        mode |= QIODevice::Truncate;
+    }
+    if (!part_.open(mode)) {
+        fail(tr("Can't write %1: %2").arg(partPath()).arg(part_.errorString()));
+        return false;
+    }
+
+    // Reserve the space up front, the segments are written anywhere in it
+    if (!resume && total_bytes_ > 0 && !part_.resize(total_bytes_)) {
+        fail(tr("Can't write %1: %2").arg(partPath()).arg(part_.errorString()));
+        return false;
+    }
+
+    if (!ranges_supported_) {
+        // A single stream can't be resumed
+        QFile::remove(mapPath());
+        return true;
+    }
+
+    if (!map_.open(resume ? QIODevice::Append : (QIODevice::WriteOnly | QIODevice::Truncate))) {
+        fail(tr("Can't write %1: %2").arg(mapPath()).arg(map_.errorString()));
+        return false;
+    }
+
+    if (!resume) {
+        QTextStream out(&map_);
+        out << kMapSizeKey << " " << total_bytes_ << "\n"
+            << kMapEtagKey << " " << QString::fromUtf8(etag_) << "\n"
+            << kMapSegmentKey << " " << kSegmentSize << "\n";
+        out.flush();
+        map_.flush();
+    }
+
+    return true;
+}
+
+void FileDownloader::markDone(int index)
+{
+    Segment& segment = segments_[index];
+    segment.done = true;
+    done_bytes_ += segment.length;
+
+    if (!map_.isOpen()) {
+        return;
+    }
+
+    unsynced_segments_ << index;
+    if (unsynced_segments_.size() >= kMaxUnsyncedSegments
+        || last_sync_.elapsed() >= kMaxUnsyncedMsecs) {
+        checkpoint();
+    }
+}
+
+/**
+ * The data must be on disk before the map says so. Otherwise a segment is
+ * left out of the map, and fetched again after a crash.
+ */
+void FileDownloader::checkpoint()
+{
+    if (unsynced_segments_.isEmpty() || !map_.isOpen()) {
+        return;
+    }
+
+    last_sync_.start();
+    if (!syncToDisk(&part_)) {
+        qWarning("failed to sync %s to disk\n", toCStr(partPath()));
+        return;
+    }
+
+    QTextStream out(&map_);
+    foreach (int index, unsynced_segments_) {
+        out << kMapDoneKey << " " << index << "\n";
+    }
+    out.flush();
+    map_.flush();
+    unsynced_segments_.clear();
+}
+
+void FileDownloader::sendSegments()
+{
+    if (!running_) {
+        return;
+    }
+
+    if (queue_.isEmpty() && replies_.isEmpty()) {
+        complete();
+        return;
+    }
+
+    while (!queue_.isEmpty() && replies_.size() < connections_) {
+        sendSegment(queue_.takeFirst());
+    }
+}
+
+void FileDownloader::sendSegment(int index)
+{
+    Segment& segment = segments_[index];
+    segment.received = 0;
+    segment.timer.start();
+
+    QNetworkRequest request(link_);
+    request.setRawHeader(kAcceptEncodingHeader, kIdentityEncoding);
+    if (ranges_supported_) {
+        request.setRawHeader("Range",
+                             QString("bytes=%1-%2")
+                             .arg(segment.offset)
+                             .arg(segment.offset + segment.length - 1).toUtf8());
+    }
+
+    QNetworkReply *reply = SeafileApiClient::networkAccessManager()->get(request);
+    replies_.insert(reply, index);
+
+    connect(reply, SIGNAL(readyRead()), this, SLOT(onSegmentReadyRead()));
+    connect(reply, SIGNAL(finished()), this, SLOT(onSegmentFinished()));
+    connect(reply, SIGNAL(sslErrors(const QList<QSslError>&)),
+            this, SLOT(onSslErrors(const QList<QSslError>&)));
+}
+
+void FileDownloader::onSegmentReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!replies_.contains(reply)) {
+        return;
+    }
+
+    int code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (ranges_supported_ && code == 200) {
+        // The server ignores ranges after all
+        qDebug("server sent all of %s for a range, downloading it in one piece\n",
+               toCStr(path_));
+        abortReplies();
+        fallbackToSingleStream();
+        if (openFiles(false)) {
+            sendSegments();
+        }
+        return;
+    }
+    if (code / 100 != 2) {
+        // Handled when finished
+        return;
+    }
+
+    Segment& segment = segments_[replies_.value(reply)];
+    QByteArray data = reply->readAll();
+    if (segment.length >= 0 && segment.received + data.size() > segment.length) {
+        data.truncate(segment.length - segment.received);
+    }
+
+    // Positional write, the connections fill different parts of the file
+    if (!part_.seek(segment.offset + segment.received)
+        || part_.write(data) != data.size()) {
+        fail(tr("Can't write %1: %2").arg(partPath()).arg(part_.errorString()));
+        return;
+    }
+
+    segment.received += data.size();
+    recordProgress();
+}
+
+void FileDownloader::onSegmentFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    if (!replies_.contains(reply)) {
+        return;
+    }
+
+    int index = replies_.take(reply);
+    Segment& segment = segments_[index];
+
+    int code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qint64 usecs = segment.timer.nsecsElapsed() / 1000;
+    ApiStats::instance()->recordRequest(link_, code, 0, usecs, usecs);
+
+    bool complete = segment.length < 0 || segment.received == segment.length;
+    if (reply->error() != QNetworkReply::NoError || code / 100 != 2 || !complete) {
+        QString error = reply->error() != QNetworkReply::NoError
+            ? reply->errorString() : tr("error code %1").arg(code);
+
+        if (segment.retries >= kMaxSegmentRetries || code / 100 == 4 || !ranges_supported_) {
+            fail(tr("Failed to download %1: %2").arg(path_).arg(error));
+            return;
+        }
+
+        segment.retries++;
+        segment.received = 0;
+        ApiStats::instance()->recordRetry(link_);
+        qDebug("retry segment %d of %s (%d/%d): %s\n", index, toCStr(path_),
+               segment.retries, kMaxSegmentRetries, toCStr(error));
+
+        queue_.prepend(index);
+        QTimer::singleShot(kSegmentRetryDelay * segment.retries, this, SLOT(sendSegments()));
+        return;
+    }
+
+    if (segment.length < 0) {
+        // Size unknown until now
+        segment.length = segment.received;
+        total_bytes_ = segment.received;
+    }
+
+    markDone(index);
+    recordProgress();
+    sendSegments();
+}
+
+void FileDownloader::complete()
+{
+    running_ = false;
+    part_.close();
+    map_.close();
+
+    QString error;
+    if (has_checksum_ && !verifyChecksum(&error)) {
+        // Start from scratch next time
+        QFile::remove(partPath());
+        QFile::remove(mapPath());
+        fail(error);
+        return;
+    }
+
+    // The user has agreed to replace it
+    if (QFileInfo(local_path_).exists() && !QFile::remove(local_path_)) {
+        fail(tr("Can't replace %1").arg(local_path_));
+        return;
+    }
+    if (!QFile::rename(partPath(), local_path_)) {
+        fail(tr("Can't rename %1 to %2").arg(partPath()).arg(local_path_));
+        return;
+    }
+    QFile::remove(mapPath());
+
+    emit finished();
+}
+
+bool FileDownloader::verifyChecksum(QString *error)
+{
+    QFile file(partPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = tr("Can't read %1: %2").arg(partPath()).arg(file.errorString());
+        return false;
+    }
+
+    QCryptographicHash hash(checksum_algorithm_);
+    while (!file.atEnd()) {
+        QByteArray block = file.read(kVerifyBlockSize);
+        if (block.isEmpty()) {
+            *error = tr("Can't read %1: %2").arg(partPath()).arg(file.errorString());
+            return false;
+        }
+        hash.addData(block);
+    }
+
+    if (hash.result() != checksum_) {
+        *error = tr("%1 is corrupted, the checksum does not match").arg(path_);
+        return false;
+    }
+
+    return true;
+}
+
+void FileDownloader::fail(const QString& error)
+{
+    qWarning("download of %s failed: %s\n", toCStr(path_), toCStr(error));
+
+    releaseLinkRequest();
+    abortReplies();
+    queue_.clear();
+    // Keep what is done for the next attempt
+    checkpoint();
+    part_.close();
+    map_.close();
+    running_ = false;
+
+    emit failed(error);
+}
+
+void FileDownloader::abortReplies()
+{
+    if (head_reply_) {
+        head_reply_->disconnect(this);
+        head_reply_->abort();
+        head_reply_->deleteLater();
+        head_reply_ = NULL;
+    }
+
+    QHash<QNetworkReply*, int> replies = replies_;
+    replies_.clear();
+
+    QHash<QNetworkReply*, int>::const_iterator it;
+    for (it = replies.begin(); it != replies.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+}
+
+qint64 FileDownloader::downloadedBytes() const
+{
+    qint64 bytes = done_bytes_;
+
+    QHash<QNetworkReply*, int>::const_iterator it;
+    for (it = replies_.begin(); it != replies_.end(); ++it) {
+        bytes += segments_[it.value()].received;
+    }
+
+    return bytes;
+}
+
+void FileDownloader::recordProgress()
+{
+    qint64 downloaded = downloadedBytes();
+    rate_.record(downloaded);
+
+    emit progress(downloaded, total_bytes_);
+}
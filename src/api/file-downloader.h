@@ -0,0 +1,143 @@
+#ifndef SEAFILE_CLIENT_API_FILE_DOWNLOADER_H
+#define SEAFILE_CLIENT_API_FILE_DOWNLOADER_H
+
+#include <vector>
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QFile>
+#include <QUrl>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+
+#include "account.h"
+#include "transfer-rate.h"
+
+class QNetworkReply;
+class QSslError;
+class GetFileDownloadLinkRequest;
+
+/**
+ * Download one file of a library over http, without syncing the library.
+ *
+ * The file is split in fixed size segments fetched with "Range" requests
+ * over several connections at once. Each segment is written at its offset
+ * in "<file>.part", preallocated to the full size.
+ *
+ * Finished segments are appended to a progress map, "<file>.seafdownload",
+ * so start() after an interruption only fetches what is missing. They are
+ * synced to disk and added to the map in batches, so a crash may lose the
+ * last few. The map is dropped when the size or the etag of the file
+ * changed on the server.
+ *
+ * When the server sends a checksum ("Content-MD5", or "Digest" with md5 or
+ * sha), the file is verified before it is renamed to its final name.
+ */
+class FileDownloader : public QObject {
+    Q_OBJECT
+
+public:
+    FileDownloader(const Account& account,
+                   const QString& repo_id,
+                   const QString& path,
+                   const QString& local_path,
+                   QObject *parent=0);
+    ~FileDownloader();
+
+    void setParallelConnections(int connections);
+    // Like SeafileApiRequest, certificate errors are ignored by default
+    void setIgnoreSslErrors(bool ignore) { ignore_ssl_errors_ = ignore; }
+
+    // Start, or resume after failed() or a restart of the client
+    void start();
+    void cancel();
+
+    bool isRunning() const { return running_; }
+
+    const QString& localPath() const { return local_path_; }
+    qint64 totalBytes() const { return total_bytes_; }
+    qint64 downloadedBytes() const;
+    // Bytes per second over the last few seconds
+    qint64 rate() const { return rate_.rate(); }
+
+signals:
+    void progress(qint64 downloaded, qint64 total);
+    void finished();
+    void failed(const QString& error);
+
+private slots:
+    void onDownloadLink(const QString& link);
+    void onDownloadLinkFailed(int code);
+    void onHeadFinished();
+    void onSegmentReadyRead();
+    void onSegmentFinished();
+    void onSslErrors(const QList<QSslError>& errors);
+    void sendSegments();
+
+private:
+    Q_DISABLE_COPY(FileDownloader)
+
+    struct Segment {
+        qint64 offset;
+        qint64 length;
+        qint64 received;
+        int retries;
+        bool done;
+        QElapsedTimer timer;
+    };
+
+    QString partPath() const { return local_path_ + ".part"; }
+    QString mapPath() const { return local_path_ + ".seafdownload"; }
+
+    void parseChecksum(const QNetworkReply *reply);
+    void planSegments();
+    bool loadProgressMap();
+    bool openFiles(bool resume);
+    void markDone(int index);
+    void checkpoint();
+    void sendSegment(int index);
+    void fallbackToSingleStream();
+    void complete();
+    bool verifyChecksum(QString *error);
+    void fail(const QString& error);
+    void abortReplies();
+    void releaseLinkRequest();
+    void recordProgress();
+
+    Account account_;
+    QString repo_id_;
+    QString path_;
+    QString local_path_;
+
+    int connections_;
+    bool ignore_ssl_errors_;
+    bool running_;
+
+    QUrl link_;
+    GetFileDownloadLinkRequest *link_req_;
+    QNetworkReply *head_reply_;
+
+    // -1 until known
+    qint64 total_bytes_;
+    qint64 done_bytes_;
+    QByteArray etag_;
+    bool ranges_supported_;
+
+    bool has_checksum_;
+    QCryptographicHash::Algorithm checksum_algorithm_;
+    QByteArray checksum_;
+
+    QFile part_;
+    QFile map_;
+    // Done segments not in the map yet, see checkpoint()
+    QList<int> unsynced_segments_;
+    QElapsedTimer last_sync_;
+
+    std::vector<Segment> segments_;
+    QList<int> queue_;
+    QHash<QNetworkReply*, int> replies_;
+
+    TransferRate rate_;
+};
+
+#endif // SEAFILE_CLIENT_API_FILE_DOWNLOADER_H
@@ -0,0 +1,357 @@
+#include <QtNetwork>
+#include <QFileInfo>
+#include <QTimer>
+
+#include "utils/utils.h"
+#include "requests.h"
+#include "api-client.h"
+#include "api-stats.h"
+#include "chunk-body-device.h"
+#include "file-uploader.h"
+
+namespace {
+
+const qint64 kDefaultChunkSize = 8 * 1024 * 1024; // 8 MB
+const int kMaxParallelChunks = 8;
+const int kMaxChunkRetries = 3;
+const int kChunkRetryDelay = 1000; // 1 sec
+
+const char *kBoundary = "----SeafileClientUploadBoundary";
+
+QByteArray formField(const char *name, const QByteArray& value)
+{
+    return QByteArray("--") + kBoundary + "\r\n"
+        + "Content-Disposition: form-data; name=\"" + name + "\"\r\n\r\n"
+        + value + "\r\n";
+}
+
+} // namespace
+
+FileUploader::FileUploader(const Account& account,
+                           const QString& repo_id,
+                           const QString& parent_dir,
+                           const QString& local_path,
+                           QObject *parent)
+    : QObject(parent),
+      account_(account),
+      repo_id_(repo_id),
+      parent_dir_(parent_dir),
+      local_path_(local_path),
+      chunk_size_(kDefaultChunkSize),
+      parallel_chunks_(1),
+      ignore_ssl_errors_(true),
+      running_(false),
+      done_bytes_(0),
+      link_req_(NULL),
+      uploaded_bytes_req_(NULL)
+{
+    QFileInfo info(local_path);
+    file_name_ = info.fileName();
+    total_bytes_ = info.size();
+}
+
+FileUploader::~FileUploader()
+{
+    abortReplies();
+    releaseRequests();
+}
+
+void FileUploader::setParallelChunks(int parallel_chunks)
+{
+    parallel_chunks_ = qBound(1, parallel_chunks, kMaxParallelChunks);
+}
+
+void FileUploader::start()
+{
+    if (running_) {
+        return;
+    }
+
+    QFileInfo info(local_path_);
+    if (!info.isFile() || !info.isReadable()) {
+        fail(tr("Can't read %1").arg(local_path_));
+        return;
+    }
+    total_bytes_ = info.size();
+
+    running_ = true;
+    rate_.start();
+
+    // Links expire, ask for a new one every time
+    releaseRequests();
+    link_req_ = new GetUploadLinkRequest(account_, repo_id_);
+    connect(link_req_, SIGNAL(success(const QString&)),
+            this, SLOT(onUploadLink(const QString&)));
+    connect(link_req_, SIGNAL(failed(int)), this, SLOT(onUploadLinkFailed(int)));
+    link_req_->send();
+}
+
+void FileUploader::cancel()
+{
+    abortReplies();
+    releaseRequests();
+    queue_.clear();
+    running_ = false;
+}
+
+void FileUploader::onUploadLink(const QString& link)
+{
+    upload_link_ = QUrl(link);
+
+    uploaded_bytes_req_ = new GetUploadedBytesRequest(account_, repo_id_,
+                                                      parent_dir_, file_name_);
+    connect(uploaded_bytes_req_, SIGNAL(success(qint64)),
+            this, SLOT(onUploadedBytes(qint64)));
+    connect(uploaded_bytes_req_, SIGNAL(failed(int)),
+            this, SLOT(onUploadedBytesFailed(int)));
+    uploaded_bytes_req_->send();
+}
+
+void FileUploader::onUploadLinkFailed(int code)
+{
+    fail(tr("Failed to get an upload link (error code %1)").arg(code));
+}
+
+void FileUploader::onUploadedBytes(qint64 uploaded_bytes)
+{
+    startChunks(uploaded_bytes);
+}
+
+void FileUploader::onUploadedBytesFailed(int code)
+{
+    // Servers without resumable upload know nothing about it
+    qDebug("failed to get the uploaded bytes of %s: %d, uploading it all\n",
+           toCStr(file_name_), code);
+    startChunks(0);
+}
+
+void FileUploader::startChunks(qint64 uploaded_bytes)
+{
+    if (uploaded_bytes < 0 || uploaded_bytes >= total_bytes_) {
+        uploaded_bytes = 0;
+    }
+
+    if (uploaded_bytes > 0) {
+        qDebug("resume uploading %s from %lld bytes\n",
+               toCStr(file_name_), (long long)uploaded_bytes);
+    }
+
+    done_bytes_ = uploaded_bytes;
+    chunks_.clear();
+    queue_.clear();
+
+    qint64 offset = uploaded_bytes;
+    do {
+        Chunk chunk;
+        chunk.offset = offset;
+        chunk.length = qMin(chunk_size_, total_bytes_ - offset);
+        chunk.sent = 0;
+        chunk.retries = 0;
+        chunk.done = false;
+        queue_.append(chunks_.size());
+        chunks_.push_back(chunk);
+        offset += chunk.length;
+    } while (offset < total_bytes_);
+
+    recordProgress();
+    sendChunks();
+}
+
+void FileUploader::sendChunks()
+{
+    if (!running_) {
+        return;
+    }
+
+    const int last = chunks_.size() - 1;
+    while (!queue_.isEmpty() && replies_.size() < parallel_chunks_) {
+        // The last chunk completes the file
+        if (queue_.first() == last && (queue_.size() > 1 || !replies_.isEmpty())) {
+            if (queue_.size() == 1) {
+                return;
+            }
+            queue_.move(0, queue_.size() - 1);
+            continue;
+        }
+
+        sendChunk(queue_.takeFirst());
+    }
+}
+
+void FileUploader::sendChunk(int index)
+{
+    Chunk& chunk = chunks_[index];
+
+    QByteArray head = formField("parent_dir", parent_dir_.toUtf8())
+        + "--" + kBoundary + "\r\n"
+        + "Content-Disposition: form-data; name=\"file\"; filename=\""
+        + file_name_.toUtf8() + "\"\r\n"
+        + "Content-Type: application/octet-stream\r\n\r\n";
+    QByteArray tail = QByteArray("\r\n--") + kBoundary + "--\r\n";
+
+    ChunkBodyDevice *body = new ChunkBodyDevice(local_path_, chunk.offset, chunk.length,
+                                                head, tail);
+    if (!body->open(QIODevice::ReadOnly)) {
+        QString error = body->errorString();
+        delete body;
+        fail(tr("Can't read %1: %2").arg(local_path_).arg(error));
+        return;
+    }
+
+    QNetworkRequest request(upload_link_);
+    request.setHeader(QNetworkRequest::ContentTypeHeader,
+                      QByteArray("multipart/form-data; boundary=") + kBoundary);
+    request.setHeader(QNetworkRequest::ContentLengthHeader, body->size());
+    if (total_bytes_ > 0) {
+        request.setRawHeader("Content-Range",
+                             QString("bytes %1-%2/%3")
+                             .arg(chunk.offset)
+                             .arg(chunk.offset + chunk.length - 1)
+                             .arg(total_bytes_).toUtf8());
+        request.setRawHeader("Content-Disposition",
+                             "attachment; filename=\"" + file_name_.toUtf8() + "\"");
+    }
+
+    QNetworkReply *reply = SeafileApiClient::networkAccessManager()->post(request, body);
+    body->setParent(reply);
+    replies_.insert(reply, index);
+
+    chunk.sent = 0;
+    chunk.timer.start();
+
+    connect(reply, SIGNAL(uploadProgress(qint64, qint64)),
+            this, SLOT(onChunkProgress(qint64, qint64)));
+    connect(reply, SIGNAL(finished()), this, SLOT(onChunkFinished()));
+    connect(reply, SIGNAL(sslErrors(const QList<QSslError>&)),
+            this, SLOT(onSslErrors(const QList<QSslError>&)));
+}
+
+// Servers with self-signed certificates work for uploads as for the api
+void FileUploader::onSslErrors(const QList<QSslError>& errors)
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (ignore_ssl_errors_) {
+        reply->ignoreSslErrors();
+    } else if (!errors.isEmpty()) {
+        qWarning("ssl error when uploading %s: %s\n",
+                 toCStr(file_name_), toCStr(errors[0].errorString()));
+    }
+}
+
+void FileUploader::onChunkProgress(qint64 sent, qint64 /* total */)
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!replies_.contains(reply)) {
+        return;
+    }
+
+    chunks_[replies_.value(reply)].sent = sent;
+    recordProgress();
+}
+
+void FileUploader::onChunkFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    if (!replies_.contains(reply)) {
+        return;
+    }
+
+    int index = replies_.take(reply);
+    Chunk& chunk = chunks_[index];
+    chunk.sent = 0;
+
+    int code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qint64 usecs = chunk.timer.nsecsElapsed() / 1000;
+    ApiStats::instance()->recordRequest(upload_link_, code,
+                                        chunk.length, usecs, usecs);
+
+    if (reply->error() != QNetworkReply::NoError || code / 100 != 2) {
+        QString error = reply->error() != QNetworkReply::NoError
+            ? reply->errorString() : tr("error code %1").arg(code);
+
+        if (chunk.retries >= kMaxChunkRetries || (code / 100) == 4) {
+            fail(tr("Failed to upload %1: %2").arg(file_name_).arg(error));
+            return;
+        }
+
+        chunk.retries++;
+        ApiStats::instance()->recordRetry(upload_link_);
+        qDebug("retry chunk %d of %s (%d/%d): %s\n", index, toCStr(file_name_),
+               chunk.retries, kMaxChunkRetries, toCStr(error));
+
+        queue_.prepend(index);
+        QTimer::singleShot(kChunkRetryDelay * chunk.retries, this, SLOT(sendChunks()));
+        return;
+    }
+
+    chunk.done = true;
+    done_bytes_ += chunk.length;
+    recordProgress();
+
+    if (queue_.isEmpty() && replies_.isEmpty()) {
+        running_ = false;
+        emit finished();
+        return;
+    }
+
+    sendChunks();
+}
+
+void FileUploader::fail(const QString& error)
+{
+    qWarning("upload of %s failed: %s\n", toCStr(local_path_), toCStr(error));
+
+    abortReplies();
+    releaseRequests();
+    queue_.clear();
+    running_ = false;
+
+    emit failed(error);
+}
+
+void FileUploader::abortReplies()
+{
+    QHash<QNetworkReply*, int> replies = replies_;
+    replies_.clear();
+
+    QHash<QNetworkReply*, int>::const_iterator it;
+    for (it = replies.begin(); it != replies.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+}
+
+void FileUploader::releaseRequests()
+{
+    if (link_req_) {
+        link_req_->deleteLater();
+        link_req_ = NULL;
+    }
+    if (uploaded_bytes_req_) {
+        uploaded_bytes_req_->deleteLater();
+        uploaded_bytes_req_ = NULL;
+    }
+}
+
+qint64 FileUploader::uploadedBytes() const
+{
+    qint64 bytes = done_bytes_;
+
+    QHash<QNetworkReply*, int>::const_iterator it;
+    for (it = replies_.begin(); it != replies_.end(); ++it) {
+        const Chunk& chunk = chunks_[it.value()];
+        bytes += qMin(chunk.sent, chunk.length);
+    }
+
+    return qMin(bytes, total_bytes_);
+}
+
+void FileUploader::recordProgress()
+{
+    qint64 uploaded = uploadedBytes();
+    rate_.record(uploaded);
+
+    emit progress(uploaded, total_bytes_);
+}
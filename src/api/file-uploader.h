@@ -0,0 +1,121 @@
+#ifndef SEAFILE_CLIENT_API_FILE_UPLOADER_H
+#define SEAFILE_CLIENT_API_FILE_UPLOADER_H
+
+#include <vector>
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+#include <QUrl>
+
+#include "account.h"
+#include "transfer-rate.h"
+
+class QNetworkReply;
+class QSslError;
+class GetUploadLinkRequest;
+class GetUploadedBytesRequest;
+
+/**
+ * Upload a file to a folder of a library over http, without syncing it.
+ *
+ * The file is streamed from disk in fixed size chunks, each sent as a range
+ * of the file ("Content-Range") to an upload link from the server. Several
+ * chunks may be in flight at once. The last chunk completes the file on the
+ * server, so it is sent after all the others have been received.
+ *
+ * A failed chunk is retried a few times. If it still fails the upload stops,
+ * and start() resumes it from what the server has received.
+ */
+class FileUploader : public QObject {
+    Q_OBJECT
+
+public:
+    FileUploader(const Account& account,
+                 const QString& repo_id,
+                 const QString& parent_dir,
+                 const QString& local_path,
+                 QObject *parent=0);
+    ~FileUploader();
+
+    void setChunkSize(qint64 chunk_size) { chunk_size_ = chunk_size; }
+    void setParallelChunks(int parallel_chunks);
+    // Like SeafileApiRequest, certificate errors are ignored by default
+    void setIgnoreSslErrors(bool ignore) { ignore_ssl_errors_ = ignore; }
+
+    // Start, or resume after failed()
+    void start();
+    void cancel();
+
+    bool isRunning() const { return running_; }
+
+    const QString& localPath() const { return local_path_; }
+    qint64 totalBytes() const { return total_bytes_; }
+    // Received by the server, and in flight
+    qint64 uploadedBytes() const;
+    // Bytes per second over the last few seconds
+    qint64 rate() const { return rate_.rate(); }
+
+signals:
+    void progress(qint64 uploaded, qint64 total);
+    void finished();
+    void failed(const QString& error);
+
+private slots:
+    void onUploadLink(const QString& link);
+    void onUploadLinkFailed(int code);
+    void onUploadedBytes(qint64 uploaded_bytes);
+    void onUploadedBytesFailed(int code);
+    void onChunkProgress(qint64 sent, qint64 total);
+    void onChunkFinished();
+    void onSslErrors(const QList<QSslError>& errors);
+    void sendChunks();
+
+private:
+    Q_DISABLE_COPY(FileUploader)
+
+    struct Chunk {
+        qint64 offset;
+        qint64 length;
+        // Body bytes sent so far, including the multipart head
+        qint64 sent;
+        int retries;
+        bool done;
+        QElapsedTimer timer;
+    };
+
+    void startChunks(qint64 uploaded_bytes);
+    void sendChunk(int index);
+    void fail(const QString& error);
+    void abortReplies();
+    void releaseRequests();
+    void recordProgress();
+
+    Account account_;
+    QString repo_id_;
+    QString parent_dir_;
+    QString local_path_;
+    QString file_name_;
+
+    qint64 chunk_size_;
+    int parallel_chunks_;
+    bool ignore_ssl_errors_;
+
+    bool running_;
+    qint64 total_bytes_;
+    // Received by the server
+    qint64 done_bytes_;
+
+    QUrl upload_link_;
+    GetUploadLinkRequest *link_req_;
+    GetUploadedBytesRequest *uploaded_bytes_req_;
+
+    std::vector<Chunk> chunks_;
+    // Indexes of the chunks to send, in order
+    QList<int> queue_;
+    QHash<QNetworkReply*, int> replies_;
+
+    TransferRate rate_;
+};
+
+#endif // SEAFILE_CLIENT_API_FILE_UPLOADER_H
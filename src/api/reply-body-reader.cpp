@@ -0,0 +1,132 @@
+#include <string.h>
+#include <QNetworkReply>
+
+#include "reply-body-reader.h"
+
+namespace {
+
+const int kGzipWindowBits = 15 + 16;
+const int kZlibWindowBits = 15;
+// Some servers send "deflate" without the zlib header
+const int kRawDeflateWindowBits = -15;
+
+} // namespace
+
+ReplyBodyReader::ReplyBodyReader(QNetworkReply *reply)
+    : reply_(reply),
+      encoding_(ENCODING_IDENTITY),
+      zstream_inited_(false),
+      raw_deflate_(false),
+      stream_end_(false),
+      eof_(false),
+      in_len_(0),
+      wire_bytes_(0),
+      decoded_bytes_(0)
+{
+    QByteArray encoding = reply->rawHeader("Content-Encoding").trimmed().toLower();
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        encoding_ = ENCODING_GZIP;
+    } else if (encoding == "deflate") {
+        encoding_ = ENCODING_DEFLATE;
+    }
+
+    if (encoding_ == ENCODING_IDENTITY) {
+        return;
+    }
+
+    memset(&zstream_, 0, sizeof(zstream_));
+    int bits = encoding_ == ENCODING_GZIP ? kGzipWindowBits : kZlibWindowBits;
+    if (inflateInit2(&zstream_, bits) != Z_OK) {
+        qWarning("failed to init zlib stream\n");
+        return;
+    }
+    zstream_inited_ = true;
+}
+
+ReplyBodyReader::~ReplyBodyReader()
+{
+    if (zstream_inited_) {
+        inflateEnd(&zstream_);
+    }
+}
+
+bool ReplyBodyReader::fillInput()
+{
+    qint64 n = reply_->read(in_buf_, sizeof(in_buf_));
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+
+    in_len_ = n;
+    wire_bytes_ += n;
+    zstream_.next_in = (Bytef *)in_buf_;
+    zstream_.avail_in = (uInt)n;
+    return true;
+}
+
+qint64 ReplyBodyReader::read(char *buf, qint64 len)
+{
+    if (encoding_ == ENCODING_IDENTITY) {
+        qint64 n = reply_->read(buf, len);
+        if (n <= 0) {
+            return 0;
+        }
+        wire_bytes_ += n;
+        decoded_bytes_ += n;
+        return n;
+    }
+
+    if (!zstream_inited_) {
+        return -1;
+    }
+
+    zstream_.next_out = (Bytef *)buf;
+    zstream_.avail_out = (uInt)len;
+
+    while (zstream_.avail_out == (uInt)len && !stream_end_) {
+        if (zstream_.avail_in == 0 && !fillInput()) {
+            break;
+        }
+
+        int ret = inflate(&zstream_, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            stream_end_ = true;
+        } else if (ret == Z_DATA_ERROR && encoding_ == ENCODING_DEFLATE
+                   && !raw_deflate_ && zstream_.total_out == 0
+                   && wire_bytes_ == in_len_) {
+            // Still at the first chunk, retry it as a raw deflate stream
+            raw_deflate_ = true;
+            inflateEnd(&zstream_);
+            memset(&zstream_, 0, sizeof(zstream_));
+            if (inflateInit2(&zstream_, kRawDeflateWindowBits) != Z_OK) {
+                zstream_inited_ = false;
+                return -1;
+            }
+            zstream_.next_in = (Bytef *)in_buf_;
+            zstream_.avail_in = (uInt)in_len_;
+            zstream_.next_out = (Bytef *)buf;
+            zstream_.avail_out = (uInt)len;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            qWarning("failed to inflate reply body: %s\n",
+                     zstream_.msg ? zstream_.msg : "unknown error");
+            return -1;
+        }
+    }
+
+    qint64 produced = len - zstream_.avail_out;
+    if (produced == 0 && eof_ && !stream_end_) {
+        qWarning("reply body is truncated\n");
+        return -1;
+    }
+
+    decoded_bytes_ += produced;
+    return produced;
+}
+
+size_t ReplyBodyReader::jsonLoadCallback(void *buffer, size_t buflen, void *data)
+{
+    ReplyBodyReader *reader = (ReplyBodyReader *)data;
+    qint64 n = reader->read((char *)buffer, buflen);
+    return n < 0 ? (size_t)-1 : (size_t)n;
+}
@@ -0,0 +1,58 @@
+#ifndef SEAFILE_CLIENT_API_REPLY_BODY_READER_H
+#define SEAFILE_CLIENT_API_REPLY_BODY_READER_H
+
+#include <QtGlobal>
+#include <zlib.h>
+
+class QNetworkReply;
+
+/**
+ * Reads the body of a finished reply in small pieces, inflating it on the
+ * fly when the server sent it with "Content-Encoding: gzip" or "deflate".
+ *
+ * It is used as the input callback of jansson, so the decoded body is never
+ * held in memory as a whole.
+ */
+class ReplyBodyReader {
+public:
+    explicit ReplyBodyReader(QNetworkReply *reply);
+    ~ReplyBodyReader();
+
+    // Returns the number of decoded bytes read, 0 at the end of the body,
+    // and -1 if the body can't be decoded
+    qint64 read(char *buf, qint64 len);
+
+    qint64 wireBytes() const { return wire_bytes_; }
+    qint64 decodedBytes() const { return decoded_bytes_; }
+
+    // json_load_callback_t
+    static size_t jsonLoadCallback(void *buffer, size_t buflen, void *data);
+
+private:
+    Q_DISABLE_COPY(ReplyBodyReader)
+
+    enum Encoding {
+        ENCODING_IDENTITY,
+        ENCODING_GZIP,
+        ENCODING_DEFLATE
+    };
+
+    bool fillInput();
+
+    QNetworkReply *reply_;
+    Encoding encoding_;
+
+    z_stream zstream_;
+    bool zstream_inited_;
+    bool raw_deflate_;
+    bool stream_end_;
+    bool eof_;
+
+    char in_buf_[16 * 1024];
+    qint64 in_len_;
+
+    qint64 wire_bytes_;
+    qint64 decoded_bytes_;
+};
+
+#endif // SEAFILE_CLIENT_API_REPLY_BODY_READER_H
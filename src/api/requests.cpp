@@ -8,6 +8,7 @@
 #include "utils/utils.h"
 #include "requests.h"
 #include "server-repo.h"
+#include "server-dirent.h"
 
 namespace {
 
@@ -15,6 +16,53 @@ const char *kApiLoginUrl = "/api2/auth-token/";
 const char *kListReposUrl = "/api2/repos/";
 const char *kCreateRepoUrl = "/api2/repos/";
 const char *kMessagesCountUrl = "/api2/msgs_count/";
+const char *kRepoTypeMine = "mine";
+const char *kGetDirentsUrl = "/api2/repos/%1/dir/";
+const char *kGetUploadLinkUrl = "/api2/repos/%1/upload-link/";
+const char *kGetUploadedBytesUrl = "/api2/repos/%1/file-uploaded-bytes/";
+const char *kGetFileDownloadLinkUrl = "/api2/repos/%1/file/";
+
+QUrl listReposUrl(const Account& account, const QString& type)
+{
+    QUrl url(account.serverUrl.toString() + kListReposUrl);
+    if (!type.isEmpty()) {
+        url.addQueryItem("type", type);
+    }
+    return url;
+}
+
+QUrl getDirentsUrl(const Account& account, const QString& repo_id, const QString& path)
+{
+    QUrl url(account.serverUrl.toString() + QString(kGetDirentsUrl).arg(repo_id));
+    url.addQueryItem("p", path);
+    return url;
+}
+
+QUrl getUploadedBytesUrl(const Account& account,
+                         const QString& repo_id,
+                         const QString& parent_dir,
+                         const QString& file_name)
+{
+    QUrl url(account.serverUrl.toString() + QString(kGetUploadedBytesUrl).arg(repo_id));
+    url.addQueryItem("parent_dir", parent_dir);
+    url.addQueryItem("file_name", file_name);
+    return url;
+}
+
+QUrl getFileDownloadLinkUrl(const Account& account,
+                            const QString& repo_id,
+                            const QString& path)
+{
+    QUrl url(account.serverUrl.toString() + QString(kGetFileDownloadLinkUrl).arg(repo_id));
+    url.addQueryItem("p", path);
+    return url;
+}
+
+// Links are sent as a bare json string
+QString linkFromJSON(const json_t *json)
+{
+    return json_is_string(json) ? QString::fromUtf8(json_string_value(json)) : QString();
+}
 
 } // namespace
 
@@ -61,9 +109,11 @@ void LoginRequest::requestSuccess(QNetworkReply& reply)
 /**
  * ListReposRequest
  */
-ListReposRequest::ListReposRequest(const Account& account)
-    : SeafileApiRequest (QUrl(account.serverUrl.toString() + kListReposUrl),
-                         SeafileApiRequest::METHOD_GET, account.token)
+ListReposRequest::ListReposRequest(const Account& account, const QString& type)
+    : SeafileApiRequest (listReposUrl(account, type),
+                         SeafileApiRequest::METHOD_GET, account.token),
+      account_(account),
+      type_(type)
 {
 }
 
@@ -80,6 +130,18 @@ void ListReposRequest::requestSuccess(QNetworkReply& reply)
     QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
 
     std::vector<ServerRepo> repos = ServerRepo::listFromJSON(json.data(), &error);
+
+    if (type_ == kRepoTypeMine) {
+        // Servers not knowing the filter return all the repos
+        std::vector<ServerRepo> mine;
+        for (size_t i = 0; i < repos.size(); i++) {
+            if (repos[i].isPersonalRepo()) {
+                mine.push_back(repos[i]);
+            }
+        }
+        repos.swap(mine);
+    }
+
     emit success(repos);
 }
 
@@ -90,6 +152,7 @@ void ListReposRequest::requestSuccess(QNetworkReply& reply)
 DownloadRepoRequest::DownloadRepoRequest(const Account& account, const ServerRepo& repo)
     : SeafileApiRequest(QUrl(account.serverUrl.toString() + "/api2/repos/" + repo.id + "/download-info/"),
                         SeafileApiRequest::METHOD_GET, account.token),
+      account_(account),
       repo_(repo)
 {
 }
@@ -197,3 +260,123 @@ void GetSeahubMessagesRequest::requestSuccess(QNetworkReply& reply)
     int personal_messages = ret.value("personal_messages").toInt();
     emit success(group_messages, personal_messages);
 }
+
+/**
+ * GetDirentsRequest
+ */
+GetDirentsRequest::GetDirentsRequest(const Account& account,
+                                     const QString& repo_id,
+                                     const QString& path)
+    : SeafileApiRequest (getDirentsUrl(account, repo_id, path),
+                         SeafileApiRequest::METHOD_GET, account.token),
+      repo_id_(repo_id),
+      path_(path)
+{
+}
+
+void GetDirentsRequest::requestSuccess(QNetworkReply& reply)
+{
+    json_error_t error;
+    json_t *root = parseJSON(reply, &error);
+    if (!root) {
+        qDebug("GetDirentsRequest: failed to parse json:%s\n", error.text);
+        emit failed(0);
+        return;
+    }
+
+    QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
+
+    std::vector<ServerDirent> dirents = ServerDirent::listFromJSON(json.data(), &error);
+
+    QString dir_id = QString::fromUtf8(reply.rawHeader("oid"));
+    emit success(dir_id, dirents);
+}
+
+/**
+ * GetUploadLinkRequest
+ */
+GetUploadLinkRequest::GetUploadLinkRequest(const Account& account, const QString& repo_id)
+    : SeafileApiRequest (QUrl(account.serverUrl.toString() + QString(kGetUploadLinkUrl).arg(repo_id)),
+                         SeafileApiRequest::METHOD_GET, account.token)
+{
+}
+
+void GetUploadLinkRequest::requestSuccess(QNetworkReply& reply)
+{
+    json_error_t error;
+    json_t *root = parseJSON(reply, &error, JSON_DECODE_ANY);
+    if (!root) {
+        qDebug("GetUploadLinkRequest: failed to parse json:%s\n", error.text);
+        emit failed(0);
+        return;
+    }
+
+    QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
+
+    QString link = linkFromJSON(json.data());
+    if (link.isEmpty()) {
+        emit failed(0);
+        return;
+    }
+
+    emit success(link);
+}
+
+/**
+ * GetUploadedBytesRequest
+ */
+GetUploadedBytesRequest::GetUploadedBytesRequest(const Account& account,
+                                                 const QString& repo_id,
+                                                 const QString& parent_dir,
+                                                 const QString& file_name)
+    : SeafileApiRequest (getUploadedBytesUrl(account, repo_id, parent_dir, file_name),
+                         SeafileApiRequest::METHOD_GET, account.token)
+{
+}
+
+void GetUploadedBytesRequest::requestSuccess(QNetworkReply& reply)
+{
+    json_error_t error;
+    json_t *root = parseJSON(reply, &error);
+    if (!root) {
+        qDebug("GetUploadedBytesRequest: failed to parse json:%s\n", error.text);
+        emit failed(0);
+        return;
+    }
+
+    QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
+
+    emit success(json_integer_value(json_object_get(json.data(), "uploadedBytes")));
+}
+
+/**
+ * GetFileDownloadLinkRequest
+ */
+GetFileDownloadLinkRequest::GetFileDownloadLinkRequest(const Account& account,
+                                                       const QString& repo_id,
+                                                       const QString& path)
+    : SeafileApiRequest (getFileDownloadLinkUrl(account, repo_id, path),
+                         SeafileApiRequest::METHOD_GET, account.token)
+{
+}
+
+void GetFileDownloadLinkRequest::requestSuccess(QNetworkReply& reply)
+{
+    json_error_t error;
+    json_t *root = parseJSON(reply, &error, JSON_DECODE_ANY);
+    if (!root) {
+        qDebug("GetFileDownloadLinkRequest: failed to parse json:%s\n", error.text);
+        emit failed(0);
+        return;
+    }
+
+    QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
+
+    QString link = linkFromJSON(json.data());
+    if (link.isEmpty()) {
+        emit failed(0);
+        return;
+    }
+
+    emit success(link);
+}
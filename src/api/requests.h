@@ -4,13 +4,14 @@
 #include <vector>
 #include <QMap>
 
+#include "account.h"
 #include "api-request.h"
 #include "server-repo.h"
+#include "server-dirent.h"
 
 class QNetworkReply;
 
 class ServerRepo;
-struct Account;
 
 class LoginRequest : public SeafileApiRequest {
     Q_OBJECT
@@ -35,7 +36,14 @@ class ListReposRequest : public SeafileApiRequest {
     Q_OBJECT
 
 public:
-    explicit ListReposRequest(const Account& account);
+    /**
+     * List all the repos of the account, or only those of one type when the
+     * server supports it, e.g. "mine" for the repos owned by the user
+     */
+    explicit ListReposRequest(const Account& account, const QString& type=QString());
+
+    const Account& account() const { return account_; }
+    const QString& type() const { return type_; }
 
 protected slots:
     void requestSuccess(QNetworkReply& reply);
@@ -45,6 +53,9 @@ signals:
 
 private:
     Q_DISABLE_COPY(ListReposRequest)
+
+    Account account_;
+    QString type_;
 };
 
 
@@ -71,6 +82,9 @@ class DownloadRepoRequest : public SeafileApiRequest {
 public:
     explicit DownloadRepoRequest(const Account& account, const ServerRepo& repo);
 
+    const Account& account() const { return account_; }
+    const ServerRepo& repo() const { return repo_; }
+
 protected slots:
     void requestSuccess(QNetworkReply& reply);
 
@@ -80,6 +94,7 @@ signals:
 private:
     Q_DISABLE_COPY(DownloadRepoRequest)
 
+    Account account_;
     ServerRepo repo_;
 };
 
@@ -117,4 +132,93 @@ private:
 
 };
 
+/**
+ * List one folder of a library
+ */
+class GetDirentsRequest : public SeafileApiRequest {
+    Q_OBJECT
+
+public:
+    GetDirentsRequest(const Account& account, const QString& repo_id, const QString& path);
+
+    const QString& repoId() const { return repo_id_; }
+    const QString& path() const { return path_; }
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+signals:
+    // dir_id is the id of the folder object, it changes with its content
+    void success(const QString& dir_id, const std::vector<ServerDirent>& dirents);
+
+private:
+    Q_DISABLE_COPY(GetDirentsRequest)
+
+    QString repo_id_;
+    QString path_;
+};
+
+/**
+ * Get a link to upload files to a library over http, see FileUploader
+ */
+class GetUploadLinkRequest : public SeafileApiRequest {
+    Q_OBJECT
+
+public:
+    GetUploadLinkRequest(const Account& account, const QString& repo_id);
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+signals:
+    void success(const QString& link);
+
+private:
+    Q_DISABLE_COPY(GetUploadLinkRequest)
+};
+
+/**
+ * How much of a file the server has received from an earlier, interrupted
+ * upload
+ */
+class GetUploadedBytesRequest : public SeafileApiRequest {
+    Q_OBJECT
+
+public:
+    GetUploadedBytesRequest(const Account& account,
+                            const QString& repo_id,
+                            const QString& parent_dir,
+                            const QString& file_name);
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+signals:
+    void success(qint64 uploaded_bytes);
+
+private:
+    Q_DISABLE_COPY(GetUploadedBytesRequest)
+};
+
+/**
+ * Get a link to download one file of a library over http, see FileDownloader
+ */
+class GetFileDownloadLinkRequest : public SeafileApiRequest {
+    Q_OBJECT
+
+public:
+    GetFileDownloadLinkRequest(const Account& account,
+                               const QString& repo_id,
+                               const QString& path);
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+signals:
+    void success(const QString& link);
+
+private:
+    Q_DISABLE_COPY(GetFileDownloadLinkRequest)
+};
+
 #endif // SEAFILE_CLIENT_API_REQUESTS_H
@@ -0,0 +1,40 @@
+#include <vector>
+#include <jansson.h>
+
+#include "server-dirent.h"
+
+namespace {
+
+QString getStringFromJson(const json_t *json, const char* key)
+{
+    return QString::fromUtf8(json_string_value(json_object_get(json, key)));
+}
+
+} // namespace
+
+
+ServerDirent ServerDirent::fromJSON(const json_t *json, json_error_t */* error */)
+{
+    ServerDirent dirent;
+    dirent.id = getStringFromJson(json, "id");
+    dirent.name = getStringFromJson(json, "name");
+
+    dirent.type = getStringFromJson(json, "type") == "dir" ? DIR : FILE;
+
+    dirent.size = json_integer_value(json_object_get(json, "size"));
+    dirent.mtime = json_integer_value(json_object_get(json, "mtime"));
+
+    return dirent;
+}
+
+std::vector<ServerDirent> ServerDirent::listFromJSON(const json_t *json, json_error_t *error)
+{
+    std::vector<ServerDirent> dirents;
+    size_t n = json_array_size(json);
+    dirents.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        dirents.push_back(fromJSON(json_array_get(json, i), error));
+    }
+
+    return dirents;
+}
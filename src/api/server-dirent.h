@@ -0,0 +1,35 @@
+#ifndef SEAFILE_CLIENT_SERVER_DIRENT_H
+#define SEAFILE_CLIENT_SERVER_DIRENT_H
+
+#include <vector>
+#include <QString>
+#include <QMetaType>
+#include <jansson.h>
+
+/**
+ * A file or folder in a library, from the seahub dir api
+ */
+class ServerDirent {
+public:
+    enum Type {
+        FILE,
+        DIR
+    };
+
+    ServerDirent() : type(FILE), size(0), mtime(0) {}
+
+    Type type;
+    QString id;
+    QString name;
+    qint64 size;
+    qint64 mtime;
+
+    bool isDir() const { return type == DIR; }
+
+    static ServerDirent fromJSON(const json_t*, json_error_t *error);
+    static std::vector<ServerDirent> listFromJSON(const json_t*, json_error_t *json);
+};
+
+Q_DECLARE_METATYPE(ServerDirent)
+
+#endif // SEAFILE_CLIENT_SERVER_DIRENT_H
@@ -0,0 +1,43 @@
+#include "transfer-rate.h"
+
+namespace {
+
+const qint64 kRateWindow = 5 * 1000; // 5 sec
+
+} // namespace
+
+TransferRate::TransferRate()
+{
+    clock_.start();
+}
+
+void TransferRate::start()
+{
+    samples_.clear();
+    clock_.start();
+}
+
+void TransferRate::record(qint64 bytes)
+{
+    qint64 now = clock_.elapsed();
+
+    samples_.append(qMakePair(now, bytes));
+    while (samples_.size() > 2 && now - samples_.first().first > kRateWindow) {
+        samples_.removeFirst();
+    }
+}
+
+qint64 TransferRate::rate() const
+{
+    if (samples_.size() < 2) {
+        return 0;
+    }
+
+    qint64 msecs = samples_.last().first - samples_.first().first;
+    qint64 bytes = samples_.last().second - samples_.first().second;
+    if (msecs <= 0 || bytes <= 0) {
+        return 0;
+    }
+
+    return bytes * 1000 / msecs;
+}
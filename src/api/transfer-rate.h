@@ -0,0 +1,28 @@
+#ifndef SEAFILE_CLIENT_API_TRANSFER_RATE_H
+#define SEAFILE_CLIENT_API_TRANSFER_RATE_H
+
+#include <QList>
+#include <QPair>
+#include <QElapsedTimer>
+
+/**
+ * Throughput of a transfer over the last few seconds
+ */
+class TransferRate {
+public:
+    TransferRate();
+
+    void start();
+    // Total bytes transferred so far
+    void record(qint64 bytes);
+
+    // Bytes per second
+    qint64 rate() const;
+
+private:
+    QElapsedTimer clock_;
+    // (msecs, bytes)
+    QList<QPair<qint64, qint64> > samples_;
+};
+
+#endif // SEAFILE_CLIENT_API_TRANSFER_RATE_H
@@ -6,6 +6,7 @@
 #include <QLibraryInfo>
 #include <QWidget>
 #include <QDir>
+#include <QDateTime>
 
 #include <glib-object.h>
 #include <stdio.h>
@@ -91,6 +92,10 @@ int main(int argc, char *argv[])
     g_thread_init(NULL);
 #endif
 
+    // Api request retries use qrand() for jitter, so clients must not share
+    // the same sequence
+    qsrand(QDateTime::currentDateTime().toTime_t() ^ QCoreApplication::applicationPid());
+
     awesome = new QtAwesome(qApp);
     awesome->initFontAwesome();
 
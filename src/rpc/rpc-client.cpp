@@ -58,8 +58,9 @@ int SeafileRpcClient::listLocalRepos(std::vector<LocalRepo> *result)
 {
     GError *error = NULL;
     GList *repos = seafile_get_repo_list(seafile_rpc_client_, 0, 0, &error);
-    if (repos == NULL) {
+    if (error) {
         qWarning("failed to get repo list: %s\n", error->message);
+        g_error_free(error);
         return -1;
     }
 
@@ -73,6 +74,41 @@ int SeafileRpcClient::listLocalRepos(std::vector<LocalRepo> *result)
     return 0;
 }
 
+int SeafileRpcClient::listAccountRepos(const QString& server_addr,
+                                       const QString& email,
+                                       std::vector<LocalRepo> *result)
+{
+    std::vector<LocalRepo> repos;
+    if (listLocalRepos(&repos) < 0) {
+        return -1;
+    }
+
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        const LocalRepo& repo = repos[i];
+        if (!repo_accounts_.contains(repo.id)) {
+            QString repo_email, relay_addr;
+            if (getRepoProperty(repo.id, "email", &repo_email) < 0
+                || getRepoProperty(repo.id, "relay-address", &relay_addr) < 0) {
+                continue;
+            }
+            repo_accounts_.insert(repo.id, qMakePair(repo_email, relay_addr));
+        }
+
+        const QPair<QString, QString>& account = repo_accounts_[repo.id];
+        if (account.first == email && account.second == server_addr) {
+            result->push_back(repo);
+        }
+    }
+
+    return 0;
+}
+
+// The repo may be synced again, with another account
+void SeafileRpcClient::forgetRepoAccount(const QString& repo_id)
+{
+    repo_accounts_.remove(repo_id);
+}
+
 int SeafileRpcClient::setAutoSync(bool autoSync)
 {
     GError *error = NULL;
@@ -99,6 +135,8 @@ int SeafileRpcClient::downloadRepo(const QString &id, const QString &relayId,
                                    const QString& random_key, int enc_version,
                                    QString *error_ret)
 {
+    forgetRepoAccount(id);
+
     GError *error = NULL;
     searpc_client_call__string(
         seafile_rpc_client_,
@@ -135,6 +173,8 @@ int SeafileRpcClient::cloneRepo(const QString &id, const QString &relayId,
                                 const QString& random_key, int enc_version,
                                 QString *error_ret)
 {
+    forgetRepoAccount(id);
+
     GError *error = NULL;
     searpc_client_call__string(
         seafile_rpc_client_,
@@ -188,6 +228,24 @@ int SeafileRpcClient::getLocalRepo(const QString& repo_id, LocalRepo *repo)
     return 0;
 }
 
+int SeafileRpcClient::getRepoProperty(const QString& repo_id,
+                                      const QString& name,
+                                      QString *value)
+{
+    GError *error = NULL;
+    char *ret = searpc_client_call__string (seafile_rpc_client_,
+                                            "seafile_get_repo_property", &error,
+                                            2, "string", toCStr(repo_id),
+                                            "string", toCStr(name));
+    if (error) {
+        g_error_free(error);
+        return -1;
+    }
+    *value = QString::fromUtf8(ret);
+    g_free(ret);
+    return 0;
+}
+
 int SeafileRpcClient::ccnetGetConfig(const QString &key, QString *value)
 {
     GError *error = NULL;
@@ -519,6 +577,8 @@ int SeafileRpcClient::unsyncReposByAccount(const QString& server_addr,
                                            const QString& email,
                                            QString *err)
 {
+    repo_accounts_.clear();
+
     GError *error = NULL;
     int ret =  searpc_client_call__int (seafile_rpc_client_,
                                         "seafile_unsync_repos_by_account",
@@ -568,24 +628,40 @@ int SeafileRpcClient::getUploadRate(int *rate)
 }
 
 
-void SeafileRpcClient::setRepoAutoSync(const QString& repo_id, bool auto_sync)
+int SeafileRpcClient::setRepoAutoSync(const QString& repo_id, bool auto_sync)
 {
     GError *error = NULL;
-    searpc_client_call__int(seafile_rpc_client_,
-                            "seafile_set_repo_property",
-                            &error, 3,
-                            "string", toCStr(repo_id),
-                            "string", "auto-sync",
-                            "string", auto_sync ? "true" : "false");
+    int ret = searpc_client_call__int(seafile_rpc_client_,
+                                      "seafile_set_repo_property",
+                                      &error, 3,
+                                      "string", toCStr(repo_id),
+                                      "string", "auto-sync",
+                                      "string", auto_sync ? "true" : "false");
+    if (error) {
+        qWarning("failed to set auto sync of repo %s: %s\n", toCStr(repo_id), error->message);
+        g_error_free(error);
+        return -1;
+    }
+
+    return ret;
 }
 
 int SeafileRpcClient::unsync(const QString& repo_id)
 {
+    forgetRepoAccount(repo_id);
+
     GError *error = NULL;
-    return searpc_client_call__int(seafile_rpc_client_,
-                                   "seafile_destroy_repo",
-                                   &error, 1,
-                                   "string", toCStr(repo_id));
+    int ret = searpc_client_call__int(seafile_rpc_client_,
+                                      "seafile_destroy_repo",
+                                      &error, 1,
+                                      "string", toCStr(repo_id));
+    if (error) {
+        qWarning("failed to unsync repo %s: %s\n", toCStr(repo_id), error->message);
+        g_error_free(error);
+        return -1;
+    }
+
+    return ret;
 }
 
 int SeafileRpcClient::getRepoTransferInfo(const QString& repo_id, int *rate, int *percent)
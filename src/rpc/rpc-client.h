@@ -2,6 +2,9 @@
 #define SEAFILE_CLIENT_RPC_CLIENT_H
 
 #include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QString>
 #include <vector>
 
 extern "C" {
@@ -24,7 +27,16 @@ public:
     void connectDaemon();
 
     int listLocalRepos(std::vector<LocalRepo> *repos);
+    /**
+     * The repos synced with the account on that server, see
+     * unsyncReposByAccount. The account of a repo is only asked for the
+     * first time the repo is seen, so this is one rpc call after that.
+     */
+    int listAccountRepos(const QString& server_addr, const QString& email,
+                         std::vector<LocalRepo> *repos);
     int getLocalRepo(const QString& repo_id, LocalRepo *repo);
+    // e.g. "email" and "relay-address" of the account the repo is synced with
+    int getRepoProperty(const QString& repo_id, const QString& name, QString *value);
     int setAutoSync(const bool autoSync);
     int downloadRepo(const QString& id, const QString& relayId,
                      const QString& name, const QString& wt,
@@ -62,7 +74,7 @@ public:
 
     int getRepoTransferInfo(const QString& repo_id, int *rate, int *percent);
 
-    void setRepoAutoSync(const QString& repo_id, bool auto_sync);
+    int setRepoAutoSync(const QString& repo_id, bool auto_sync);
     int unsync(const QString& repo_id);
 
     int setUploadRateLimit(int limit);
@@ -80,11 +92,16 @@ private:
     void getTransferDetail(CloneTask* task);
     void getCheckOutDetail(CloneTask* task);
     int setRateLimit(bool upload, int limit);
+    void forgetRepoAccount(const QString& repo_id);
 
 
     _CcnetClient *sync_client_;
     SearpcClient *seafile_rpc_client_;
     SearpcClient *ccnet_rpc_client_;
+
+    // Repo id => ("email", "relay-address") of the account it is synced
+    // with, which only change when the repo is unsynced
+    QHash<QString, QPair<QString, QString> > repo_accounts_;
 };
 
 #endif
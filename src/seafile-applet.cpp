@@ -119,6 +119,8 @@ void SeafileApplet::exit(int code)
     // Must use the global namespace, or the "exit" would call itself util
     // stack overflow
     daemon_mgr_->stopAll();
+    // Write the account changes not yet on disk
+    account_mgr_->stop();
     // Remove tray icon from system tray
     delete tray_icon_;
     if (main_win_) {
@@ -2,15 +2,21 @@
 #include <QTimer>
 #include <QUrl>
 #include <QDesktopServices>
+#include <QNetworkConfigurationManager>
 
 #include "QtAwesome.h"
 #include "ui/cloud-view.h"
 #include "api/requests.h"
+#include "api/api-cache.h"
 #include "seahub-messages-monitor.h"
 
 namespace {
 
-const int kRefreshSeahubMessagesInterval = 1000 * 60; // 1min
+const int kMinRefreshInterval = 1000 * 30; // 30 sec
+const int kDefaultRefreshInterval = 1000 * 60; // 1min
+const int kMaxRefreshInterval = 1000 * 60 * 5; // 5 min
+// Used while the main window is hidden
+const int kHiddenRefreshInterval = 1000 * 60 * 15; // 15 min
 const char *kPersonalMessagesPath = "/message/list/";
 
 
@@ -18,10 +24,13 @@ const char *kPersonalMessagesPath = "/message/list/";
 
 SeahubMessagesMonitor::SeahubMessagesMonitor(CloudView *cloud_view, QObject *parent)
     : QObject(parent),
+      req_(0),
       cloud_view_(cloud_view),
       group_messages_(0),
       personal_messages_(0),
-      req_(0)
+      online_(true),
+      window_visible_(false),
+      interval_(kDefaultRefreshInterval)
 {
     btn_ = cloud_view->seahubMessagesBtn();
 
@@ -30,9 +39,17 @@ SeahubMessagesMonitor::SeahubMessagesMonitor(CloudView *cloud_view, QObject *par
     connect(btn_, SIGNAL(clicked()), this, SLOT(onBtnClicked()));
 
     refresh_timer_ = new QTimer(this);
-    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+    refresh_timer_->setSingleShot(true);
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(poll()));
 
-    refresh_timer_->start(kRefreshSeahubMessagesInterval);
+    network_mgr_ = new QNetworkConfigurationManager(this);
+    // Without a bearer plugin there are no configurations and isOnline()
+    // is always false
+    online_ = network_mgr_->isOnline() || network_mgr_->allConfigurations().isEmpty();
+    connect(network_mgr_, SIGNAL(onlineStateChanged(bool)),
+            this, SLOT(onOnlineStateChanged(bool)));
+
+    scheduleNextPoll();
 }
 
 void SeahubMessagesMonitor::resetStatus()
@@ -42,22 +59,104 @@ void SeahubMessagesMonitor::resetStatus()
 
 void SeahubMessagesMonitor::refresh()
 {
+    interval_ = kDefaultRefreshInterval;
+    group_messages_ = 0;
+    personal_messages_ = 0;
+    poll();
+}
+
+void SeahubMessagesMonitor::poll()
+{
+    refresh_timer_->stop();
+
     const Account& account = cloud_view_->currentAccount();
     if (!account.isValid()) {
+        releaseRequest();
         resetStatus();
         return;
     }
 
+    // Resumed by onOnlineStateChanged
+    if (!online_) {
+        return;
+    }
+
+    releaseRequest();
+
+    // Fetched ahead by the login dialog
+    int group_messages, personal_messages;
+    if (ApiCache::instance()->takeMessagesCount(account, &group_messages, &personal_messages)) {
+        last_poll_.start();
+        onRequestSuccess(group_messages, personal_messages);
+        return;
+    }
+
     req_ = new GetSeahubMessagesRequest(account);
 
     connect(req_, SIGNAL(success(int, int)),
             this, SLOT(onRequestSuccess(int, int)));
+    connect(req_, SIGNAL(failed(int)), this, SLOT(onRequestFailed()));
 
+    last_poll_.start();
     req_->send();
 }
 
+void SeahubMessagesMonitor::releaseRequest()
+{
+    if (req_) {
+        req_->deleteLater();
+        req_ = 0;
+    }
+}
+
+void SeahubMessagesMonitor::scheduleNextPoll()
+{
+    if (!online_ || req_) {
+        return;
+    }
+
+    int interval = window_visible_ ? interval_ : kHiddenRefreshInterval;
+    int elapsed = last_poll_.isValid() ? last_poll_.elapsed() : 0;
+    refresh_timer_->start(qMax(0, interval - elapsed));
+}
+
+void SeahubMessagesMonitor::setWindowVisible(bool visible)
+{
+    if (window_visible_ == visible) {
+        return;
+    }
+    window_visible_ = visible;
+
+    // A window shown again after a long time is checked at once
+    scheduleNextPoll();
+}
+
+void SeahubMessagesMonitor::onOnlineStateChanged(bool online)
+{
+    online_ = online;
+    if (online) {
+        poll();
+    } else {
+        refresh_timer_->stop();
+    }
+}
+
+void SeahubMessagesMonitor::onRequestFailed()
+{
+    releaseRequest();
+
+    interval_ = qMin(interval_ * 2, kMaxRefreshInterval);
+    scheduleNextPoll();
+}
+
 void SeahubMessagesMonitor::onRequestSuccess(int group_messages, int personal_messages)
 {
+    releaseRequest();
+
+    bool changed = group_messages != group_messages_ || personal_messages != personal_messages_;
+    interval_ = changed ? kMinRefreshInterval : qMin(interval_ * 2, kMaxRefreshInterval);
+    scheduleNextPoll();
+
     QString tip;
     group_messages_ = group_messages;
     personal_messages_ = personal_messages;
@@ -94,4 +193,8 @@ void SeahubMessagesMonitor::onBtnClicked()
     QDesktopServices::openUrl(url);
 
     resetStatus();
+
+    // The user is reading the messages, the count is about to change
+    interval_ = kMinRefreshInterval;
+    scheduleNextPoll();
 }
@@ -2,28 +2,45 @@
 #define SEAFILE_CLIENT_SEAHUB_MESSAGES_MONITOR_
 
 #include <QObject>
+#include <QElapsedTimer>
 
 class QToolButton;
 class QTimer;
+class QNetworkConfigurationManager;
 
 class CloudView;
 class GetSeahubMessagesRequest;
 
+/**
+ * Polls the unread messages count of the current account.
+ *
+ * The interval grows while the count stays the same and shrinks again when
+ * it changes. Polling slows down while the main window is hidden and stops
+ * while the machine is offline.
+ */
 class SeahubMessagesMonitor : public QObject
 {
     Q_OBJECT
 public:
     SeahubMessagesMonitor(CloudView *cloud_view, QObject *parent=0);
 
+    void setWindowVisible(bool visible);
+
 public slots:
+    // Check now, e.g. after switching to another account
     void refresh();
 
 private slots:
     void onBtnClicked();
     void onRequestSuccess(int, int);
+    void onRequestFailed();
+    void onOnlineStateChanged(bool online);
+    void poll();
 
 private:
     void resetStatus();
+    void scheduleNextPoll();
+    void releaseRequest();
 
     GetSeahubMessagesRequest *req_;
     CloudView *cloud_view_;
@@ -33,6 +50,12 @@ private:
 
     int group_messages_;
     int personal_messages_;
+
+    QNetworkConfigurationManager *network_mgr_;
+    bool online_;
+    bool window_visible_;
+    int interval_;
+    QElapsedTimer last_poll_;
 };
 
 #endif // SEAFILE_CLIENT_SEAHUB_MESSAGES_MONITOR_
@@ -0,0 +1,176 @@
+#include <QtGui>
+#include <QTimer>
+#include <QTableWidget>
+#include <QHeaderView>
+
+#include "api/api-stats.h"
+#include "api-diagnostics-dialog.h"
+
+namespace {
+
+const int kRefreshStatsInterval = 1000; // 1 sec
+
+enum {
+    COLUMN_SERVER = 0,
+    COLUMN_ENDPOINT,
+    COLUMN_REQUESTS,
+    COLUMN_RETRIES,
+    COLUMN_STATUS,
+    COLUMN_FIRST_BYTE,
+    COLUMN_TOTAL,
+    COLUMN_MAX_TOTAL,
+    COLUMN_PARSE,
+    COLUMN_BYTES_OUT,
+    COLUMN_BYTES_IN,
+    MAX_COLUMN
+};
+
+QString msecs(qint64 usecs, qint64 count)
+{
+    if (count <= 0) {
+        return "-";
+    }
+    return QString::number(usecs / count / 1000.0, 'f', 1);
+}
+
+QString kbytes(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0, 'f', 1);
+}
+
+// e.g. "200:31 500:2 0:1"
+QString statusSummary(const QMap<int, qint64>& counts)
+{
+    QStringList parts;
+    QMap<int, qint64>::const_iterator it;
+    for (it = counts.begin(); it != counts.end(); ++it) {
+        parts << QString("%1:%2").arg(it.key()).arg(it.value());
+    }
+    return parts.join(" ");
+}
+
+} // namespace
+
+ApiDiagnosticsDialog::ApiDiagnosticsDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle(tr("Web api diagnostics"));
+    setWindowIcon(QIcon(":/images/seafile.png"));
+    setMinimumSize(QSize(800, 300));
+
+    table_ = new QTableWidget(0, MAX_COLUMN);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table_->verticalHeader()->hide();
+    table_->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft);
+    table_->horizontalHeader()->setStretchLastSection(true);
+
+    QStringList headers;
+    headers << tr("Server") << tr("Endpoint") << tr("Requests") << tr("Retries")
+            << tr("Status") << tr("First byte (ms)") << tr("Total (ms)")
+            << tr("Max (ms)") << tr("Parse (ms)") << tr("Out (kB)") << tr("In (kB)");
+    table_->setHorizontalHeaderLabels(headers);
+
+    table_->horizontalHeaderItem(COLUMN_FIRST_BYTE)->setToolTip(
+        tr("Average time to the response headers, including dns lookup, connecting and ssl handshake"));
+    table_->horizontalHeaderItem(COLUMN_PARSE)->setToolTip(
+        tr("Average time spent decoding and parsing a response"));
+    table_->horizontalHeaderItem(COLUMN_BYTES_IN)->setToolTip(
+        tr("Received over the wire, before decompression"));
+
+    timings_label_ = new QLabel;
+    timings_label_->setWordWrap(true);
+
+    QPushButton *reset_btn = new QPushButton(tr("Reset"));
+    connect(reset_btn, SIGNAL(clicked()), this, SLOT(resetStats()));
+
+    QPushButton *close_btn = new QPushButton(tr("Close"));
+    connect(close_btn, SIGNAL(clicked()), this, SLOT(accept()));
+
+    QHBoxLayout *hlayout = new QHBoxLayout;
+    hlayout->addWidget(reset_btn);
+    hlayout->addStretch();
+    hlayout->addWidget(close_btn);
+
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->addWidget(table_);
+    vlayout->addWidget(timings_label_);
+    vlayout->addLayout(hlayout);
+    setLayout(vlayout);
+
+    refresh_timer_ = new QTimer(this);
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshStats()));
+
+    refreshStats();
+    refresh_timer_->start(kRefreshStatsInterval);
+}
+
+void ApiDiagnosticsDialog::refreshStats()
+{
+    QList<ApiEndpointStats> endpoints = ApiStats::instance()->endpoints();
+
+    table_->setRowCount(endpoints.size());
+
+    for (int row = 0, n = endpoints.size(); row < n; row++) {
+        const ApiEndpointStats& stats = endpoints[row];
+
+        QStringList values;
+        values << stats.server
+               << stats.endpoint
+               << QString::number(stats.requests)
+               << QString::number(stats.retries)
+               << statusSummary(stats.status_counts)
+               << msecs(stats.first_byte_usecs, stats.requests)
+               << msecs(stats.total_usecs, stats.requests)
+               << msecs(stats.max_total_usecs, stats.requests > 0 ? 1 : 0)
+               << msecs(stats.parse_usecs, stats.responses)
+               << kbytes(stats.bytes_out)
+               << kbytes(stats.wire_bytes_in);
+
+        for (int col = 0; col < MAX_COLUMN; col++) {
+            QTableWidgetItem *item = table_->item(row, col);
+            if (!item) {
+                item = new QTableWidgetItem;
+                table_->setItem(row, col, item);
+            }
+            item->setText(values[col]);
+        }
+
+        table_->item(row, COLUMN_BYTES_IN)->setToolTip(
+            tr("%1 kB after decompression").arg(kbytes(stats.decoded_bytes_in)));
+    }
+
+    refreshTimings();
+
+}
+
+void ApiDiagnosticsDialog::refreshTimings()
+{
+    QStringList lines;
+    QList<ApiTimingStats> timings = ApiStats::instance()->timings();
+    for (int i = 0, n = timings.size(); i < n; i++) {
+        const ApiTimingStats& timing = timings[i];
+        lines << tr("%1: last %2 ms, average %3 ms, max %4 ms (%5 times)")
+            .arg(timingTitle(timing.name))
+            .arg(msecs(timing.last_usecs, 1))
+            .arg(msecs(timing.total_usecs, timing.count))
+            .arg(msecs(timing.max_usecs, 1))
+            .arg(timing.count);
+    }
+
+    timings_label_->setText(lines.join("\n"));
+    timings_label_->setVisible(!lines.isEmpty());
+}
+
+QString ApiDiagnosticsDialog::timingTitle(const QString& name) const
+{
+    if (name == kFirstReposTiming) {
+        return tr("Time to the first libraries");
+    }
+    return name;
+}
+
+void ApiDiagnosticsDialog::resetStats()
+{
+    ApiStats::instance()->reset();
+    refreshStats();
+}
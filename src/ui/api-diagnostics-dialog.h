@@ -0,0 +1,34 @@
+#ifndef SEAFILE_CLIENT_API_DIAGNOSTICS_DIALOG_H
+#define SEAFILE_CLIENT_API_DIAGNOSTICS_DIALOG_H
+
+#include <QDialog>
+
+class QTimer;
+class QTableWidget;
+class QLabel;
+
+/**
+ * Show the per endpoint timings and traffic of the web api, see ApiStats
+ */
+class ApiDiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    ApiDiagnosticsDialog(QWidget *parent=0);
+
+private slots:
+    void refreshStats();
+    void resetStats();
+
+private:
+    Q_DISABLE_COPY(ApiDiagnosticsDialog)
+
+    void refreshTimings();
+    QString timingTitle(const QString& name) const;
+
+    QTableWidget *table_;
+    QLabel *timings_label_;
+    QTimer *refresh_timer_;
+};
+
+#endif // SEAFILE_CLIENT_API_DIAGNOSTICS_DIALOG_H
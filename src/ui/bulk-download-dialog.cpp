@@ -0,0 +1,489 @@
+#include <QtGui>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>            // std::stable_sort
+
+#include "utils/utils.h"
+#include "seafile-applet.h"
+#include "configurator.h"
+#include "rpc/rpc-client.h"
+#include "rpc/clone-task.h"
+#include "api/api-cache.h"
+#include "bulk-download-dialog.h"
+
+namespace {
+
+const int kPumpInterval = 1000; // 1 sec
+// Download info requests sent ahead of the running downloads
+const int kMaxParallelInfoRequests = 4;
+const int kDefaultConcurrency = 3;
+const int kMaxConcurrency = 10;
+
+const char *kSettingsGroup = "BulkDownload";
+const char *kConcurrencyKey = "concurrency";
+
+enum {
+    COLUMN_NAME = 0,
+    COLUMN_SIZE,
+    COLUMN_STATUS,
+    MAX_COLUMN
+};
+
+bool compareBySize(const BulkDownloadDialog::Library& a,
+                   const BulkDownloadDialog::Library& b)
+{
+    return a.repo.size < b.repo.size;
+}
+
+} // namespace
+
+BulkDownloadDialog::BulkDownloadDialog(const std::vector<Library>& libraries,
+                                       QWidget *parent)
+    : QDialog(parent),
+      started_(false)
+{
+    setWindowTitle(tr("Download %n libraries", "", libraries.size()));
+    setWindowIcon(QIcon(":/images/seafile.png"));
+    setMinimumSize(QSize(500, 400));
+
+    // Small libraries first, so they are usable early
+    std::vector<Library> sorted(libraries);
+    std::stable_sort(sorted.begin(), sorted.end(), compareBySize);
+
+    for (int i = 0, n = sorted.size(); i < n; i++) {
+        Task task;
+        task.library = sorted[i];
+        task.percent = 0;
+        if (task.library.repo.encrypted) {
+            // Each would need its own password
+            task.state = TASK_SKIPPED;
+            task.status = tr("Skipped: encrypted libraries must be downloaded one by one");
+        } else {
+            task.state = TASK_QUEUED;
+            task.status = tr("Waiting");
+        }
+        tasks_.push_back(task);
+    }
+
+    createLayout();
+    readSettings();
+
+    for (int row = 0, n = tasks_.size(); row < n; row++) {
+        updateRow(row);
+    }
+    updateProgress();
+
+    pump_timer_ = new QTimer(this);
+    connect(pump_timer_, SIGNAL(timeout()), this, SLOT(pump()));
+}
+
+void BulkDownloadDialog::createLayout()
+{
+    dir_edit_ = new QLineEdit(seafApplet->configurator()->worktreeDir());
+    choose_dir_btn_ = new QPushButton(tr("Choose..."));
+    connect(choose_dir_btn_, SIGNAL(clicked()), this, SLOT(chooseDirAction()));
+
+    QHBoxLayout *dir_layout = new QHBoxLayout;
+    dir_layout->addWidget(new QLabel(tr("Download to:")));
+    dir_layout->addWidget(dir_edit_);
+    dir_layout->addWidget(choose_dir_btn_);
+
+    concurrency_spin_ = new QSpinBox;
+    concurrency_spin_->setRange(1, kMaxConcurrency);
+    concurrency_spin_->setToolTip(tr("How many libraries are downloaded at the same time"));
+
+    QHBoxLayout *concurrency_layout = new QHBoxLayout;
+    concurrency_layout->addWidget(new QLabel(tr("Parallel downloads:")));
+    concurrency_layout->addWidget(concurrency_spin_);
+    concurrency_layout->addStretch();
+
+    table_ = new QTableWidget(tasks_.size(), MAX_COLUMN);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setSelectionMode(QAbstractItemView::NoSelection);
+    table_->verticalHeader()->hide();
+    table_->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft);
+    table_->horizontalHeader()->setStretchLastSection(true);
+
+    QStringList headers;
+    headers << tr("Library") << tr("Size") << tr("Status");
+    table_->setHorizontalHeaderLabels(headers);
+
+    progress_bar_ = new QProgressBar;
+    progress_bar_->setRange(0, 100);
+    progress_label_ = new QLabel;
+
+    start_btn_ = new QPushButton(tr("Start"));
+    start_btn_->setDefault(true);
+    connect(start_btn_, SIGNAL(clicked()), this, SLOT(start()));
+
+    stop_btn_ = new QPushButton(tr("Stop"));
+    stop_btn_->setToolTip(tr("Do not add the remaining libraries, downloads already started go on"));
+    stop_btn_->setVisible(false);
+    connect(stop_btn_, SIGNAL(clicked()), this, SLOT(stop()));
+
+    close_btn_ = new QPushButton(tr("Close"));
+    connect(close_btn_, SIGNAL(clicked()), this, SLOT(reject()));
+
+    QHBoxLayout *btn_layout = new QHBoxLayout;
+    btn_layout->addWidget(progress_label_);
+    btn_layout->addStretch();
+    btn_layout->addWidget(start_btn_);
+    btn_layout->addWidget(stop_btn_);
+    btn_layout->addWidget(close_btn_);
+
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->addLayout(dir_layout);
+    vlayout->addLayout(concurrency_layout);
+    vlayout->addWidget(table_);
+    vlayout->addWidget(progress_bar_);
+    vlayout->addLayout(btn_layout);
+    setLayout(vlayout);
+}
+
+void BulkDownloadDialog::readSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup(kSettingsGroup);
+    concurrency_spin_->setValue(settings.value(kConcurrencyKey, kDefaultConcurrency).toInt());
+    settings.endGroup();
+}
+
+void BulkDownloadDialog::writeSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup(kSettingsGroup);
+    settings.setValue(kConcurrencyKey, concurrency_spin_->value());
+    settings.endGroup();
+}
+
+void BulkDownloadDialog::chooseDirAction()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Please choose a directory"),
+                                                    dir_edit_->text(),
+                                                    QFileDialog::ShowDirsOnly
+                                                    | QFileDialog::DontResolveSymlinks);
+    if (dir.isEmpty())
+        return;
+    dir_edit_->setText(dir);
+}
+
+void BulkDownloadDialog::start()
+{
+    dir_edit_->setText(dir_edit_->text().trimmed());
+    QFileInfo dir(dir_edit_->text());
+    if (dir_edit_->text().isEmpty() || !dir.isDir()) {
+        QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
+                             tr("The folder does not exist"),
+                             QMessageBox::Ok);
+        return;
+    }
+    if (!dir.isWritable()) {
+        QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
+                             tr("The folder is not writable"),
+                             QMessageBox::Ok);
+        return;
+    }
+
+    writeSettings();
+
+    started_ = true;
+    dir_edit_->setEnabled(false);
+    choose_dir_btn_->setEnabled(false);
+    start_btn_->setEnabled(false);
+    stop_btn_->setVisible(true);
+
+    pump();
+    pump_timer_->start(kPumpInterval);
+}
+
+/**
+ * Move the queue forward: fetch download info ahead, hand ready libraries to
+ * seaf-daemon while there is room, and track the running downloads
+ */
+void BulkDownloadDialog::pump()
+{
+    updateSubmittedTasks();
+    fetchDownloadInfos();
+    submitReadyTasks();
+    updateProgress();
+
+    if (!isRunning()) {
+        pump_timer_->stop();
+        stop_btn_->setVisible(false);
+        close_btn_->setFocus();
+
+        // Closed while the queue was still going
+        if (isHidden()) {
+            deleteLater();
+        }
+    }
+}
+
+void BulkDownloadDialog::stop()
+{
+    QHash<DownloadRepoRequest*, int>::iterator it;
+    for (it = info_reqs_.begin(); it != info_reqs_.end(); ++it) {
+        it.key()->deleteLater();
+    }
+    info_reqs_.clear();
+
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        Task& task = tasks_[i];
+        if (task.state == TASK_QUEUED
+            || task.state == TASK_FETCHING_INFO
+            || task.state == TASK_READY) {
+            task.state = TASK_SKIPPED;
+            task.status = tr("Stopped");
+            updateRow(i);
+        }
+    }
+
+    pump();
+}
+
+void BulkDownloadDialog::fetchDownloadInfos()
+{
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        if (info_reqs_.size() >= kMaxParallelInfoRequests) {
+            return;
+        }
+
+        Task& task = tasks_[i];
+        if (task.state != TASK_QUEUED) {
+            continue;
+        }
+
+        if (ApiCache::instance()->downloadInfo(task.library.account,
+                                               task.library.repo.id, &task.info)) {
+            task.state = TASK_READY;
+            continue;
+        }
+
+        DownloadRepoRequest *req = new DownloadRepoRequest(task.library.account,
+                                                           task.library.repo);
+        req->setParent(this);
+        connect(req, SIGNAL(success(const RepoDownloadInfo&)),
+                this, SLOT(onDownloadInfoSuccess(const RepoDownloadInfo&)));
+        connect(req, SIGNAL(failed(int)), this, SLOT(onDownloadInfoFailed(int)));
+        info_reqs_.insert(req, i);
+        req->send();
+
+        task.state = TASK_FETCHING_INFO;
+        task.status = tr("Getting download information");
+        updateRow(i);
+    }
+}
+
+void BulkDownloadDialog::onDownloadInfoSuccess(const RepoDownloadInfo& info)
+{
+    DownloadRepoRequest *req = qobject_cast<DownloadRepoRequest *>(sender());
+    int i = info_reqs_.take(req);
+    req->deleteLater();
+
+    ApiCache::instance()->setDownloadInfo(req->account(), info);
+
+    Task& task = tasks_[i];
+    task.info = info;
+    task.state = TASK_READY;
+    task.status = tr("Waiting");
+    updateRow(i);
+
+    pump();
+}
+
+void BulkDownloadDialog::onDownloadInfoFailed(int code)
+{
+    DownloadRepoRequest *req = qobject_cast<DownloadRepoRequest *>(sender());
+    int i = info_reqs_.take(req);
+    req->deleteLater();
+
+    Task& task = tasks_[i];
+    task.state = TASK_FAILED;
+    task.status = tr("Failed to get download information");
+    if (code != 0) {
+        task.status += tr(" (error code %1)").arg(code);
+    }
+    updateRow(i);
+
+    pump();
+}
+
+void BulkDownloadDialog::submitReadyTasks()
+{
+    int running = 0;
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        if (tasks_[i].state == TASK_SUBMITTED) {
+            running++;
+        }
+    }
+
+    for (int i = 0, n = tasks_.size(); i < n && running < concurrency_spin_->value(); i++) {
+        Task& task = tasks_[i];
+        if (task.state != TASK_READY) {
+            continue;
+        }
+
+        submit(&task);
+        if (task.state == TASK_SUBMITTED) {
+            running++;
+        }
+        updateRow(i);
+    }
+}
+
+void BulkDownloadDialog::submit(Task *task)
+{
+    const ServerRepo& repo = task->library.repo;
+    const RepoDownloadInfo& info = task->info;
+    QDir parent(dir_edit_->text());
+
+    // Never sync into a folder that is already there, it may hold another
+    // library or unrelated files. downloadRepo() creates a new folder.
+    QString error;
+    int ret = seafApplet->rpcClient()->downloadRepo(repo.id, info.relay_id,
+                                                    repo.name, parent.path(),
+                                                    info.token, QString(),
+                                                    info.magic, info.relay_addr,
+                                                    info.relay_port, info.email,
+                                                    info.random_key, info.enc_version,
+                                                    &error);
+
+    if (ret < 0) {
+        // The cached info may be outdated
+        ApiCache::instance()->removeDownloadInfo(task->library.account, repo.id);
+        task->state = TASK_FAILED;
+        task->status = tr("Failed to add download task: %1").arg(error);
+        return;
+    }
+
+    task->state = TASK_SUBMITTED;
+    task->status = tr("Starting");
+}
+
+void BulkDownloadDialog::updateSubmittedTasks()
+{
+    std::vector<CloneTask> clone_tasks;
+    if (seafApplet->rpcClient()->getCloneTasks(&clone_tasks) < 0) {
+        return;
+    }
+
+    QHash<QString, const CloneTask*> by_repo;
+    for (int i = 0, n = clone_tasks.size(); i < n; i++) {
+        by_repo.insert(clone_tasks[i].repo_id, &clone_tasks[i]);
+    }
+
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        Task& task = tasks_[i];
+        if (task.state != TASK_SUBMITTED) {
+            continue;
+        }
+
+        const CloneTask *clone_task = by_repo.value(task.library.repo.id);
+        if (!clone_task) {
+            // Removed from the list, by the user or by seaf-daemon. Done if
+            // the repo is there, otherwise it would hold its place forever.
+            if (seafApplet->rpcClient()->hasLocalRepo(task.library.repo.id)) {
+                task.state = TASK_DONE;
+                task.percent = 100;
+                task.status = tr("Done");
+            } else {
+                task.state = TASK_FAILED;
+                task.status = tr("The download task was removed");
+            }
+            updateRow(i);
+            continue;
+        }
+
+        if (clone_task->state == "done") {
+            task.state = TASK_DONE;
+            task.percent = 100;
+        } else if (clone_task->state == "error" || clone_task->state == "canceled") {
+            task.state = TASK_FAILED;
+        } else if (clone_task->state == "fetch" && clone_task->block_total > 0) {
+            task.percent = 100 * clone_task->block_done / clone_task->block_total;
+        }
+
+        task.status = clone_task->state == "error" ? clone_task->error_str : clone_task->state_str;
+        updateRow(i);
+    }
+}
+
+void BulkDownloadDialog::updateRow(int row)
+{
+    const Task& task = tasks_[row];
+
+    QStringList values;
+    values << task.library.repo.name
+           << readableFileSize(task.library.repo.size)
+           << task.status;
+
+    for (int col = 0; col < MAX_COLUMN; col++) {
+        QTableWidgetItem *item = table_->item(row, col);
+        if (!item) {
+            item = new QTableWidgetItem;
+            table_->setItem(row, col, item);
+        }
+        item->setText(values[col]);
+    }
+}
+
+void BulkDownloadDialog::updateProgress()
+{
+    int done = 0, failed = 0, skipped = 0, percent = 0;
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        const Task& task = tasks_[i];
+        switch (task.state) {
+        case TASK_DONE:
+            done++;
+            break;
+        case TASK_FAILED:
+            failed++;
+            break;
+        case TASK_SKIPPED:
+            skipped++;
+            break;
+        default:
+            break;
+        }
+        percent += task.percent;
+    }
+
+    int total = tasks_.size() - skipped;
+    progress_bar_->setValue(total > 0 ? percent / total : 100);
+
+    QString text = tr("%1 of %2 libraries downloaded").arg(done).arg(total);
+    if (failed > 0) {
+        text += tr(", %1 failed").arg(failed);
+    }
+    progress_label_->setText(text);
+}
+
+bool BulkDownloadDialog::isRunning() const
+{
+    if (!started_) {
+        return false;
+    }
+
+    for (int i = 0, n = tasks_.size(); i < n; i++) {
+        TaskState state = tasks_[i].state;
+        if (state != TASK_DONE && state != TASK_FAILED && state != TASK_SKIPPED) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BulkDownloadDialog::reject()
+{
+    // The queue goes on in the background, see pump()
+    if (isRunning()) {
+        hide();
+        return;
+    }
+
+    QDialog::reject();
+}
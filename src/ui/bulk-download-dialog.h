@@ -0,0 +1,103 @@
+#ifndef SEAFILE_CLIENT_BULK_DOWNLOAD_DIALOG_H
+#define SEAFILE_CLIENT_BULK_DOWNLOAD_DIALOG_H
+
+#include <vector>
+#include <QDialog>
+#include <QHash>
+
+#include "account.h"
+#include "api/server-repo.h"
+#include "api/requests.h"
+
+class QTimer;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+class QProgressBar;
+class QLabel;
+
+/**
+ * Download many libraries into one folder.
+ *
+ * Libraries are queued smallest first, so the small ones are usable early.
+ * Download info is fetched a few libraries ahead, in parallel, and a library
+ * is handed to seaf-daemon only while fewer than the chosen number of its
+ * download tasks are running.
+ *
+ * The dialog is not modal. Closing it while libraries are queued only hides
+ * it, the queue goes on and the dialog deletes itself once it is done.
+ */
+class BulkDownloadDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    struct Library {
+        Account account;
+        ServerRepo repo;
+    };
+
+    BulkDownloadDialog(const std::vector<Library>& libraries, QWidget *parent=0);
+
+public slots:
+    void reject();
+
+private slots:
+    void chooseDirAction();
+    void start();
+    void stop();
+    void pump();
+    void onDownloadInfoSuccess(const RepoDownloadInfo& info);
+    void onDownloadInfoFailed(int code);
+
+private:
+    Q_DISABLE_COPY(BulkDownloadDialog)
+
+    enum TaskState {
+        TASK_QUEUED,
+        TASK_FETCHING_INFO,
+        TASK_READY,
+        TASK_SUBMITTED,
+        TASK_DONE,
+        TASK_FAILED,
+        TASK_SKIPPED
+    };
+
+    struct Task {
+        Library library;
+        TaskState state;
+        RepoDownloadInfo info;
+        QString status;
+        int percent;
+    };
+
+    void createLayout();
+    void fetchDownloadInfos();
+    void submitReadyTasks();
+    void submit(Task *task);
+    void updateSubmittedTasks();
+    void updateRow(int row);
+    void updateProgress();
+    bool isRunning() const;
+    void readSettings();
+    void writeSettings();
+
+    std::vector<Task> tasks_;
+    // Pending download info requests => task index
+    QHash<DownloadRepoRequest*, int> info_reqs_;
+    bool started_;
+
+    QTimer *pump_timer_;
+
+    QLineEdit *dir_edit_;
+    QPushButton *choose_dir_btn_;
+    QSpinBox *concurrency_spin_;
+    QTableWidget *table_;
+    QProgressBar *progress_bar_;
+    QLabel *progress_label_;
+    QPushButton *start_btn_;
+    QPushButton *stop_btn_;
+    QPushButton *close_btn_;
+};
+
+#endif // SEAFILE_CLIENT_BULK_DOWNLOAD_DIALOG_H
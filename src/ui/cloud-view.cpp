@@ -13,8 +13,11 @@ extern "C" {
 #include "QtAwesome.h"
 #include "seahub-messages-monitor.h"
 #include "api/requests.h"
+#include "api/api-stats.h"
+#include "api/api-cache.h"
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
+#include "rpc/local-repo.h"
 #include "account-mgr.h"
 #include "login-dialog.h"
 #include "create-repo-dialog.h"
@@ -29,6 +32,13 @@ extern "C" {
 namespace {
 
 const int kRefreshReposInterval = 1000 * 60 * 5; // 5 min
+// The refresh interval shrinks while the repos list keeps changing and grows
+// while it stays the same
+const int kMinRefreshReposInterval = 1000 * 60; // 1 min
+const int kMaxRefreshReposInterval = 1000 * 60 * 15; // 15 min
+const int kMaxCachedAccountModels = 4;
+// Let the current account go first before prefetching the others
+const int kPrefetchDelay = 1000 * 2;
 const int kRefreshStatusInterval = 1000;
 
 enum {
@@ -41,9 +51,16 @@ enum {
 CloudView::CloudView(QWidget *parent)
     : QWidget(parent),
       in_refresh_(false),
+      refresh_timer_(NULL),
+      refresh_interval_(kRefreshReposInterval),
+      repos_model_(NULL),
       list_repo_req_(NULL),
-      clone_task_dialog_(NULL)
-
+      list_mine_req_(NULL),
+      only_mine_loaded_(false),
+      clone_task_dialog_(NULL),
+      unified_mode_(false),
+      unified_model_(NULL),
+      sort_order_(RepoTreeModel::SORT_BY_SERVER_ORDER)
 {
     setupUi(this);
 
@@ -52,7 +69,7 @@ CloudView::CloudView(QWidget *parent)
     createRepoModelView();
     createLoadingView();
     mStack->insertWidget(INDEX_LOADING_VIEW, loading_view_);
-    mStack->insertWidget(INDEX_REPOS_VIEW, repos_tree_);
+    mStack->insertWidget(INDEX_REPOS_VIEW, repos_view_);
 
     createToolBar();
     updateAccountInfoDisplay();
@@ -89,8 +106,13 @@ CloudView::CloudView(QWidget *parent)
     connect(seafApplet->accountManager(), SIGNAL(accountRemoved(const Account&)),
             this, SLOT(updateAccountMenu()));
 
+    connect(seafApplet->accountManager(), SIGNAL(accountRemoved(const Account&)),
+            this, SLOT(onAccountRemoved(const Account&)));
+
     connect(mDownloadTasksBtn, SIGNAL(clicked()), this, SLOT(showCloneTasksDialog()));
     connect(mServerStatusBtn, SIGNAL(clicked()), this, SLOT(showServerStatusDialog()));
+
+    readSettings();
 }
 
 CloneTasksDialog *CloudView::cloneTasksDialog()
@@ -104,12 +126,26 @@ CloneTasksDialog *CloudView::cloneTasksDialog()
 
 void CloudView::createRepoModelView()
 {
+    // The model of an account is created when the account is switched to
     repos_tree_ = new RepoTreeView(this);
-    repos_model_ = new RepoTreeModel;
-    repos_model_->setTreeView(repos_tree_);
-
-    repos_tree_->setModel(repos_model_);
     repos_tree_->setItemDelegate(new RepoItemDelegate);
+
+    // The filter box above the tree
+    repos_view_ = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    repos_view_->setLayout(layout);
+
+    filter_edit_ = new QLineEdit;
+    filter_edit_->setPlaceholderText(tr("Search libraries"));
+    connect(filter_edit_, SIGNAL(textChanged(const QString&)),
+            repos_tree_, SLOT(setFilterText(const QString&)));
+
+    layout->addWidget(filter_edit_);
+    layout->addWidget(repos_tree_);
+
+    unified_model_ = new RepoTreeModel(true, this);
+    unified_model_->setTreeView(repos_tree_);
 }
 
 void CloudView::createLoadingView()
@@ -211,13 +247,86 @@ void CloudView::updateAccountMenu()
     }
 }
 
+RepoTreeModel* CloudView::modelForAccount(const Account& account)
+{
+    const QString key = account.key();
+    account_models_lru_.removeAll(key);
+    account_models_lru_.prepend(key);
+
+    RepoTreeModel *model = account_models_.value(key);
+    if (!model) {
+        model = new RepoTreeModel(false, this);
+        model->setTreeView(repos_tree_);
+        model->setSortOrder((RepoTreeModel::SortOrder)sort_order_);
+        account_models_.insert(key, model);
+    }
+
+    evictAccountModels();
+
+    return model;
+}
+
+void CloudView::evictAccountModels()
+{
+    int i = account_models_lru_.size() - 1;
+    while (account_models_lru_.size() > kMaxCachedAccountModels && i >= 0) {
+        const QString key = account_models_lru_[i];
+        RepoTreeModel *model = account_models_.value(key);
+        // Never drop the model of the current account
+        if (model != repos_model_) {
+            account_models_lru_.removeAt(i);
+            account_models_.remove(key);
+            delete prefetch_reqs_.take(key);
+            prefetched_at_.remove(key);
+            delete model;
+        }
+        i--;
+    }
+}
+
+void CloudView::setTreeModel(RepoTreeModel *model)
+{
+    RepoTreeModel *old_model = repos_tree_->treeModel();
+    if (old_model == model) {
+        return;
+    }
+    if (old_model) {
+        old_model->saveExpandedState();
+    }
+
+    repos_tree_->setTreeModel(model);
+
+    if (model) {
+        model->restoreExpandedState();
+    }
+}
+
 void CloudView::setCurrentAccount(const Account& account)
 {
     if (current_account_ != account) {
         current_account_ = account;
         in_refresh_ = false;
-        repos_model_->clear();
-        showLoadingView();
+        only_mine_loaded_ = false;
+        first_repos_timer_.invalidate();
+        setRefreshInterval(kRefreshReposInterval);
+
+        // No model is kept for the empty account after logging out
+        RepoTreeModel *model = account.isValid() ? modelForAccount(account) : NULL;
+        if (model != repos_model_) {
+            repos_model_ = model;
+            if (!unified_mode_) {
+                setTreeModel(repos_model_);
+            }
+        }
+
+        if (!unified_mode_) {
+            // A cached model is shown right away and refreshed below
+            if (repos_model_ && repos_model_->isLoaded()) {
+                showRepos();
+            } else {
+                showLoadingView();
+            }
+        }
         refreshRepos();
 
         seahub_messages_monitor_->refresh();
@@ -263,6 +372,11 @@ void CloudView::onAccountItemClicked()
 
 void CloudView::refreshRepos()
 {
+    if (unified_mode_) {
+        refreshAllAccounts();
+        return;
+    }
+
     if (in_refresh_) {
         return;
     }
@@ -271,8 +385,37 @@ void CloudView::refreshRepos()
         return;
     }
 
+    // Fetched ahead by the login dialog
+    std::vector<ServerRepo> repos;
+    if (ApiCache::instance()->takeRepos(current_account_, &repos)) {
+        first_repos_timer_.start();
+        updateRepos(repos);
+        return;
+    }
+
     in_refresh_ = true;
 
+    // On a cold start, show "My Libraries" from a small filtered request
+    // while the full list with all the shared and group libraries is still
+    // on its way
+    if (!repos_model_->isLoaded()) {
+        first_repos_timer_.start();
+        // After the requests are sent and the loading view is painted, the
+        // first listing of the accounts of the local repos takes a few rpc
+        // calls per repo
+        QTimer::singleShot(0, this, SLOT(showLocalRepos()));
+
+        if (list_mine_req_) {
+            delete list_mine_req_;
+        }
+        list_mine_req_ = new ListReposRequest(current_account_, "mine");
+        list_mine_req_->setPriority(QNetworkRequest::HighPriority);
+        connect(list_mine_req_, SIGNAL(success(const std::vector<ServerRepo>&)),
+                this, SLOT(onMineReposFetched(const std::vector<ServerRepo>&)));
+        connect(list_mine_req_, SIGNAL(failed(int)), this, SLOT(onMineReposFailed()));
+        list_mine_req_->send();
+    }
+
     if (list_repo_req_) {
         delete list_repo_req_;
     }
@@ -286,12 +429,198 @@ void CloudView::refreshRepos()
 void CloudView::refreshRepos(const std::vector<ServerRepo>& repos)
 {
     in_refresh_ = false;
-    repos_model_->setRepos(repos);
-
     list_repo_req_->deleteLater();
     list_repo_req_ = NULL;
 
+    updateRepos(repos);
+}
+
+void CloudView::updateRepos(const std::vector<ServerRepo>& repos)
+{
+    // Logged out since
+    if (!repos_model_) {
+        return;
+    }
+
+    bool first_load = !repos_model_->isLoaded() || only_mine_loaded_;
+    only_mine_loaded_ = false;
+    int changes = repos_model_->setRepos(repos);
+    // Synced libraries no longer on the server
+    repos_model_->removeLocalRepos();
+    if (!first_load) {
+        adaptRefreshInterval(changes > 0);
+    }
+
     showRepos();
+    recordFirstReposShown();
+
+    QTimer::singleShot(kPrefetchDelay, this, SLOT(prefetchOtherAccounts()));
+}
+
+/**
+ * seaf-daemon answers at once even when the server is slow to, so the
+ * libraries synced from the current account are shown while its repo list
+ * is loading
+ */
+void CloudView::showLocalRepos()
+{
+    // The list from the server may have won the race, or the account is gone
+    if (!repos_model_ || repos_model_->isLoaded()) {
+        return;
+    }
+
+    std::vector<LocalRepo> repos;
+    if (seafApplet->rpcClient()->listAccountRepos(current_account_.serverUrl.host(),
+                                                  current_account_.username,
+                                                  &repos) < 0) {
+        return;
+    }
+
+    repos_model_->setLocalRepos(repos);
+    if (!repos.empty() && !unified_mode_) {
+        showRepos();
+        recordFirstReposShown();
+    }
+}
+
+void CloudView::onMineReposFetched(const std::vector<ServerRepo>& repos)
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    if (req == list_mine_req_) {
+        list_mine_req_ = NULL;
+    }
+    req->deleteLater();
+
+    // Too late if the full list has already arrived
+    if (req->account() != current_account_ || !in_refresh_
+        || !repos_model_ || repos_model_->isLoaded()) {
+        return;
+    }
+
+    repos_model_->setRepos(repos);
+    only_mine_loaded_ = true;
+
+    if (!unified_mode_) {
+        showRepos();
+    }
+    recordFirstReposShown();
+}
+
+void CloudView::onMineReposFailed()
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    if (req == list_mine_req_) {
+        list_mine_req_ = NULL;
+    }
+    req->deleteLater();
+}
+
+/**
+ * Time from starting to load the libraries of an account to showing the
+ * first of them
+ */
+void CloudView::recordFirstReposShown()
+{
+    if (!first_repos_timer_.isValid()) {
+        return;
+    }
+
+    qint64 usecs = first_repos_timer_.nsecsElapsed() / 1000;
+    first_repos_timer_.invalidate();
+
+    ApiStats::instance()->recordTiming(kFirstReposTiming, usecs);
+    qDebug("first libraries shown after %lld ms\n", usecs / 1000);
+}
+
+/**
+ * Fill the cached models of the most recently used other accounts in the
+ * background, with low priority requests, so switching to them is instant.
+ */
+void CloudView::prefetchOtherAccounts()
+{
+    if (unified_mode_) {
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // Accounts are ordered by last visited time
+    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
+    int budget = kMaxCachedAccountModels - 1;
+    for (int i = 0, n = accounts.size(); i < n && budget > 0; i++) {
+        const Account& account = accounts[i];
+        const QString key = account.key();
+        if (!account.isValid() || key == current_account_.key()) {
+            continue;
+        }
+        budget--;
+
+        if (prefetch_reqs_.contains(key)
+            || now - prefetched_at_.value(key, 0) < kRefreshReposInterval) {
+            continue;
+        }
+
+        if (!account_models_.contains(key)) {
+            RepoTreeModel *model = new RepoTreeModel(false, this);
+            model->setTreeView(repos_tree_);
+            model->setSortOrder((RepoTreeModel::SortOrder)sort_order_);
+            account_models_.insert(key, model);
+            // Keep the current account the most recently used one
+            account_models_lru_.insert(qMin(1, account_models_lru_.size()), key);
+            evictAccountModels();
+        }
+
+        ListReposRequest *req = new ListReposRequest(account);
+        req->setPriority(QNetworkRequest::LowPriority);
+        connect(req, SIGNAL(success(const std::vector<ServerRepo>&)),
+                this, SLOT(onPrefetchSuccess(const std::vector<ServerRepo>&)));
+        connect(req, SIGNAL(failed(int)), this, SLOT(onPrefetchFailed()));
+        prefetch_reqs_.insert(key, req);
+        req->send();
+    }
+}
+
+void CloudView::onPrefetchSuccess(const std::vector<ServerRepo>& repos)
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    const QString key = req->account().key();
+    prefetch_reqs_.remove(key);
+    req->deleteLater();
+
+    prefetched_at_.insert(key, QDateTime::currentMSecsSinceEpoch());
+
+    RepoTreeModel *model = account_models_.value(key);
+    // The user may have switched to this account meanwhile, and its own
+    // refresh will be applied on top of this
+    if (model) {
+        model->setRepos(repos);
+    }
+}
+
+void CloudView::onPrefetchFailed()
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    prefetch_reqs_.remove(req->account().key());
+    req->deleteLater();
+}
+
+void CloudView::adaptRefreshInterval(bool repos_changed)
+{
+    int interval = repos_changed ? refresh_interval_ / 2 : refresh_interval_ * 2;
+    setRefreshInterval(qBound(kMinRefreshReposInterval, interval, kMaxRefreshReposInterval));
+}
+
+void CloudView::setRefreshInterval(int msecs)
+{
+    if (refresh_interval_ == msecs) {
+        return;
+    }
+
+    refresh_interval_ = msecs;
+    if (refresh_timer_ && refresh_timer_->isActive()) {
+        refresh_timer_->start(refresh_interval_);
+    }
+    qDebug("refresh repos every %d seconds\n", refresh_interval_ / 1000);
 }
 
 void CloudView::refreshReposFailed()
@@ -300,6 +629,156 @@ void CloudView::refreshReposFailed()
     in_refresh_ = false;
 }
 
+/**
+ * Fetch the repos of every account at the same time. The requests share the
+ * connections of the global network access manager, and each account is
+ * updated in the tree as soon as its own list arrives.
+ */
+void CloudView::refreshAllAccounts()
+{
+    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
+    for (int i = 0, n = accounts.size(); i < n; i++) {
+        const Account& account = accounts[i];
+        if (!account.isValid() || account_repo_reqs_.contains(account.key())) {
+            continue;
+        }
+
+        ListReposRequest *req = new ListReposRequest(account);
+        connect(req, SIGNAL(success(const std::vector<ServerRepo>&)),
+                this, SLOT(onAccountReposFetched(const std::vector<ServerRepo>&)));
+        connect(req, SIGNAL(failed(int)), this, SLOT(onAccountReposFailed()));
+        account_repo_reqs_.insert(account.key(), req);
+        req->send();
+    }
+}
+
+void CloudView::onAccountReposFetched(const std::vector<ServerRepo>& repos)
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    const Account account = req->account();
+    account_repo_reqs_.remove(account.key());
+    req->deleteLater();
+
+    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
+    for (int i = 0, n = accounts.size(); i < n; i++) {
+        if (accounts[i].key() == account.key()) {
+            unified_model_->setAccountRepos(account, repos);
+            break;
+        }
+    }
+
+    if (unified_mode_) {
+        showRepos();
+    }
+}
+
+void CloudView::onAccountReposFailed()
+{
+    ListReposRequest *req = qobject_cast<ListReposRequest *>(sender());
+    qDebug("failed to refresh repos of %s\n", req->account().username.toUtf8().data());
+    account_repo_reqs_.remove(req->account().key());
+    req->deleteLater();
+
+    if (unified_mode_ && account_repo_reqs_.isEmpty()) {
+        showRepos();
+    }
+}
+
+void CloudView::onAccountRemoved(const Account& account)
+{
+    unified_model_->removeAccount(account);
+    ApiCache::instance()->removeAccount(account);
+
+    const QString key = account.key();
+    delete prefetch_reqs_.take(key);
+    prefetched_at_.remove(key);
+    RepoTreeModel *model = account_models_.value(key);
+    if (model && model != repos_model_) {
+        account_models_.remove(key);
+        account_models_lru_.removeAll(key);
+        delete model;
+    }
+}
+
+void CloudView::setUnifiedView(bool unified)
+{
+    if (unified_mode_ == unified) {
+        return;
+    }
+
+    unified_mode_ = unified;
+    writeSettings();
+
+    if (unified) {
+        setTreeModel(unified_model_);
+        if (!unified_model_->isLoaded()) {
+            showLoadingView();
+        }
+    } else {
+        setTreeModel(repos_model_);
+        if (hasAccount() && (!repos_model_ || !repos_model_->isLoaded())) {
+            showLoadingView();
+        }
+    }
+
+    refreshRepos();
+}
+
+void CloudView::readSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup("CloudView");
+    bool unified = settings.value("unifiedView", false).toBool();
+    int sort_order = settings.value("sortOrder", RepoTreeModel::SORT_BY_SERVER_ORDER).toInt();
+    settings.endGroup();
+
+    unified_view_action_->setChecked(unified);
+    setSortOrder(sort_order);
+}
+
+void CloudView::writeSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup("CloudView");
+    settings.setValue("unifiedView", unified_mode_);
+    settings.setValue("sortOrder", sort_order_);
+    settings.endGroup();
+}
+
+void CloudView::onSortActionTriggered(QAction *action)
+{
+    setSortOrder(action->data().toInt());
+    writeSettings();
+}
+
+/**
+ * The models reorder the rows they have, and keep new rows in order as
+ * they arrive
+ */
+void CloudView::setSortOrder(int order)
+{
+    if (order < RepoTreeModel::SORT_BY_SERVER_ORDER
+        || order > RepoTreeModel::SORT_BY_SYNC_STATE) {
+        order = RepoTreeModel::SORT_BY_SERVER_ORDER;
+    }
+    sort_order_ = order;
+
+    QList<QAction*> actions = sort_actions_->actions();
+    for (int i = 0, n = actions.size(); i < n; i++) {
+        if (actions[i]->data().toInt() == order) {
+            actions[i]->setChecked(true);
+        }
+    }
+
+    RepoTreeModel::SortOrder sort_order = (RepoTreeModel::SortOrder)order;
+    unified_model_->setSortOrder(sort_order);
+    foreach (RepoTreeModel *model, account_models_) {
+        model->setSortOrder(sort_order);
+    }
+}
+
 bool CloudView::hasAccount()
 {
     return current_account_.token.length() > 0;
@@ -308,14 +787,18 @@ bool CloudView::hasAccount()
 void CloudView::showEvent(QShowEvent *event) {
     QWidget::showEvent(event);
 
-    refresh_timer_->start(kRefreshReposInterval);
+    refresh_timer_->start(refresh_interval_);
     refresh_status_bar_timer_->start(kRefreshStatusInterval);
+
+    seahub_messages_monitor_->setWindowVisible(true);
 }
 
 void CloudView::hideEvent(QHideEvent *event) {
     QWidget::hideEvent(event);
     refresh_timer_->stop();
     refresh_status_bar_timer_->stop();
+
+    seahub_messages_monitor_->setWindowVisible(false);
 }
 
 void CloudView::showAddAccountDialog()
@@ -466,6 +949,33 @@ void CloudView::createToolBar()
     connect(refresh_action_, SIGNAL(triggered()), this, SLOT(onRefreshClicked()));
     tool_bar_->addAction(refresh_action_);
 
+    unified_view_action_ = new QAction(tr("Show libraries of all accounts"), this);
+    unified_view_action_->setIcon(awesome->icon(icon_th_list));
+    unified_view_action_->setCheckable(true);
+    connect(unified_view_action_, SIGNAL(toggled(bool)), this, SLOT(setUnifiedView(bool)));
+    tool_bar_->addAction(unified_view_action_);
+
+    sort_actions_ = new QActionGroup(this);
+    QMenu *sort_menu = new QMenu(this);
+    QStringList sort_names;
+    sort_names << tr("Server order") << tr("Name") << tr("Size")
+               << tr("Last modified") << tr("Sync state");
+    for (int i = 0, n = sort_names.size(); i < n; i++) {
+        QAction *action = sort_menu->addAction(sort_names[i]);
+        action->setCheckable(true);
+        action->setData(RepoTreeModel::SORT_BY_SERVER_ORDER + i);
+        sort_actions_->addAction(action);
+    }
+    connect(sort_actions_, SIGNAL(triggered(QAction*)),
+            this, SLOT(onSortActionTriggered(QAction*)));
+
+    QToolButton *sort_btn = new QToolButton;
+    sort_btn->setIcon(awesome->icon(icon_sort));
+    sort_btn->setToolTip(tr("Sort libraries by"));
+    sort_btn->setMenu(sort_menu);
+    sort_btn->setPopupMode(QToolButton::InstantPopup);
+    tool_bar_->addWidget(sort_btn);
+
     std::vector<QAction*> repo_actions = repos_tree_->getToolBarActions();
     for (int i = 0, n = repo_actions.size(); i < n; i++) {
         QAction *action = repo_actions[i];
@@ -489,8 +999,11 @@ void CloudView::showCreateRepoDialog()
 {
     CreateRepoDialog dialog(current_account_, this);
     if (dialog.exec() == QDialog::Accepted) {
-        showLoadingView();
-        refreshRepos();
+        // The server has it now, no need to reload the whole list
+        repos_model_->addRepo(dialog.repo());
+        if (unified_model_) {
+            unified_model_->addAccountRepo(current_account_, dialog.repo());
+        }
         showCloneTasksDialog();
     }
 }
@@ -2,6 +2,9 @@
 #define SEAFILE_CLIENT_CLOUD_VIEW_H
 
 #include <QWidget>
+#include <QHash>
+#include <QStringList>
+#include <QElapsedTimer>
 #include "account.h"
 #include "ui_cloud-view.h"
 class QPoint;
@@ -11,6 +14,9 @@ class QShowEvent;
 class QHideEvent;
 class QToolButton;
 class QToolBar;
+class QLineEdit;
+class QAction;
+class QActionGroup;
 
 class ListReposRequest;
 class ServerRepo;
@@ -43,6 +49,8 @@ private slots:
     void refreshRepos();
     void refreshRepos(const std::vector<ServerRepo>& repos);
     void refreshReposFailed();
+    void onMineReposFetched(const std::vector<ServerRepo>& repos);
+    void onMineReposFailed();
     void setCurrentAccount(const Account&account);
     void updateAccountMenu();
     void onAccountItemClicked();
@@ -50,6 +58,15 @@ private slots:
     void showCreateRepoDialog();
     void showServerStatusDialog();
     void onRefreshClicked();
+    void setUnifiedView(bool unified);
+    void onAccountReposFetched(const std::vector<ServerRepo>& repos);
+    void onAccountReposFailed();
+    void onAccountRemoved(const Account& account);
+    void prefetchOtherAccounts();
+    void onPrefetchSuccess(const std::vector<ServerRepo>& repos);
+    void onPrefetchFailed();
+    void onSortActionTriggered(QAction *action);
+    void showLocalRepos();
 
 private:
     Q_DISABLE_COPY(CloudView)
@@ -66,23 +83,45 @@ private:
     void refreshServerStatus();
     void refreshTasksInfo();
     void refreshTransferRate();
+    void refreshAllAccounts();
+    RepoTreeModel *modelForAccount(const Account& account);
+    void evictAccountModels();
+    void setTreeModel(RepoTreeModel *model);
+    void readSettings();
+    void writeSettings();
+    void setSortOrder(int order);
+    void adaptRefreshInterval(bool repos_changed);
+    void setRefreshInterval(int msecs);
+    void recordFirstReposShown();
+    void updateRepos(const std::vector<ServerRepo>& repos);
 
     bool in_refresh_;
     QTimer *refresh_timer_;
+    int refresh_interval_;
 
     QTimer *refresh_status_bar_timer_;
 
     RepoTreeModel *repos_model_;
 
     RepoTreeView *repos_tree_;
+    // The tree and its filter box
+    QWidget *repos_view_;
+    QLineEdit *filter_edit_;
     QWidget *loading_view_;
 
     ListReposRequest *list_repo_req_;
 
+    // Progressive loading: the repos owned by the user are shown first
+    ListReposRequest *list_mine_req_;
+    bool only_mine_loaded_;
+    QElapsedTimer first_repos_timer_;
+
     // Toolbar and actions
     QToolBar *tool_bar_;
     QAction *refresh_action_;
     QAction *create_repo_action_;
+    QAction *unified_view_action_;
+    QActionGroup *sort_actions_;
 
     // FolderDropArea *drop_area_;
     Account current_account_;
@@ -96,6 +135,25 @@ private:
     CloneTasksDialog* clone_task_dialog_;
 
     SeahubMessagesMonitor *seahub_messages_monitor_;
+
+    // Libraries of all accounts in one tree
+    bool unified_mode_;
+    RepoTreeModel *unified_model_;
+
+    // RepoTreeModel::SortOrder of every model
+    int sort_order_;
+    // In-flight list repos requests of the unified view, keyed by Account::key()
+    QHash<QString, ListReposRequest*> account_repo_reqs_;
+
+    // LRU of the repos models of recently used accounts, so switching back
+    // to an account shows its libraries at once. Keyed by Account::key(),
+    // the most recently used first.
+    QHash<QString, RepoTreeModel*> account_models_;
+    QStringList account_models_lru_;
+
+    // Background requests filling the models of the other accounts
+    QHash<QString, ListReposRequest*> prefetch_reqs_;
+    QHash<QString, qint64> prefetched_at_;
 };
 
 
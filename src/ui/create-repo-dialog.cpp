@@ -164,6 +164,18 @@ void CreateRepoDialog::createSuccess(const RepoDownloadInfo& info)
                              QMessageBox::Ok);
         setAllInputsEnabled(true);
     } else {
+        // What the server would list for it, so it can be shown right away
+        repo_.id = info.repo_id;
+        repo_.name = info.repo_name;
+        repo_.description = desc_;
+        repo_.mtime = QDateTime::currentDateTime().toTime_t();
+        repo_.size = 0;
+        repo_.encrypted = !passwd_.isEmpty();
+        repo_.type = "repo";
+        repo_.owner = account_.username;
+        repo_.permission = "rw";
+        repo_.group_id = 0;
+
         done(QDialog::Accepted);
     }
 }
@@ -4,6 +4,7 @@
 
 #include "ui_create-repo-dialog.h"
 #include "account.h"
+#include "api/server-repo.h"
 
 class CreateRepoRequest;
 class RepoDownloadInfo;
@@ -16,6 +17,9 @@ public:
     CreateRepoDialog(const Account& account, QWidget *parent=0);
     ~CreateRepoDialog();
 
+    // The repo created on the server, valid once the dialog is accepted
+    const ServerRepo& repo() const { return repo_; }
+
 private slots:
     void createAction();
     void chooseDirAction();
@@ -33,4 +37,5 @@ private:
     QString passwd_;
     CreateRepoRequest *request_;
     Account account_;
+    ServerRepo repo_;
 };
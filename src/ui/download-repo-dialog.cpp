@@ -6,6 +6,7 @@
 #include "rpc/rpc-client.h"
 #include "configurator.h"
 #include "api/requests.h"
+#include "api/api-cache.h"
 #include "api/server-repo.h"
 #include "download-repo-dialog.h"
 
@@ -15,6 +16,7 @@ DownloadRepoDialog::DownloadRepoDialog(const Account& account,
     : QDialog(parent),
       repo_(repo),
       sync_with_existing_(false),
+      used_cached_info_(false),
       account_(account)
 {
     setupUi(this);
@@ -59,7 +61,21 @@ void DownloadRepoDialog::onOkBtnClicked()
 
     setAllInputsEnabled(false);
 
+    // Usually prefetched when the library was hovered or selected
+    RepoDownloadInfo info;
+    if (ApiCache::instance()->downloadInfo(account_, repo_.id, &info)) {
+        used_cached_info_ = true;
+        onDownloadRepoRequestSuccess(info);
+        return;
+    }
+
+    sendDownloadInfoRequest();
+}
+
+void DownloadRepoDialog::sendDownloadInfoRequest()
+{
     DownloadRepoRequest *req = new DownloadRepoRequest(account_, repo_);
+    req->setParent(this);
     connect(req, SIGNAL(success(const RepoDownloadInfo&)),
             this, SLOT(onDownloadRepoRequestSuccess(const RepoDownloadInfo&)));
     connect(req, SIGNAL(failed(int)),
@@ -123,6 +139,12 @@ void DownloadRepoDialog::setAllInputsEnabled(bool enabled)
 
 void DownloadRepoDialog::onDownloadRepoRequestSuccess(const RepoDownloadInfo& info)
 {
+    DownloadRepoRequest *req = qobject_cast<DownloadRepoRequest *>(sender());
+    if (req) {
+        req->deleteLater();
+        ApiCache::instance()->setDownloadInfo(account_, info);
+    }
+
     QString worktree = mDirectory->text();
     QString password = repo_.encrypted ? mPassword->text() : QString();
     int ret;
@@ -145,6 +167,14 @@ void DownloadRepoDialog::onDownloadRepoRequestSuccess(const RepoDownloadInfo& in
                                                     &error);
     }
 
+    if (ret < 0 && used_cached_info_) {
+        // The cached info may be outdated, try again with a fresh one
+        used_cached_info_ = false;
+        ApiCache::instance()->removeDownloadInfo(account_, repo_.id);
+        sendDownloadInfoRequest();
+        return;
+    }
+
     if (ret < 0) {
         QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
                              tr("Failed to add download task:\n %1").arg(error),
@@ -158,6 +188,8 @@ void DownloadRepoDialog::onDownloadRepoRequestSuccess(const RepoDownloadInfo& in
 
 void DownloadRepoDialog::onDownloadRepoRequestFailed(int code)
 {
+    sender()->deleteLater();
+
     QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
                          tr("Failed to get repo download information"),
                          QMessageBox::Ok);
@@ -28,10 +28,14 @@ private:
     Q_DISABLE_COPY(DownloadRepoDialog);
     bool validateInputs();
     void setAllInputsEnabled(bool enabled);
+    void sendDownloadInfoRequest();
 
     ServerRepo repo_;
 
     bool sync_with_existing_;
 
+    // The download info was prefetched, see ApiCache
+    bool used_cached_info_;
+
     Account account_;
 };
@@ -0,0 +1,152 @@
+#include <QtGui>
+#include <QTimer>
+#include <QFileInfo>
+#include <QDesktopServices>
+
+#include "utils/utils.h"
+#include "seafile-applet.h"
+#include "api/file-downloader.h"
+#include "file-download-dialog.h"
+
+namespace {
+
+const int kRefreshRateInterval = 1000; // 1 sec
+const int kDefaultParallelConnections = 4;
+
+const char *kSettingsGroup = "Download";
+const char *kParallelConnectionsKey = "parallel_connections";
+
+} // namespace
+
+FileDownloadDialog::FileDownloadDialog(const Account& account,
+                                       const QString& repo_id,
+                                       const QString& path,
+                                       const QString& local_path,
+                                       QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Download \"%1\"").arg(QFileInfo(path).fileName()));
+    setWindowIcon(QIcon(":/images/seafile.png"));
+    setMinimumWidth(400);
+
+    status_label_ = new QLabel(tr("Downloading to %1").arg(local_path));
+    status_label_->setWordWrap(true);
+
+    progress_bar_ = new QProgressBar;
+    progress_bar_->setRange(0, 100);
+    progress_bar_->setValue(0);
+    rate_label_ = new QLabel;
+
+    resume_btn_ = new QPushButton(tr("Resume"));
+    resume_btn_->setVisible(false);
+    connect(resume_btn_, SIGNAL(clicked()), this, SLOT(resume()));
+
+    open_folder_btn_ = new QPushButton(tr("Open folder"));
+    open_folder_btn_->setVisible(false);
+    connect(open_folder_btn_, SIGNAL(clicked()), this, SLOT(openFolder()));
+
+    close_btn_ = new QPushButton(tr("Close"));
+    connect(close_btn_, SIGNAL(clicked()), this, SLOT(reject()));
+
+    QHBoxLayout *btn_layout = new QHBoxLayout;
+    btn_layout->addWidget(rate_label_);
+    btn_layout->addStretch();
+    btn_layout->addWidget(resume_btn_);
+    btn_layout->addWidget(open_folder_btn_);
+    btn_layout->addWidget(close_btn_);
+
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->addWidget(status_label_);
+    vlayout->addWidget(progress_bar_);
+    vlayout->addLayout(btn_layout);
+    setLayout(vlayout);
+
+    QSettings settings;
+    settings.beginGroup(kSettingsGroup);
+    int connections = settings.value(kParallelConnectionsKey, kDefaultParallelConnections).toInt();
+    settings.endGroup();
+
+    downloader_ = new FileDownloader(account, repo_id, path, local_path, this);
+    downloader_->setParallelConnections(connections);
+    connect(downloader_, SIGNAL(progress(qint64, qint64)),
+            this, SLOT(onProgress(qint64, qint64)));
+    connect(downloader_, SIGNAL(finished()), this, SLOT(onFinished()));
+    connect(downloader_, SIGNAL(failed(const QString&)), this, SLOT(onFailed(const QString&)));
+
+    rate_timer_ = new QTimer(this);
+    connect(rate_timer_, SIGNAL(timeout()), this, SLOT(updateRate()));
+    rate_timer_->start(kRefreshRateInterval);
+
+    downloader_->start();
+}
+
+void FileDownloadDialog::resume()
+{
+    resume_btn_->setVisible(false);
+    status_label_->setText(tr("Downloading to %1").arg(downloader_->localPath()));
+    rate_timer_->start(kRefreshRateInterval);
+    downloader_->start();
+}
+
+void FileDownloadDialog::onProgress(qint64 downloaded, qint64 total)
+{
+    if (total > 0) {
+        progress_bar_->setRange(0, 100);
+        progress_bar_->setValue(downloaded * 100 / total);
+    } else {
+        // Size unknown
+        progress_bar_->setRange(0, 0);
+    }
+}
+
+void FileDownloadDialog::onFinished()
+{
+    rate_timer_->stop();
+    progress_bar_->setRange(0, 100);
+    progress_bar_->setValue(100);
+    rate_label_->setText("");
+    status_label_->setText(tr("Downloaded to %1").arg(downloader_->localPath()));
+    open_folder_btn_->setVisible(true);
+    close_btn_->setFocus();
+}
+
+void FileDownloadDialog::onFailed(const QString& error)
+{
+    rate_timer_->stop();
+    rate_label_->setText("");
+    status_label_->setText(error);
+
+    resume_btn_->setVisible(true);
+    resume_btn_->setFocus();
+}
+
+void FileDownloadDialog::updateRate()
+{
+    if (downloader_->isRunning()) {
+        rate_label_->setText(tr("%1/s").arg(readableFileSize(downloader_->rate())));
+    }
+}
+
+void FileDownloadDialog::openFolder()
+{
+    QString dir = QFileInfo(downloader_->localPath()).absolutePath();
+    QDesktopServices::openUrl(QUrl::fromLocalFile(dir));
+}
+
+void FileDownloadDialog::reject()
+{
+    if (downloader_->isRunning()) {
+        QString question = tr("Stop downloading?<br>"
+                              "Downloading the file again to the same place resumes it.");
+        if (QMessageBox::question(this,
+                                  tr(SEAFILE_CLIENT_BRAND),
+                                  question,
+                                  QMessageBox::Ok | QMessageBox::Cancel,
+                                  QMessageBox::Cancel) != QMessageBox::Ok) {
+            return;
+        }
+        downloader_->cancel();
+    }
+
+    QDialog::reject();
+}
@@ -0,0 +1,52 @@
+#ifndef SEAFILE_CLIENT_FILE_DOWNLOAD_DIALOG_H
+#define SEAFILE_CLIENT_FILE_DOWNLOAD_DIALOG_H
+
+#include <QDialog>
+
+#include "account.h"
+
+class QTimer;
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class FileDownloader;
+
+/**
+ * Download one file of a library, see FileDownloader
+ */
+class FileDownloadDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    FileDownloadDialog(const Account& account,
+                       const QString& repo_id,
+                       const QString& path,
+                       const QString& local_path,
+                       QWidget *parent=0);
+
+public slots:
+    void reject();
+
+private slots:
+    void resume();
+    void onProgress(qint64 downloaded, qint64 total);
+    void onFinished();
+    void onFailed(const QString& error);
+    void updateRate();
+    void openFolder();
+
+private:
+    Q_DISABLE_COPY(FileDownloadDialog)
+
+    FileDownloader *downloader_;
+    QTimer *rate_timer_;
+
+    QLabel *status_label_;
+    QProgressBar *progress_bar_;
+    QLabel *rate_label_;
+    QPushButton *resume_btn_;
+    QPushButton *open_folder_btn_;
+    QPushButton *close_btn_;
+};
+
+#endif // SEAFILE_CLIENT_FILE_DOWNLOAD_DIALOG_H
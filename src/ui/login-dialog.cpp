@@ -3,7 +3,10 @@
 
 #include "account-mgr.h"
 #include "seafile-applet.h"
+#include "rpc/rpc-client.h"
+#include "rpc/local-repo.h"
 #include "api/requests.h"
+#include "api/api-cache.h"
 #include "login-dialog.h"
 
 namespace {
@@ -11,6 +14,9 @@ namespace {
 const QString kDefaultServerAddr1 = "https://seacloud.cc";
 const QString kDefaultServerAddr2 = "https://cloud.seafile.com";
 
+// Close the dialog even if some of the follow-up requests are still pending
+const int kMaxPrefetchWait = 1000 * 5; // 5 sec
+
 } // namespace
 
 LoginDialog::LoginDialog(QWidget *parent) : QDialog(parent)
@@ -20,6 +26,8 @@ LoginDialog::LoginDialog(QWidget *parent) : QDialog(parent)
     setWindowIcon(QIcon(":/images/seafile.png"));
 
     request_ = NULL;
+    pending_prefetches_ = 0;
+    finished_ = false;
 
     mStatusText->setText("");
     mLogo->setPixmap(QPixmap(":/images/seafile-32.png"));
@@ -138,8 +146,94 @@ bool LoginDialog::validateInputs()
 
 void LoginDialog::loginSuccess(const QString& token)
 {
-    Account account(url_, username_, token);
-    if (seafApplet->accountManager()->saveAccount(account) < 0) {
+    account_ = Account(url_, username_, token);
+
+    mStatusText->setText(tr("Loading libraries..."));
+    prefetchForFirstPaint();
+
+    QTimer::singleShot(kMaxPrefetchWait, this, SLOT(finishLogin()));
+}
+
+/**
+ * Fetch in parallel what the main window shows first, so it is complete
+ * when the dialog closes. The requests are children of the dialog, so any
+ * still pending when it closes are dropped along with it.
+ */
+void LoginDialog::prefetchForFirstPaint()
+{
+    ListReposRequest *repos_req = new ListReposRequest(account_);
+    repos_req->setParent(this);
+    connect(repos_req, SIGNAL(success(const std::vector<ServerRepo>&)),
+            this, SLOT(onReposFetched(const std::vector<ServerRepo>&)));
+    connect(repos_req, SIGNAL(failed(int)), this, SLOT(onPrefetchDone()));
+    repos_req->send();
+    pending_prefetches_++;
+
+    GetSeahubMessagesRequest *messages_req = new GetSeahubMessagesRequest(account_);
+    messages_req->setParent(this);
+    connect(messages_req, SIGNAL(success(int, int)),
+            this, SLOT(onMessagesCountFetched(int, int)));
+    connect(messages_req, SIGNAL(failed(int)), this, SLOT(onPrefetchDone()));
+    messages_req->send();
+    pending_prefetches_++;
+
+    // seaf-daemon is only running when the dialog is opened from the main
+    // window, not on first use
+    if (!seafApplet->mainWindow()) {
+        return;
+    }
+
+    std::vector<LocalRepo> synced_repos;
+    seafApplet->rpcClient()->listAccountRepos(url_.host(), username_, &synced_repos);
+    for (int i = 0, n = synced_repos.size(); i < n; i++) {
+        ServerRepo repo;
+        repo.id = synced_repos[i].id;
+        repo.name = synced_repos[i].name;
+
+        DownloadRepoRequest *req = new DownloadRepoRequest(account_, repo);
+        req->setParent(this);
+        req->setPriority(QNetworkRequest::LowPriority);
+        connect(req, SIGNAL(success(const RepoDownloadInfo&)),
+                this, SLOT(onDownloadInfoFetched(const RepoDownloadInfo&)));
+        connect(req, SIGNAL(failed(int)), this, SLOT(onPrefetchDone()));
+        req->send();
+        pending_prefetches_++;
+    }
+}
+
+void LoginDialog::onReposFetched(const std::vector<ServerRepo>& repos)
+{
+    ApiCache::instance()->setRepos(account_, repos);
+    onPrefetchDone();
+}
+
+void LoginDialog::onMessagesCountFetched(int group_messages, int personal_messages)
+{
+    ApiCache::instance()->setMessagesCount(account_, group_messages, personal_messages);
+    onPrefetchDone();
+}
+
+void LoginDialog::onDownloadInfoFetched(const RepoDownloadInfo& info)
+{
+    ApiCache::instance()->setDownloadInfo(account_, info);
+    onPrefetchDone();
+}
+
+void LoginDialog::onPrefetchDone()
+{
+    if (--pending_prefetches_ <= 0) {
+        finishLogin();
+    }
+}
+
+void LoginDialog::finishLogin()
+{
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+
+    if (seafApplet->accountManager()->saveAccount(account_) < 0) {
         QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
                              tr("Internal Error"),
                              QMessageBox::Ok);
@@ -1,14 +1,18 @@
 #ifndef SEAFILE_CLIENT_LOGIN_DIALOG_H
 #define SEAFILE_CLIENT_LOGIN_DIALOG_H
 
+#include <vector>
 #include <QDialog>
 #include "ui_login-dialog.h"
 
 #include <QUrl>
 #include <QString>
 
-struct Account;
+#include "account.h"
+
 class LoginRequest;
+class RepoDownloadInfo;
+class ServerRepo;
 class QNetworkReply;
 class QSslError;
 
@@ -24,15 +28,26 @@ private slots:
     void loginSuccess(const QString& token);
     void loginFailed(int code);
     void onSslErrors(QNetworkReply *reply, const QList<QSslError>& errors);
+    void onReposFetched(const std::vector<ServerRepo>& repos);
+    void onMessagesCountFetched(int group_messages, int personal_messages);
+    void onDownloadInfoFetched(const RepoDownloadInfo& info);
+    void onPrefetchDone();
+    void finishLogin();
 
 private:
     Q_DISABLE_COPY(LoginDialog);
     bool validateInputs();
+    void prefetchForFirstPaint();
 
     QUrl url_;
     QString username_;
     QString password_;
     LoginRequest *request_;
+
+    // Requests sent as soon as the token arrives
+    Account account_;
+    int pending_prefetches_;
+    bool finished_;
 };
 
 #endif // SEAFILE_CLIENT_LOGIN_DIALOG_H
@@ -0,0 +1,132 @@
+#include <QtGui>
+#include <QTreeView>
+#include <QHeaderView>
+
+#include "seafile-applet.h"
+#include "configurator.h"
+#include "file-download-dialog.h"
+#include "repo-browser-model.h"
+#include "repo-browser-dialog.h"
+
+RepoBrowserDialog::RepoBrowserDialog(const Account& account,
+                                     const ServerRepo& repo,
+                                     QWidget *parent)
+    : QDialog(parent),
+      account_(account),
+      repo_(repo),
+      loading_(0)
+{
+    setWindowTitle(tr("Library \"%1\"").arg(repo.name));
+    setWindowIcon(QIcon(":/images/seafile.png"));
+    setMinimumSize(QSize(600, 400));
+
+    model_ = new RepoBrowserModel(account, repo, this);
+    connect(model_, SIGNAL(loadingStarted(const QString&)),
+            this, SLOT(onLoadingStarted(const QString&)));
+    connect(model_, SIGNAL(loadingFinished(const QString&)),
+            this, SLOT(onLoadingFinished(const QString&)));
+    connect(model_, SIGNAL(loadingFailed(const QString&)),
+            this, SLOT(onLoadingFailed(const QString&)));
+
+    tree_ = new QTreeView;
+    // All rows are of the same height, so the view does not need to lay out
+    // every row of a large folder
+    tree_->setUniformRowHeights(true);
+    tree_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    tree_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    tree_->header()->setStretchLastSection(false);
+    tree_->header()->setResizeMode(RepoBrowserModel::COLUMN_NAME, QHeaderView::Stretch);
+    tree_->setModel(model_);
+    connect(tree_, SIGNAL(doubleClicked(const QModelIndex&)),
+            this, SLOT(downloadFile(const QModelIndex&)));
+    connect(tree_->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
+            this, SLOT(updateDownloadButton()));
+
+    status_label_ = new QLabel;
+    retry_btn_ = new QPushButton(tr("Retry"));
+    retry_btn_->setVisible(false);
+    connect(retry_btn_, SIGNAL(clicked()), this, SLOT(retry()));
+
+    download_btn_ = new QPushButton(tr("Download"));
+    download_btn_->setEnabled(false);
+    connect(download_btn_, SIGNAL(clicked()), this, SLOT(downloadSelectedFile()));
+
+    QPushButton *close_btn = new QPushButton(tr("Close"));
+    connect(close_btn, SIGNAL(clicked()), this, SLOT(accept()));
+
+    QHBoxLayout *btn_layout = new QHBoxLayout;
+    btn_layout->addWidget(status_label_);
+    btn_layout->addStretch();
+    btn_layout->addWidget(retry_btn_);
+    btn_layout->addWidget(download_btn_);
+    btn_layout->addWidget(close_btn);
+
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->addWidget(tree_);
+    vlayout->addLayout(btn_layout);
+    setLayout(vlayout);
+
+    // The root folder, the view only asks for the children of expanded ones
+    if (model_->canFetchMore(QModelIndex())) {
+        model_->fetchMore(QModelIndex());
+    }
+}
+
+void RepoBrowserDialog::onLoadingStarted(const QString& path)
+{
+    loading_++;
+    status_label_->setText(tr("Loading %1 ...").arg(path));
+}
+
+void RepoBrowserDialog::onLoadingFinished(const QString& /* path */)
+{
+    loading_--;
+    if (loading_ == 0) {
+        status_label_->setText("");
+    }
+}
+
+void RepoBrowserDialog::onLoadingFailed(const QString& path)
+{
+    loading_--;
+    status_label_->setText(tr("Failed to load %1").arg(path));
+    retry_btn_->setVisible(true);
+}
+
+void RepoBrowserDialog::retry()
+{
+    retry_btn_->setVisible(false);
+    status_label_->setText("");
+    model_->retryFailed();
+}
+
+void RepoBrowserDialog::updateDownloadButton()
+{
+    QModelIndex index = tree_->currentIndex();
+    download_btn_->setEnabled(index.isValid() && !model_->direntOf(index).isDir());
+}
+
+void RepoBrowserDialog::downloadSelectedFile()
+{
+    downloadFile(tree_->currentIndex());
+}
+
+void RepoBrowserDialog::downloadFile(const QModelIndex& index)
+{
+    if (!index.isValid() || model_->direntOf(index).isDir()) {
+        return;
+    }
+
+    const ServerDirent& dirent = model_->direntOf(index);
+    QString path = model_->pathOf(index);
+
+    QString default_path = QDir(seafApplet->configurator()->worktreeDir()).filePath(dirent.name);
+    QString local_path = QFileDialog::getSaveFileName(this, tr("Save as"), default_path);
+    if (local_path.isEmpty()) {
+        return;
+    }
+
+    FileDownloadDialog *dialog = new FileDownloadDialog(account_, repo_.id, path, local_path, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
@@ -0,0 +1,49 @@
+#ifndef SEAFILE_CLIENT_REPO_BROWSER_DIALOG_H
+#define SEAFILE_CLIENT_REPO_BROWSER_DIALOG_H
+
+#include <QDialog>
+
+#include "account.h"
+#include "api/server-repo.h"
+
+class QTreeView;
+class QLabel;
+class QPushButton;
+class RepoBrowserModel;
+
+/**
+ * Browse the files and folders of a library on the server, without syncing
+ * it, see RepoBrowserModel
+ */
+class RepoBrowserDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    RepoBrowserDialog(const Account& account, const ServerRepo& repo, QWidget *parent=0);
+
+private slots:
+    void onLoadingStarted(const QString& path);
+    void onLoadingFinished(const QString& path);
+    void onLoadingFailed(const QString& path);
+    void retry();
+    void downloadFile(const QModelIndex& index);
+    void downloadSelectedFile();
+    void updateDownloadButton();
+
+private:
+    Q_DISABLE_COPY(RepoBrowserDialog)
+
+    Account account_;
+    ServerRepo repo_;
+    RepoBrowserModel *model_;
+
+    QTreeView *tree_;
+    QLabel *status_label_;
+    QPushButton *retry_btn_;
+    QPushButton *download_btn_;
+
+    // Folders being listed
+    int loading_;
+};
+
+#endif // SEAFILE_CLIENT_REPO_BROWSER_DIALOG_H
@@ -0,0 +1,315 @@
+#include <QFileIconProvider>
+#include <QDir>
+
+#include "utils/utils.h"
+#include "api/requests.h"
+#include "api/api-cache.h"
+#include "repo-browser-model.h"
+
+namespace {
+
+// Rows inserted on each fetchMore() of a listed folder
+const int kFetchBatchSize = 500;
+
+const QFileIconProvider& iconProvider()
+{
+    static QFileIconProvider provider;
+    return provider;
+}
+
+} // namespace
+
+RepoBrowserModel::Node::~Node()
+{
+    for (int i = 0, n = children.size(); i < n; i++) {
+        delete children[i];
+    }
+}
+
+RepoBrowserModel::RepoBrowserModel(const Account& account,
+                                   const ServerRepo& repo,
+                                   QObject *parent)
+    : QAbstractItemModel(parent),
+      account_(account),
+      repo_(repo)
+{
+    root_ = new Node;
+    root_->dirent.type = ServerDirent::DIR;
+    // The root folder object of the latest commit
+    root_->dirent.id = repo.root;
+    root_->dirent.name = repo.name;
+    root_->path = "/";
+}
+
+RepoBrowserModel::~RepoBrowserModel()
+{
+    // Pending requests are children of the model, and go away with it
+    delete root_;
+}
+
+RepoBrowserModel::Node* RepoBrowserModel::nodeOf(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return root_;
+    }
+
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex RepoBrowserModel::indexOf(Node *node) const
+{
+    if (node == root_) {
+        return QModelIndex();
+    }
+
+    return createIndex(node->row, 0, node);
+}
+
+QModelIndex RepoBrowserModel::index(int row, int column, const QModelIndex& parent) const
+{
+    Node *node = nodeOf(parent);
+    if (row < 0 || row >= (int)node->children.size() || column < 0 || column >= MAX_COLUMN) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, node->children[row]);
+}
+
+QModelIndex RepoBrowserModel::parent(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+
+    return indexOf(nodeOf(index)->parent);
+}
+
+int RepoBrowserModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    return nodeOf(parent)->children.size();
+}
+
+int RepoBrowserModel::columnCount(const QModelIndex& /* parent */) const
+{
+    return MAX_COLUMN;
+}
+
+bool RepoBrowserModel::hasChildren(const QModelIndex& parent) const
+{
+    Node *node = nodeOf(parent);
+    if (!node->dirent.isDir() || parent.column() > 0) {
+        return false;
+    }
+
+    // Unknown until the folder is listed
+    return !node->listed || !node->dirents.empty();
+}
+
+bool RepoBrowserModel::canFetchMore(const QModelIndex& parent) const
+{
+    Node *node = nodeOf(parent);
+    if (!node->dirent.isDir()) {
+        return false;
+    }
+
+    if (!node->listed) {
+        return !node->request && !node->failed;
+    }
+
+    return node->children.size() < node->dirents.size();
+}
+
+void RepoBrowserModel::fetchMore(const QModelIndex& parent)
+{
+    Node *node = nodeOf(parent);
+    if (!node->dirent.isDir()) {
+        return;
+    }
+
+    if (!node->listed) {
+        listDir(node);
+    } else {
+        insertNextBatch(node);
+    }
+}
+
+void RepoBrowserModel::retryFailed()
+{
+    retryFailed(root_);
+}
+
+void RepoBrowserModel::retryFailed(Node *node)
+{
+    if (node->failed) {
+        node->failed = false;
+        listDir(node);
+        return;
+    }
+
+    for (int i = 0, n = node->children.size(); i < n; i++) {
+        if (node->children[i]->dirent.isDir()) {
+            retryFailed(node->children[i]);
+        }
+    }
+}
+
+void RepoBrowserModel::listDir(Node *node)
+{
+    if (node->request) {
+        return;
+    }
+
+    std::vector<ServerDirent> dirents;
+    if (ApiCache::instance()->dirents(account_, repo_.id, node->dirent.id, &dirents)) {
+        setDirents(node, dirents);
+        return;
+    }
+
+    node->request = new GetDirentsRequest(account_, repo_.id, node->path);
+    node->request->setParent(this);
+    connect(node->request, SIGNAL(success(const QString&, const std::vector<ServerDirent>&)),
+            this, SLOT(onDirentsFetched(const QString&, const std::vector<ServerDirent>&)));
+    connect(node->request, SIGNAL(failed(int)), this, SLOT(onDirentsFailed(int)));
+    requests_.insert(node->request, node);
+    node->request->send();
+
+    emit loadingStarted(node->path);
+}
+
+void RepoBrowserModel::onDirentsFetched(const QString& dir_id,
+                                        const std::vector<ServerDirent>& dirents)
+{
+    GetDirentsRequest *req = qobject_cast<GetDirentsRequest *>(sender());
+    Node *node = requests_.take(req);
+    req->deleteLater();
+    if (!node) {
+        return;
+    }
+    node->request = NULL;
+
+    ApiCache::instance()->setDirents(account_, repo_.id,
+                                     dir_id.isEmpty() ? node->dirent.id : dir_id,
+                                     dirents);
+
+    setDirents(node, dirents);
+    emit loadingFinished(node->path);
+}
+
+void RepoBrowserModel::onDirentsFailed(int code)
+{
+    GetDirentsRequest *req = qobject_cast<GetDirentsRequest *>(sender());
+    Node *node = requests_.take(req);
+    req->deleteLater();
+    if (!node) {
+        return;
+    }
+    node->request = NULL;
+
+    qDebug("failed to list folder %s of repo %s: %d\n",
+           toCStr(node->path), toCStr(repo_.id), code);
+
+    // Not listed again until retry(), or the view would keep asking
+    node->failed = true;
+    emit loadingFailed(node->path);
+}
+
+void RepoBrowserModel::setDirents(Node *node, const std::vector<ServerDirent>& dirents)
+{
+    node->listed = true;
+    node->dirents = dirents;
+
+    insertNextBatch(node);
+
+    if (node != root_) {
+        // An empty folder loses its expand indicator
+        QModelIndex index = indexOf(node);
+        emit dataChanged(index, index);
+    }
+}
+
+void RepoBrowserModel::insertNextBatch(Node *node)
+{
+    int first = node->children.size();
+    int last = qMin(first + kFetchBatchSize, (int)node->dirents.size()) - 1;
+    if (last < first) {
+        return;
+    }
+
+    beginInsertRows(indexOf(node), first, last);
+    for (int i = first; i <= last; i++) {
+        Node *child = new Node;
+        child->dirent = node->dirents[i];
+        child->parent = node;
+        child->row = i;
+        child->path = QDir(node->path).filePath(child->dirent.name);
+        node->children.push_back(child);
+    }
+    endInsertRows();
+}
+
+QString RepoBrowserModel::pathOf(const QModelIndex& index) const
+{
+    return nodeOf(index)->path;
+}
+
+const ServerDirent& RepoBrowserModel::direntOf(const QModelIndex& index) const
+{
+    return nodeOf(index)->dirent;
+}
+
+QVariant RepoBrowserModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const ServerDirent& dirent = nodeOf(index)->dirent;
+
+    if (role == Qt::DecorationRole && index.column() == COLUMN_NAME) {
+        return iconProvider().icon(dirent.isDir() ? QFileIconProvider::Folder
+                                   : QFileIconProvider::File);
+    }
+
+    if (role == Qt::ToolTipRole && index.column() == COLUMN_NAME) {
+        return pathOf(index);
+    }
+
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case COLUMN_NAME:
+        return dirent.name;
+    case COLUMN_SIZE:
+        return dirent.isDir() ? QString() : readableFileSize(dirent.size);
+    case COLUMN_MTIME:
+        return dirent.mtime > 0 ? translateCommitTime(dirent.mtime) : QString();
+    default:
+        return QVariant();
+    }
+}
+
+QVariant RepoBrowserModel::headerData(int section,
+                                      Qt::Orientation orientation,
+                                      int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case COLUMN_NAME:
+        return tr("Name");
+    case COLUMN_SIZE:
+        return tr("Size");
+    case COLUMN_MTIME:
+        return tr("Last Modified");
+    default:
+        return QVariant();
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SEAFILE_CLIENT_REPO_BROWSER_MODEL_H
+#define SEAFILE_CLIENT_REPO_BROWSER_MODEL_H
+
+#include <vector>
+#include <QAbstractItemModel>
+#include <QHash>
+
+#include "account.h"
+#include "api/server-repo.h"
+#include "api/server-dirent.h"
+
+class GetDirentsRequest;
+
+/**
+ * Tree model of the files and folders of a library on the server.
+ *
+ * A folder is listed only when the view expands it, through canFetchMore()
+ * and fetchMore(). Its entries are then inserted in batches as the view
+ * scrolls down, so a folder with 100k entries costs no more than what is
+ * shown.
+ */
+class RepoBrowserModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    enum {
+        COLUMN_NAME = 0,
+        COLUMN_SIZE,
+        COLUMN_MTIME,
+        MAX_COLUMN
+    };
+
+    RepoBrowserModel(const Account& account, const ServerRepo& repo, QObject *parent=0);
+    ~RepoBrowserModel();
+
+    QModelIndex index(int row, int column, const QModelIndex& parent=QModelIndex()) const;
+    QModelIndex parent(const QModelIndex& index) const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    int columnCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role=Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+    bool hasChildren(const QModelIndex& parent=QModelIndex()) const;
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
+
+    // List again the folders which failed to load
+    void retryFailed();
+
+    // e.g. "/docs/2014"
+    QString pathOf(const QModelIndex& index) const;
+    const ServerDirent& direntOf(const QModelIndex& index) const;
+
+signals:
+    void loadingStarted(const QString& path);
+    void loadingFinished(const QString& path);
+    void loadingFailed(const QString& path);
+
+private slots:
+    void onDirentsFetched(const QString& dir_id, const std::vector<ServerDirent>& dirents);
+    void onDirentsFailed(int code);
+
+private:
+    Q_DISABLE_COPY(RepoBrowserModel)
+
+    struct Node {
+        ServerDirent dirent;
+        Node *parent;
+        int row;
+        QString path;
+
+        // Set once the folder is listed. Only the first children.size()
+        // entries are rows of the model yet.
+        bool listed;
+        bool failed;
+        std::vector<ServerDirent> dirents;
+        std::vector<Node*> children;
+
+        GetDirentsRequest *request;
+
+        Node() : parent(NULL), row(0), listed(false), failed(false), request(NULL) {}
+        ~Node();
+    };
+
+    Node *nodeOf(const QModelIndex& index) const;
+    QModelIndex indexOf(Node *node) const;
+
+    void listDir(Node *node);
+    void setDirents(Node *node, const std::vector<ServerDirent>& dirents);
+    void insertNextBatch(Node *node);
+    void retryFailed(Node *node);
+
+    Account account_;
+    ServerRepo repo_;
+
+    Node *root_;
+    QHash<GetDirentsRequest*, Node*> requests_;
+};
+
+#endif // SEAFILE_CLIENT_REPO_BROWSER_MODEL_H
@@ -0,0 +1,132 @@
+#include <QTimer>
+
+#include "repo-item.h"
+#include "repo-tree-model.h"
+#include "repo-filter-proxy-model.h"
+
+namespace {
+
+// Coalesce the rows inserted or removed by one refresh
+const int kRefilterDelay = 0;
+
+} // namespace
+
+RepoFilterProxyModel::RepoFilterProxyModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{
+    refilter_timer_ = new QTimer(this);
+    refilter_timer_->setSingleShot(true);
+    connect(refilter_timer_, SIGNAL(timeout()), this, SLOT(refilter()));
+}
+
+void RepoFilterProxyModel::setSourceModel(QAbstractItemModel *model)
+{
+    if (sourceModel()) {
+        sourceModel()->disconnect(this);
+    }
+
+    matched_keys_.clear();
+
+    // Search before the new rows are filtered
+    QSortFilterProxyModel::setSourceModel(NULL);
+    if (model && isFiltering()) {
+        ((RepoTreeModel *)model)->searchRepos(filter_text_, &matched_keys_);
+    }
+    QSortFilterProxyModel::setSourceModel(model);
+
+    if (model) {
+        connect(model, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+                this, SLOT(scheduleRefilter()));
+        connect(model, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
+                this, SLOT(scheduleRefilter()));
+        connect(model, SIGNAL(searchTextChanged()),
+                this, SLOT(scheduleRefilter()));
+        connect(model, SIGNAL(modelReset()),
+                this, SLOT(scheduleRefilter()));
+    }
+
+    if (isFiltering()) {
+        emit refiltered();
+    }
+}
+
+RepoTreeModel* RepoFilterProxyModel::treeModel() const
+{
+    return (RepoTreeModel *)sourceModel();
+}
+
+void RepoFilterProxyModel::setFilterText(const QString& text)
+{
+    QString filter_text = text.simplified();
+    if (filter_text == filter_text_) {
+        return;
+    }
+
+    filter_text_ = filter_text;
+    search();
+    invalidateFilter();
+
+    if (isFiltering()) {
+        emit refiltered();
+    }
+}
+
+bool RepoFilterProxyModel::search()
+{
+    QSet<QString> keys;
+    if (isFiltering() && treeModel()) {
+        treeModel()->searchRepos(filter_text_, &keys);
+    }
+
+    if (keys == matched_keys_) {
+        return false;
+    }
+
+    matched_keys_.swap(keys);
+    return true;
+}
+
+void RepoFilterProxyModel::scheduleRefilter()
+{
+    if (isFiltering() && !refilter_timer_->isActive()) {
+        refilter_timer_->start(kRefilterDelay);
+    }
+}
+
+void RepoFilterProxyModel::refilter()
+{
+    if (!isFiltering() || !search()) {
+        return;
+    }
+
+    invalidateFilter();
+    emit refiltered();
+}
+
+bool RepoFilterProxyModel::filterAcceptsRow(int source_row,
+                                            const QModelIndex& source_parent) const
+{
+    if (!isFiltering()) {
+        return true;
+    }
+
+    RepoTreeModel *model = treeModel();
+    QModelIndex index = model->index(source_row, 0, source_parent);
+
+    RepoItem *item = model->repoItem(index);
+    if (item) {
+        return matched_keys_.contains(model->itemKey(item));
+    }
+
+    // A category is shown when any of its repos is
+    if (!model->categoryItem(index)) {
+        return false;
+    }
+    for (int row = 0, n = model->rowCount(index); row < n; row++) {
+        RepoItem *child = model->repoItem(model->index(row, 0, index));
+        if (child && matched_keys_.contains(model->itemKey(child))) {
+            return true;
+        }
+    }
+    return false;
+}
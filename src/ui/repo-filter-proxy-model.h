@@ -0,0 +1,60 @@
+#ifndef SEAFILE_CLIENT_REPO_FILTER_PROXY_MODEL_H
+#define SEAFILE_CLIENT_REPO_FILTER_PROXY_MODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QSet>
+
+class QTimer;
+
+class RepoTreeModel;
+
+/**
+ * Shows the repos of a RepoTreeModel matching the text of the filter box,
+ * and the categories listing them.
+ *
+ * The matches come from the search index of the model, which is kept up to
+ * date as repos are added, removed or changed. They are kept as the keys of
+ * the rows, since the slot of a removed item may be reused by another repo.
+ * The items themselves are never copied or rebuilt.
+ */
+class RepoFilterProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+public:
+    explicit RepoFilterProxyModel(QObject *parent=0);
+
+    void setSourceModel(QAbstractItemModel *model);
+    RepoTreeModel *treeModel() const;
+
+    void setFilterText(const QString& text);
+    const QString& filterText() const { return filter_text_; }
+    bool isFiltering() const { return !filter_text_.isEmpty(); }
+
+signals:
+    // Emitted after the rows shown have changed because of the filter
+    void refiltered();
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
+
+private slots:
+    void scheduleRefilter();
+    void refilter();
+
+private:
+    Q_DISABLE_COPY(RepoFilterProxyModel)
+
+    // Return whether the matches differ from the last search
+    bool search();
+
+    QString filter_text_;
+    // RepoTreeModel::itemKey() of the matching repos
+    QSet<QString> matched_keys_;
+
+    // Rows added, removed or renamed are matched again once the model
+    // settles. Other changes, e.g. of the sync state, leave the matches
+    // as they are.
+    QTimer *refilter_timer_;
+};
+
+#endif // SEAFILE_CLIENT_REPO_FILTER_PROXY_MODEL_H
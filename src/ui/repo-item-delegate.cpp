@@ -33,6 +33,7 @@ const int kRepoNameWidth = 180;
 const int kRepoNameHeight = 30;
 const int kRepoStatusIconWidth = 24;
 const int kRepoStatusIconHeight = 24;
+const int kRepoStatusIconRightOffset = 50;
 
 const int kRepoCategoryNameMaxWidth = 400;
 const int kRepoCategoryIndicatorWidth = 16;
@@ -42,7 +43,14 @@ const int kMarginBetweenIndicatorAndName = 5;
 const int kMarginBetweenRepoIconAndName = 5;
 const int kMarginBetweenRepoNameAndStatus = 5;
 
-
+// Where the status icon of a repo row is painted, also used to tell whether
+// the mouse is over it
+QRect statusIconRect(const QRect& row_rect)
+{
+    QPoint pos = row_rect.topRight() - QPoint(kRepoStatusIconRightOffset, 0);
+    pos.setY(row_rect.center().y() - (kRepoStatusIconHeight / 2));
+    return QRect(pos, QSize(kRepoStatusIconWidth, kRepoStatusIconHeight));
+}
 
 QString fitTextToWidth(const QString& text, const QFont& font, int width)
 {
@@ -89,54 +97,58 @@ RepoItemDelegate::RepoItemDelegate(QObject *parent)
 {
 }
 
+/**
+ * All repo rows have the same size, and so do all category rows, so the
+ * view can lay out the tree without visiting the rows out of sight. The
+ * model is not asked for the item, the type of the row is enough.
+ */
 QSize RepoItemDelegate::sizeHint(const QStyleOptionViewItem &option,
                                  const QModelIndex &index) const
 {
-    QStandardItem *item = getItem(index);
-    if (!item) {
+    if (!index.isValid()) {
         return QStyledItemDelegate::sizeHint(option, index);
     }
 
-    if (item->type() == REPO_ITEM_TYPE) {
-        return sizeHintForRepoItem(option, (const RepoItem *)item);
-    } else {
-        // return QStyledItemDelegate::sizeHint(option, index);
-        return sizeHintForRepoCategoryItem(option, (const RepoCategoryItem *)item);
+    // Repo rows are children of category rows
+    if (index.parent().isValid()) {
+        return sizeHintForRepoItem();
     }
+
+    return sizeHintForRepoCategoryItem(option.font);
 }
 
-QSize RepoItemDelegate::sizeHintForRepoItem(const QStyleOptionViewItem &option,
-                                            const RepoItem *item) const
+QSize RepoItemDelegate::sizeHintForRepoItem() const
 {
-
     int width = kMarginLeft + kRepoIconWidth
         + kMarginBetweenRepoIconAndName + kRepoNameWidth
-        + kMarginBetweenRepoNameAndStatus + kRepoStatusIconWidth;
+        + kMarginBetweenRepoNameAndStatus + kRepoStatusIconWidth
         + kMarginRight + kPadding * 2;
 
     int height = kRepoIconHeight + kPadding * 2 + kMarginTop + kMarginBottom;
 
-    // qDebug("width = %d, height = %d\n", width, height);
-
     return QSize(width, height);
 }
 
-QSize RepoItemDelegate::sizeHintForRepoCategoryItem(const QStyleOptionViewItem &option,
-                                                    const RepoCategoryItem *item) const
+// Only depends on the font, so it is measured again when the font changes
+QSize RepoItemDelegate::sizeHintForRepoCategoryItem(const QFont& font) const
 {
-    int width, height;
+    if (category_size_hint_.isValid() && font == category_font_) {
+        return category_size_hint_;
+    }
 
-	QFontMetrics qfm(option.font);
-    QSize size = qfm.size(0, item->name());
+    QFontMetrics qfm(font);
 
-    width = qMin(size.width(), kRepoCategoryIndicatorWidth)
+    int width = kRepoCategoryIndicatorWidth
         + kMarginBetweenIndicatorAndName + kRepoCategoryNameMaxWidth;
 
-    height = qMax(size.height(), kRepoCategoryIndicatorHeight) + kPadding;
+    int height = qMax(qfm.height(), kRepoCategoryIndicatorHeight) + kPadding;
+
+    category_font_ = font;
+    category_size_hint_ = QSize(width, height);
 
     // qDebug("width = %d, height = %d\n", width, height);
 
-    return QSize(width, height);
+    return category_size_hint_;
 }
 
 
@@ -144,22 +156,26 @@ void RepoItemDelegate::paint(QPainter *painter,
                              const QStyleOptionViewItem& option,
                              const QModelIndex& index) const
 {
-    QStandardItem *item = getItem(index);
-    if (!item) {
-        QStyledItemDelegate::paint(painter, option, index);
+    QModelIndex source = RepoTreeModel::sourceIndex(index);
+    const RepoTreeModel *model = (const RepoTreeModel *)source.model();
+    const RepoItem *item = model->repoItem(source);
+    if (item) {
+        paintRepoItem(painter, option, model, item);
         return;
     }
 
-    if (item->type() == REPO_ITEM_TYPE) {
-        paintRepoItem(painter, option, (RepoItem *)item);
-    } else {
-        // QStyledItemDelegate::paint(painter, option, index);
-        paintRepoCategoryItem(painter, option, (RepoCategoryItem *)item);
+    const RepoCategoryItem *category = model->categoryItem(source);
+    if (category) {
+        paintRepoCategoryItem(painter, option, index, category);
+        return;
     }
+
+    QStyledItemDelegate::paint(painter, option, index);
 }
 
 void RepoItemDelegate::paintRepoItem(QPainter *painter,
                                      const QStyleOptionViewItem& option,
+                                     const RepoTreeModel *model,
                                      const RepoItem *item) const
 {
     const ServerRepo& repo = item->repo();
@@ -222,8 +238,8 @@ void RepoItemDelegate::paintRepoItem(QPainter *painter,
     painter->setFont(zoomFont(painter->font(), 0.8));
 
     QString description;
-    if (item->cloneTask().isValid() && item->cloneTask().isDisplayable()) {
-        description = item->cloneTask().state_str;
+    if (model->downloadProgress(item) >= 0) {
+        description = model->cloneTask(item).state_str;
     } else {
         description = translateCommitTime(repo.mtime);
     }
@@ -235,35 +251,18 @@ void RepoItemDelegate::paintRepoItem(QPainter *painter,
     painter->restore();
 
     // Paint repo status icon
-    QPoint status_icon_pos = option.rect.topRight() - QPoint(50, 0);
-    status_icon_pos.setY(option.rect.center().y() - (kRepoStatusIconHeight / 2));
-    QRect status_icon_rect(status_icon_pos, QSize(kRepoStatusIconWidth, kRepoStatusIconHeight));
-    if (!item->localRepo().isValid()
-        || item->localRepo().sync_state != LocalRepo::SYNC_STATE_WAITING) {
-
+    QPoint status_icon_pos = statusIconRect(option.rect).topLeft();
+    int sync_state = model->syncState(item);
+    if (sync_state != LocalRepo::SYNC_STATE_WAITING) {
         painter->save();
-        painter->drawPixmap(status_icon_pos, getSyncStatusIcon(item));
+        painter->drawPixmap(status_icon_pos, getSyncStatusIcon(sync_state));
         painter->restore();
     }
-
-    // Update the metrics of this item
-    RepoItem::Metrics metrics;
-    QPoint shift(-option.rect.topLeft().x(), -option.rect.topLeft().y());
-    metrics.icon_rect = QRect(repo_icon_pos, QSize(kRepoIconWidth, kRepoIconHeight));
-    metrics.name_rect = repo_name_rect;
-    metrics.subtitle_rect = repo_desc_rect;
-    metrics.status_icon_rect = status_icon_rect;
-
-    metrics.icon_rect.translate(shift);
-    metrics.name_rect.translate(shift);
-    metrics.subtitle_rect.translate(shift);
-    metrics.status_icon_rect.translate(shift);
-
-    item->setMetrics(metrics);
 }
 
 void RepoItemDelegate::paintRepoCategoryItem(QPainter *painter,
                                              const QStyleOptionViewItem& option,
+                                             const QModelIndex& index,
                                              const RepoCategoryItem *item) const
 {
     QBrush backBrush;
@@ -294,9 +293,9 @@ void RepoItemDelegate::paintRepoCategoryItem(QPainter *painter,
     painter->restore();
 
     // Paint the expand/collapse indicator
-    RepoTreeModel *model = (RepoTreeModel *)item->model();
+    RepoTreeModel *model = (RepoTreeModel *)RepoTreeModel::sourceIndex(index).model();
     RepoTreeView *view = model->treeView();
-    bool expanded = view->isExpanded(model->indexFromItem(item));
+    bool expanded = view->isExpanded(index);
 
     QRect indicator_rect(option.rect.topLeft(),
                          option.rect.bottomLeft() + QPoint(option.rect.height(), 0));
@@ -317,20 +316,19 @@ void RepoItemDelegate::paintRepoCategoryItem(QPainter *painter,
     painter->setPen(foreColor);
     painter->drawText(category_name_rect,
                       Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap,
-                      fitTextToWidth(item->name() + QString().sprintf(" [%d]", item->rowCount()),
+                      fitTextToWidth(item->name() + QString().sprintf(" [%d]", item->repoCount()),
                                      option.font, category_name_rect.width()));
     painter->restore();
 }
 
-QPixmap RepoItemDelegate::getSyncStatusIcon(const RepoItem *item) const
+QPixmap RepoItemDelegate::getSyncStatusIcon(int sync_state) const
 {
     const QString prefix = ":/images/sync/";
-    const LocalRepo& repo = item->localRepo();
     QString icon;
-    if (!repo.isValid()) {
+    if (sync_state < 0) {
         icon = "cloud";
     } else {
-        switch (repo.sync_state) {
+        switch (sync_state) {
         case LocalRepo::SYNC_STATE_DONE:
             icon = "ok";
             break;
@@ -355,28 +353,14 @@ QPixmap RepoItemDelegate::getSyncStatusIcon(const RepoItem *item) const
     return prefix + icon + ".png";
 }
 
-QStandardItem* RepoItemDelegate::getItem(const QModelIndex &index) const
-{
-    if (!index.isValid()) {
-        return NULL;
-    }
-    const RepoTreeModel *model = (const RepoTreeModel*)index.model();
-    QStandardItem *item = model->itemFromIndex(index);
-    if (item->type() != REPO_ITEM_TYPE &&
-        item->type() != REPO_CATEGORY_TYPE) {
-        return NULL;
-    }
-    return item;
-}
-
-void RepoItemDelegate::showRepoItemToolTip(const RepoItem *item,
+void RepoItemDelegate::showRepoItemToolTip(const RepoTreeModel *model,
+                                           const RepoItem *item,
                                            const QPoint& global_pos,
                                            QWidget *viewport,
                                            const QRect& rect) const
 {
-    const RepoItem::Metrics& metrics = item->metrics();
-
-    const QRect& status_icon_rect = metrics.status_icon_rect;
+    // Relative to the row, like viewpos below
+    QRect status_icon_rect = statusIconRect(rect).translated(-rect.topLeft());
 
     QPoint viewpos = viewport->mapFromGlobal(global_pos);
     viewpos -= rect.topLeft();
@@ -390,7 +374,7 @@ void RepoItemDelegate::showRepoItemToolTip(const RepoItem *item,
     }
 
     QString text = "<p style='white-space:pre'>";
-    const LocalRepo& local_repo = item->localRepo();
+    const LocalRepo& local_repo = model->localRepo(item);
     if (!local_repo.isValid()) {
         text += tr("This library has not been downloaded");
     } else {
@@ -2,14 +2,16 @@
 #define SEAFILE_CLIENT_REPO_ITEM_DELEGATE_H
 
 #include <QStyledItemDelegate>
+#include <QFont>
+#include <QSize>
 
-class QStandardItem;
 class QModelIndex;
 class QWidget;
 
 class ServerRepo;
 class RepoItem;
 class RepoCategoryItem;
+class RepoTreeModel;
 
 class RepoItemDelegate : public QStyledItemDelegate {
     Q_OBJECT
@@ -23,7 +25,8 @@ public:
     QSize sizeHint(const QStyleOptionViewItem& option,
                    const QModelIndex& index) const;
 
-    void showRepoItemToolTip(const RepoItem *item,
+    void showRepoItemToolTip(const RepoTreeModel *model,
+                             const RepoItem *item,
                              const QPoint& global_pos,
                              QWidget *viewport,
                              const QRect& rect) const;
@@ -31,22 +34,26 @@ public:
 private:
     void matchCurrentItem(const QStyleOptionViewItem& option,
                           const ServerRepo& repo) const;
-    QStandardItem* getItem(const QModelIndex &index) const;
     void paintRepoItem(QPainter *painter,
                        const QStyleOptionViewItem& opt,
+                       const RepoTreeModel *model,
                        const RepoItem *item) const;
 
     void paintRepoCategoryItem(QPainter *painter,
                                const QStyleOptionViewItem& opt,
+                               const QModelIndex& index,
                                const RepoCategoryItem *item) const;
 
-    QSize sizeHintForRepoCategoryItem(const QStyleOptionViewItem &option,
-                                      const RepoCategoryItem *item) const;
+    QSize sizeHintForRepoCategoryItem(const QFont& font) const;
 
-    QSize sizeHintForRepoItem(const QStyleOptionViewItem &option,
-                              const RepoItem *item) const;
+    QSize sizeHintForRepoItem() const;
 
-    QPixmap getSyncStatusIcon(const RepoItem *item) const;
+    // See RepoTreeModel::syncState()
+    QPixmap getSyncStatusIcon(int sync_state) const;
+
+    // The size of category rows for the font it was measured with
+    mutable QFont category_font_;
+    mutable QSize category_size_hint_;
 };
 
 
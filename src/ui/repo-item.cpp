@@ -1,55 +1,48 @@
-#include "seafile-applet.h"
-#include "rpc/rpc-client.h"
 #include "repo-item.h"
 
-RepoItem::RepoItem(const ServerRepo& repo)
-    : repo_(repo)
-{
-    setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-
-    LocalRepo local_repo;
-    seafApplet->rpcClient()->getLocalRepo(repo.id, &local_repo);
-    setLocalRepo(local_repo);
-}
-
-void RepoItem::setRepo(const ServerRepo& repo)
+RepoItem::RepoItem()
+    : slot_(-1)
 {
-    repo_ = repo;
 }
 
-void RepoItem::setLocalRepo(const LocalRepo& repo)
+RepoItem::RepoItem(const ServerRepo& repo)
+    : repo_(repo),
+      slot_(-1)
 {
-    local_repo_ = repo;
 }
 
-bool RepoItem::repoDownloadable() const
+void RepoItem::setRepo(const ServerRepo& repo)
 {
-    if (local_repo_.isValid()) {
-        return false;
-    }
-
-    if (!clone_task_.isValid()) {
-        return true;
-    }
-
-    QString state = clone_task_.state;
-    if (state == "canceled" || state == "error" || state == "done") {
-        return true;
-    }
-
-    return false;
+    repo_ = repo;
 }
 
 RepoCategoryItem::RepoCategoryItem(const QString& name)
     : name_(name),
-      group_id_(-1)
+      group_id_(-1),
+      row_(0),
+      fetched_(true),
+      unfetched_indexed_(false),
+      collapsed_since_(0)
 {
-    setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
 }
 
 RepoCategoryItem::RepoCategoryItem(const QString& name, int group_id)
     : name_(name),
-      group_id_(group_id)
+      group_id_(group_id),
+      row_(0),
+      fetched_(true),
+      unfetched_indexed_(false),
+      collapsed_since_(0)
+{
+}
+
+RepoCategoryItem::RepoCategoryItem(const Account& account)
+    : name_(account.username + "(" + account.serverUrl.host() + ")"),
+      group_id_(-1),
+      account_(account),
+      row_(0),
+      fetched_(true),
+      unfetched_indexed_(false),
+      collapsed_since_(0)
 {
-    setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
 }
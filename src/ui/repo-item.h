@@ -1,67 +1,47 @@
 #ifndef SEAFILE_CLIENT_REPO_ITEM_H
 #define SEAFILE_CLIENT_REPO_ITEM_H
 
-#include <QStandardItem>
+#include <vector>
+#include "account.h"
 #include "api/server-repo.h"
-#include "rpc/local-repo.h"
-#include "rpc/clone-task.h"
+#include "repo-search-index.h"
 
 #define MY_REPOS "My Libraries"
 #define SHARED_REPOS "Shared Libraries"
 
-enum {
-    REPO_ITEM_TYPE,
-    REPO_CATEGORY_TYPE
-};
-
 /**
  * Represent a repo
+ *
+ * Items are stored by value in RepoTreeModel, which hands out pointers to
+ * them. A pointer stays valid as long as the repo is listed. The sync state
+ * of the repo and its download are kept by the model, see
+ * RepoTreeModel::localRepo().
  */
-class RepoItem : public QStandardItem {
+class RepoItem {
 public:
-    RepoItem(const ServerRepo& repo);
+    RepoItem();
+    explicit RepoItem(const ServerRepo& repo);
 
     void setRepo(const ServerRepo& repo);
-    void setLocalRepo(const LocalRepo& repo);
-
-    virtual int type() const { return REPO_ITEM_TYPE; }
 
     const ServerRepo& repo() const { return repo_; }
-    const LocalRepo& localRepo() const { return local_repo_; }
-
-    /**
-     * Every time the item is painted, we record the metrics of each part of
-     * the item on the screen. So later we the mouse click/hover the item, we
-     * can decide which part is hovered, and to do corresponding actions.
-     */
-    struct Metrics {
-        QRect icon_rect;
-        QRect name_rect;
-        QRect subtitle_rect;
-        QRect status_icon_rect;
-    };
-
-    void setMetrics(const Metrics& metrics) const { metrics_ = metrics; }
-    const Metrics& metrics() const { return metrics_; }
-
-    void setCloneTask(const CloneTask& task=CloneTask()) { clone_task_ = task; }
-    const CloneTask& cloneTask() const { return clone_task_; }
-
-    bool repoDownloadable() const;
 
 private:
+    friend class RepoTreeModel;
+
     ServerRepo repo_;
-    LocalRepo local_repo_;
 
-    mutable Metrics metrics_;
-    CloneTask clone_task_;
+    // Slot of the item in RepoTreeModel
+    int slot_;
 };
 
 /**
  * Represent a repo category
  * E.g (My Repos, Shared repos, Group 1 repos, Group 2 repos ...)
+ *
+ * A category only holds the slots of its repos in RepoTreeModel.
  */
-class RepoCategoryItem: public QStandardItem {
+class RepoCategoryItem {
 public:
     /**
      * Create a non-group category
@@ -73,7 +53,11 @@ public:
      */
     RepoCategoryItem(const QString& name, int group_id);
 
-    virtual int type() const { return REPO_CATEGORY_TYPE; }
+    /**
+     * Create the category holding all repos of an account, used when
+     * libraries of all accounts are shown together
+     */
+    explicit RepoCategoryItem(const Account& account);
 
     // Accessors
     const QString& name() const { return name_; }
@@ -82,9 +66,38 @@ public:
 
     int groupId() const { return group_id_; }
 
+    bool isAccount() const { return account_.isValid(); }
+
+    const Account& account() const { return account_; }
+
+    // Number of rows of the category
+    int rowCount() const { return rows_.size(); }
+
+    // Number of repos, including those without a row yet
+    int repoCount() const { return rows_.size() + unfetched_.size(); }
+
 private:
+    friend class RepoTreeModel;
+
     QString name_;
     int group_id_;
+    Account account_;
+
+    // Row of the category in the model
+    int row_;
+    // Slots of the repos, in the order they are shown
+    std::vector<int> rows_;
+
+    // A group only gets rows for its repos once expanded, see
+    // RepoTreeModel::fetchMore(). Until then it keeps the repos here.
+    bool fetched_;
+    std::vector<ServerRepo> unfetched_;
+    // Search index of unfetched_, built when the filter first needs it, so
+    // that only the groups with matches get their rows
+    RepoSearchIndex unfetched_index_;
+    bool unfetched_indexed_;
+    // When it was last seen collapsed, 0 if expanded
+    qint64 collapsed_since_;
 };
 
 #endif // SEAFILE_CLIENT_REPO_ITEM_H
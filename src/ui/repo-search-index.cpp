@@ -0,0 +1,143 @@
+#include <QRegExp>
+#include <algorithm>            // std::sort, std::unique, std::find
+
+#include "repo-search-index.h"
+
+namespace {
+
+const int kTrigramLength = 3;
+
+} // namespace
+
+RepoSearchIndex::RepoSearchIndex()
+{
+}
+
+std::vector<RepoSearchIndex::Trigram> RepoSearchIndex::trigramsOf(const QString& text)
+{
+    std::vector<Trigram> trigrams;
+    if (text.length() < kTrigramLength) {
+        return trigrams;
+    }
+
+    trigrams.reserve(text.length() - kTrigramLength + 1);
+    for (int i = 0, n = text.length() - kTrigramLength; i <= n; i++) {
+        trigrams.push_back(((Trigram)text[i].unicode() << 32)
+                           | ((Trigram)text[i + 1].unicode() << 16)
+                           | (Trigram)text[i + 2].unicode());
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    return trigrams;
+}
+
+bool RepoSearchIndex::containsAll(const QString& text, const QStringList& words)
+{
+    for (int i = 0, n = words.size(); i < n; i++) {
+        if (!text.contains(words[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void RepoSearchIndex::insert(int doc, const QString& text)
+{
+    QString lower = text.toLower();
+    if (doc < (int)texts_.size() && !texts_[doc].isNull() && texts_[doc] == lower) {
+        return;
+    }
+
+    remove(doc);
+
+    if (doc >= (int)texts_.size()) {
+        texts_.resize(doc + 1);
+    }
+    // A null string marks a doc which is not indexed
+    texts_[doc] = lower.isNull() ? QString("") : lower;
+
+    std::vector<Trigram> trigrams = trigramsOf(lower);
+    for (int i = 0, n = trigrams.size(); i < n; i++) {
+        postings_[trigrams[i]].push_back(doc);
+    }
+}
+
+void RepoSearchIndex::remove(int doc)
+{
+    if (doc >= (int)texts_.size() || texts_[doc].isNull()) {
+        return;
+    }
+
+    std::vector<Trigram> trigrams = trigramsOf(texts_[doc]);
+    for (int i = 0, n = trigrams.size(); i < n; i++) {
+        QHash<Trigram, std::vector<int> >::iterator it = postings_.find(trigrams[i]);
+        if (it == postings_.end()) {
+            continue;
+        }
+
+        std::vector<int>& docs = it.value();
+        std::vector<int>::iterator pos = std::find(docs.begin(), docs.end(), doc);
+        if (pos != docs.end()) {
+            *pos = docs.back();
+            docs.pop_back();
+        }
+        if (docs.empty()) {
+            postings_.erase(it);
+        }
+    }
+
+    texts_[doc] = QString();
+}
+
+void RepoSearchIndex::clear()
+{
+    texts_.clear();
+    postings_.clear();
+}
+
+std::vector<int> RepoSearchIndex::search(const QString& query) const
+{
+    std::vector<int> docs;
+
+    QStringList words = query.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    if (words.isEmpty()) {
+        return docs;
+    }
+
+    // Only check the docs listed for the rarest trigram of the query
+    const std::vector<int> *candidates = NULL;
+    for (int i = 0, n = words.size(); i < n; i++) {
+        std::vector<Trigram> trigrams = trigramsOf(words[i]);
+        for (int j = 0, m = trigrams.size(); j < m; j++) {
+            QHash<Trigram, std::vector<int> >::const_iterator it = postings_.constFind(trigrams[j]);
+            if (it == postings_.constEnd()) {
+                // No doc contains it
+                return docs;
+            }
+            if (!candidates || it.value().size() < candidates->size()) {
+                candidates = &it.value();
+            }
+        }
+    }
+
+    if (candidates) {
+        for (int i = 0, n = candidates->size(); i < n; i++) {
+            int doc = (*candidates)[i];
+            if (containsAll(texts_[doc], words)) {
+                docs.push_back(doc);
+            }
+        }
+        return docs;
+    }
+
+    for (int doc = 0, n = texts_.size(); doc < n; doc++) {
+        if (!texts_[doc].isNull() && containsAll(texts_[doc], words)) {
+            docs.push_back(doc);
+        }
+    }
+
+    return docs;
+}
@@ -0,0 +1,47 @@
+#ifndef SEAFILE_CLIENT_REPO_SEARCH_INDEX_H
+#define SEAFILE_CLIENT_REPO_SEARCH_INDEX_H
+
+#include <vector>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+/**
+ * A trigram index over a short text of each repo, e.g. its name, owner and
+ * group, for filtering the repo tree as the user types.
+ *
+ * Docs are small integers, the slots of RepoTreeModel. Each trigram lists
+ * the docs containing it, so a query only checks the docs listed for its
+ * rarest trigram. Queries of less than three characters scan all docs.
+ */
+class RepoSearchIndex {
+public:
+    RepoSearchIndex();
+
+    // Index the text of a doc, replacing its old text if any
+    void insert(int doc, const QString& text);
+    void remove(int doc);
+    void clear();
+
+    /**
+     * The docs whose text contains every word of the query, ignoring case,
+     * in no particular order
+     */
+    std::vector<int> search(const QString& query) const;
+
+private:
+    Q_DISABLE_COPY(RepoSearchIndex)
+
+    typedef quint64 Trigram;
+
+    static std::vector<Trigram> trigramsOf(const QString& text);
+    static bool containsAll(const QString& text, const QStringList& words);
+
+    // Lowercased text of each doc, null if the doc is not indexed
+    std::vector<QString> texts_;
+
+    // Docs containing each trigram
+    QHash<Trigram, std::vector<int> > postings_;
+};
+
+#endif // SEAFILE_CLIENT_REPO_SEARCH_INDEX_H
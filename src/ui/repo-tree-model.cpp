@@ -1,13 +1,18 @@
 #include <QTimer>
+#include <QAbstractProxyModel>
 #include <QHash>
+#include <QSet>
 #include <QDebug>
-#include <algorithm>            // std::sort
+#include <QDateTime>
+#include <algorithm>            // std::make_heap, std::sort_heap, std::sort, std::upper_bound
 
+#include "account.h"
 #include "api/server-repo.h"
 #include "utils/utils.h"
 #include "seafile-applet.h"
 #include "main-window.h"
 #include "rpc/rpc-client.h"
+#include "rpc/local-repo.h"
 #include "repo-item.h"
 #include "repo-tree-view.h"
 #include "repo-tree-model.h"
@@ -16,24 +21,129 @@
 namespace {
 
 const int kRefreshLocalReposInterval = 1000;
+// About one frame
+const int kPendingChangesDelay = 16;
+// Rows of a group collapsed for this long are released
+const qint64 kReleaseCollapsedGroupMsecs = 5 * 60 * 1000;
+const int kReleaseGroupsInterval = 30 * 1000;
 const int kMaxRecentUpdatedRepos = 10;
+// A list requested before a repo was created does not include it
+const qint64 kKeepAddedRepoMsecs = 5 * 60 * 1000;
+// New rows beyond this are appended and merged in one layout change,
+// instead of being inserted at their place one at a time
+const int kMaxSortedInserts = 16;
 
-bool compareRepoByTimestamp(const ServerRepo& a, const ServerRepo& b)
+const LocalRepo kNoLocalRepo = LocalRepo();
+const CloneTask kNoCloneTask = CloneTask();
+
+// With this order the heap keeps the oldest repo on top
+bool isNewerRepo(const ServerRepo *a, const ServerRepo *b)
+{
+    return a->mtime > b->mtime;
+}
+
+// Until the server list arrives, a local repo stands in for its server repo
+ServerRepo serverRepoFromLocal(const LocalRepo& local)
+{
+    ServerRepo repo;
+    repo.id = local.id;
+    repo.name = local.name;
+    repo.description = local.description;
+    repo.mtime = local.last_sync_time;
+    repo.size = 0;
+    repo.encrypted = local.encrypted;
+    repo.group_id = 0;
+    return repo;
+}
+
+// A repo may be listed in several categories, e.g. shared to two groups
+QString repoKey(const ServerRepo& repo)
+{
+    if (repo.isGroupRepo()) {
+        return QString("%1/%2/%3").arg(repo.type).arg(repo.group_id).arg(repo.id);
+    }
+    return repo.type + "/" + repo.id;
+}
+
+// What the filter of the view matches against
+QString searchTextOf(const ServerRepo& repo)
+{
+    return repo.name + '\n' + repo.description + '\n' + repo.owner + '\n' + repo.group_name;
+}
+
+int syncStateRank(int sync_state, const CloneTask& task)
+{
+    if (sync_state < 0) {
+        // Being downloaded, or not synced
+        return task.isCancelable() ? 1 : 5;
+    }
+
+    switch (sync_state) {
+    case LocalRepo::SYNC_STATE_ERROR:
+        return 0;
+    case LocalRepo::SYNC_STATE_ING:
+        return 1;
+    case LocalRepo::SYNC_STATE_WAITING:
+        return 2;
+    case LocalRepo::SYNC_STATE_DONE:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+// Percent done of the current step of a download, -1 if it is not shown
+int progressOf(const CloneTask& task)
 {
-    return a.mtime > b.mtime;
+    if (!task.isValid() || !task.isDisplayable()) {
+        return -1;
+    }
+    if (task.state == "fetch" && task.block_total > 0) {
+        return (qint64)task.block_done * 100 / task.block_total;
+    }
+    if (task.state == "checkout" && task.checkout_total > 0) {
+        return (qint64)task.checkout_done * 100 / task.checkout_total;
+    }
+    return 0;
 }
 
-bool isSameRepo(const ServerRepo& a, const ServerRepo& b)
+// Any commit changes the mtime and the root of a repo
+bool isRepoChanged(const ServerRepo& a, const ServerRepo& b)
 {
-    return a.id == b.id;
+    return a.id != b.id
+        || a.mtime != b.mtime
+        || a.root != b.root
+        || a.name != b.name
+        || a.description != b.description
+        || a.size != b.size
+        || a.encrypted != b.encrypted
+        || a.permission != b.permission
+        || a.owner != b.owner
+        || a.group_name != b.group_name;
 }
 
 } // namespace
 
+class RepoTreeModel::SlotOrder {
+public:
+    explicit SlotOrder(const RepoTreeModel *model) : model_(model) {}
+
+    bool operator()(int a, int b) const { return model_->slotLess(a, b); }
 
-RepoTreeModel::RepoTreeModel(QObject *parent)
-    : QStandardItemModel(parent),
-      tree_view_(NULL)
+private:
+    const RepoTreeModel *model_;
+};
+
+
+RepoTreeModel::RepoTreeModel(bool unified, QObject *parent)
+    : QAbstractItemModel(parent),
+      local_repos_listed_(false),
+      tree_view_(NULL),
+      sort_order_(SORT_BY_SERVER_ORDER),
+      next_sort_seq_(0),
+      unified_(unified),
+      loaded_(false),
+      expanded_state_saved_(false)
 {
     initialize();
 
@@ -42,194 +152,1328 @@ RepoTreeModel::RepoTreeModel(QObject *parent)
             this, SLOT(refreshLocalRepos()));
 
     refresh_local_timer_->start(kRefreshLocalReposInterval);
+
+    pending_changes_timer_ = new QTimer(this);
+    pending_changes_timer_->setSingleShot(true);
+    connect(pending_changes_timer_, SIGNAL(timeout()),
+            this, SLOT(emitPendingChanges()));
+
+    release_groups_timer_ = new QTimer(this);
+    connect(release_groups_timer_, SIGNAL(timeout()),
+            this, SLOT(releaseCollapsedGroups()));
+    release_groups_timer_->start(kReleaseGroupsInterval);
+}
+
+RepoTreeModel::~RepoTreeModel()
+{
+    qDeleteAll(categories_);
 }
 
 void RepoTreeModel::initialize()
 {
+    local_repos_category_ = NULL;
+
+    if (unified_) {
+        // Account categories are created when their repos arrive
+        recent_updated_category_ = NULL;
+        my_repos_catetory_ = NULL;
+        shared_repos_catetory_ = NULL;
+        return;
+    }
+
     recent_updated_category_ = new RepoCategoryItem(tr("Recent Updated"));
     my_repos_catetory_ = new RepoCategoryItem(tr("My Libraries"));
     shared_repos_catetory_ = new RepoCategoryItem(tr("Private Shares"));
 
-    appendRow(recent_updated_category_);
-    appendRow(my_repos_catetory_);
-    appendRow(shared_repos_catetory_);
+    insertCategory(-1, recent_updated_category_);
+    insertCategory(-1, my_repos_catetory_);
+    insertCategory(-1, shared_repos_catetory_);
 
-    if (tree_view_) {
-        tree_view_->expand(indexFromItem(recent_updated_category_));
-    }
+    expand(recent_updated_category_);
 }
 
 void RepoTreeModel::clear()
 {
-    QStandardItemModel::clear();
+    beginResetModel();
+    qDeleteAll(categories_);
+    categories_.clear();
+    items_.clear();
+    slot_categories_.clear();
+    slot_rows_.clear();
+    slot_sort_keys_.clear();
+    slot_sync_states_.clear();
+    slot_progress_.clear();
+    free_slots_.clear();
+    slot_local_repos_.clear();
+    slot_clone_tasks_.clear();
+    slots_.clear();
+    slots_by_repo_id_.clear();
+    group_categories_.clear();
+    account_categories_.clear();
+    search_index_.clear();
+    changed_slots_.clear();
+    endResetModel();
+
+    loaded_ = false;
+    added_repos_.clear();
+    forgetLocalRepos();
     initialize();
 }
 
-void RepoTreeModel::setRepos(const std::vector<ServerRepo>& repos)
+QModelIndex RepoTreeModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (row < 0 || column != 0) {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid()) {
+        if (row >= (int)categories_.size()) {
+            return QModelIndex();
+        }
+        return createIndex(row, column, (void *)NULL);
+    }
+
+    // A repo index points to its category
+    RepoCategoryItem *category = categoryItem(parent);
+    if (!category || row >= category->rowCount()) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, category);
+}
+
+QModelIndex RepoTreeModel::parent(const QModelIndex& index) const
+{
+    if (!index.isValid() || !index.internalPointer()) {
+        return QModelIndex();
+    }
+
+    return indexOf((const RepoCategoryItem *)index.internalPointer());
+}
+
+int RepoTreeModel::rowCount(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return categories_.size();
+    }
+
+    RepoCategoryItem *category = categoryItem(parent);
+    return category ? category->rowCount() : 0;
+}
+
+int RepoTreeModel::columnCount(const QModelIndex& /* parent */) const
+{
+    return 1;
+}
+
+QVariant RepoTreeModel::data(const QModelIndex& index, int role) const
+{
+    // Everything else is painted by RepoItemDelegate
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    RepoItem *item = repoItem(index);
+    if (item) {
+        return item->repo().name;
+    }
+
+    RepoCategoryItem *category = categoryItem(index);
+    if (category) {
+        return category->name();
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags RepoTreeModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return 0;
+    }
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+bool RepoTreeModel::hasChildren(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return !categories_.empty();
+    }
+
+    RepoCategoryItem *category = categoryItem(parent);
+    return category && category->repoCount() > 0;
+}
+
+bool RepoTreeModel::canFetchMore(const QModelIndex& parent) const
+{
+    RepoCategoryItem *category = categoryItem(parent);
+    return category && !category->fetched_;
+}
+
+void RepoTreeModel::fetchMore(const QModelIndex& parent)
+{
+    RepoCategoryItem *category = categoryItem(parent);
+    if (!category || category->fetched_) {
+        return;
+    }
+
+    std::vector<ServerRepo> repos;
+    repos.swap(category->unfetched_);
+    category->unfetched_index_.clear();
+    category->unfetched_indexed_ = false;
+    category->fetched_ = true;
+    category->collapsed_since_ = 0;
+
+    std::vector<const ServerRepo*> new_repos;
+    new_repos.reserve(repos.size());
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        new_repos.push_back(&repos[i]);
+    }
+    appendRepoItems(category, new_repos);
+    forgetLocalRepos();
+}
+
+void RepoTreeModel::searchRepos(const QString& query, QSet<QString> *keys)
+{
+    QList<RepoCategoryItem*> groups = group_categories_.values();
+    for (int i = 0, n = groups.size(); i < n; i++) {
+        RepoCategoryItem *group = groups[i];
+        if (group->fetched_) {
+            continue;
+        }
+
+        if (!group->unfetched_indexed_) {
+            group->unfetched_index_.clear();
+            for (int j = 0, m = group->unfetched_.size(); j < m; j++) {
+                group->unfetched_index_.insert(j, searchTextOf(group->unfetched_[j]));
+            }
+            group->unfetched_indexed_ = true;
+        }
+
+        if (!group->unfetched_index_.search(query).empty()) {
+            fetchMore(indexOf(group));
+        }
+    }
+
+    std::vector<int> slots = search_index_.search(query);
+    for (int i = 0, n = slots.size(); i < n; i++) {
+        keys->insert(itemKey(slot_categories_[slots[i]], items_[slots[i]].repo()));
+    }
+}
+
+QString RepoTreeModel::itemKey(const RepoItem *item) const
+{
+    return itemKey(slot_categories_[item->slot_], item->repo());
+}
+
+/**
+ * Give back the rows of the groups which have not been shown for a while,
+ * keeping only their repos
+ */
+void RepoTreeModel::releaseCollapsedGroups()
+{
+    // The filter needs the rows of the groups with matches
+    if (isShown() && tree_view_->isFiltering()) {
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QList<RepoCategoryItem*> groups = group_categories_.values();
+    for (int i = 0, n = groups.size(); i < n; i++) {
+        RepoCategoryItem *group = groups[i];
+        if (!group->fetched_) {
+            continue;
+        }
+
+        if (isExpanded(group)) {
+            group->collapsed_since_ = 0;
+            continue;
+        }
+        if (group->collapsed_since_ == 0) {
+            group->collapsed_since_ = now;
+            continue;
+        }
+        if (now - group->collapsed_since_ < kReleaseCollapsedGroupMsecs) {
+            continue;
+        }
+
+        std::vector<ServerRepo> repos;
+        repos.reserve(group->rowCount());
+        for (int row = 0, total = group->rowCount(); row < total; row++) {
+            repos.push_back(items_[group->rows_[row]].repo());
+        }
+
+        removeRepoRows(group, 0, group->rowCount());
+        group->unfetched_.swap(repos);
+        group->unfetched_indexed_ = false;
+        group->fetched_ = false;
+    }
+}
+
+RepoItem* RepoTreeModel::repoItem(const QModelIndex& index) const
+{
+    if (!index.isValid() || !index.internalPointer()) {
+        return NULL;
+    }
+
+    const RepoCategoryItem *category = (const RepoCategoryItem *)index.internalPointer();
+    if (index.row() >= category->rowCount()) {
+        return NULL;
+    }
+
+    return const_cast<RepoItem *>(&items_[category->rows_[index.row()]]);
+}
+
+RepoCategoryItem* RepoTreeModel::categoryItem(const QModelIndex& index) const
+{
+    if (!index.isValid() || index.internalPointer()
+        || index.row() >= (int)categories_.size()) {
+        return NULL;
+    }
+
+    return categories_[index.row()];
+}
+
+QModelIndex RepoTreeModel::sourceIndex(const QModelIndex& index)
+{
+    QModelIndex source = index;
+    const QAbstractProxyModel *proxy;
+    while ((proxy = qobject_cast<const QAbstractProxyModel *>(source.model()))) {
+        source = proxy->mapToSource(source);
+    }
+
+    return source;
+}
+
+const RepoCategoryItem* RepoTreeModel::categoryOf(const RepoItem *item) const
+{
+    return slot_categories_[item->slot_];
+}
+
+QModelIndex RepoTreeModel::indexOf(const RepoCategoryItem *category) const
+{
+    return createIndex(category->row_, 0, (void *)NULL);
+}
+
+QModelIndex RepoTreeModel::indexOf(const RepoItem *item) const
+{
+    return createIndex(slot_rows_[item->slot_], 0, slot_categories_[item->slot_]);
+}
+
+bool RepoTreeModel::isShown() const
+{
+    return tree_view_ && tree_view_->treeModel() == this;
+}
+
+// The view may show the model through the filter, which hides some rows
+bool RepoTreeModel::isExpanded(const RepoCategoryItem *category) const
+{
+    if (!isShown()) {
+        return false;
+    }
+
+    QModelIndex index = tree_view_->viewIndex(indexOf(category));
+    return index.isValid() && tree_view_->isExpanded(index);
+}
+
+void RepoTreeModel::expand(const RepoCategoryItem *category)
+{
+    if (!isShown()) {
+        return;
+    }
+
+    QModelIndex index = tree_view_->viewIndex(indexOf(category));
+    if (index.isValid()) {
+        tree_view_->expand(index);
+    }
+}
+
+void RepoTreeModel::saveExpandedState()
+{
+    // All categories with a match are expanded while filtering
+    if (!isShown() || tree_view_->isFiltering()) {
+        return;
+    }
+
+    expanded_categories_.clear();
+    for (int row = 0, n = categories_.size(); row < n; row++) {
+        RepoCategoryItem *category = categories_[row];
+        if (isExpanded(category)) {
+            expanded_categories_ << category->name();
+        }
+    }
+    expanded_state_saved_ = true;
+}
+
+void RepoTreeModel::restoreExpandedState()
+{
+    if (!isShown()) {
+        return;
+    }
+
+    if (!expanded_state_saved_) {
+        if (recent_updated_category_) {
+            expand(recent_updated_category_);
+        }
+        return;
+    }
+
+    for (int row = 0, n = categories_.size(); row < n; row++) {
+        RepoCategoryItem *category = categories_[row];
+        if (expanded_categories_.contains(category->name())) {
+            expand(category);
+        }
+    }
+}
+
+int RepoTreeModel::setRepos(const std::vector<ServerRepo>& repos)
+{
+    bool first_load = !loaded_;
+    loaded_ = true;
+
+    int changes = applyReposDelta(repos);
+    updateRecentUpdatedRepos(repos);
+    mergeLocalRepos(repos);
+    forgetLocalRepos();
+
+    if (first_load) {
+        restoreExpandedState();
+    }
+
+    return changes;
+}
+
+/**
+ * Diff the new list against the items in the tree, by repo id and category,
+ * and only touch what was added, removed or changed. The view keeps its
+ * expanded categories, selection and scroll position.
+ *
+ * The items are looked up in slots_ and the groups in group_categories_, so
+ * the diff is linear in the number of repos. New repos are appended to each
+ * category at once.
+ */
+int RepoTreeModel::applyReposDelta(const std::vector<ServerRepo>& repos)
 {
-    int i, n = repos.size();
-    // removeReposDeletedOnServer(repos);
+    int added = 0, removed = 0, changed = 0;
 
-    clear();
+    int existing = 0, matched = 0;
+    for (int row = 0, n = categories_.size(); row < n; row++) {
+        RepoCategoryItem *category = categories_[row];
+        if (category != recent_updated_category_ && category != local_repos_category_) {
+            existing += category->rowCount();
+        }
+    }
 
-    for (i = 0; i < n; i++) {
+    QHash<RepoCategoryItem*, std::vector<const ServerRepo*> > new_repos;
+    QHash<RepoCategoryItem*, std::vector<ServerRepo> > unfetched;
+    QSet<QString> seen;
+    seen.reserve(repos.size());
+    for (int i = 0, n = repos.size(); i < n; i++) {
         const ServerRepo& repo = repos[i];
-        if (repo.isPersonalRepo()) {
-            checkPersonalRepo(repo);
-        } else if (repo.isSharedRepo()) {
-            checkSharedRepo(repo);
+        const QString key = repoKey(repo);
+        if (seen.contains(key)) {
+            continue;
+        }
+        seen.insert(key);
+        added_repos_.remove(key);
+
+        RepoCategoryItem *category = categoryForRepo(repo);
+        if (!category->fetched_) {
+            unfetched[category].push_back(repo);
+            continue;
+        }
+
+        int slot = slots_.value(key, -1);
+        if (slot < 0) {
+            new_repos[category].push_back(&repo);
+            added++;
+            continue;
+        }
+
+        matched++;
+        if (isRepoChanged(items_[slot].repo(), repo)) {
+            updateRepoItem(&items_[slot], repo);
+            changed++;
+        }
+    }
+
+    QHash<RepoCategoryItem*, std::vector<const ServerRepo*> >::const_iterator it;
+    for (it = new_repos.begin(); it != new_repos.end(); ++it) {
+        appendRepoItems(it.key(), it.value());
+    }
+
+    // Every item already in the tree is still listed
+    if (matched < existing) {
+        for (int row = 0; row < (int)categories_.size(); row++) {
+            RepoCategoryItem *category = categories_[row];
+            if (category != recent_updated_category_ && category != local_repos_category_) {
+                removed += removeUnlistedRepos(category, seen);
+            }
+        }
+    }
+
+    // Groups the user has left
+    QList<RepoCategoryItem*> groups = group_categories_.values();
+    for (int i = 0, n = groups.size(); i < n; i++) {
+        RepoCategoryItem *group = groups[i];
+        if (!group->fetched_) {
+            changed += setUnfetchedRepos(group, &unfetched[group]);
+        }
+        if (group->repoCount() == 0) {
+            removeCategory(group);
+        }
+    }
+
+    if (added + removed + changed > 0) {
+        qDebug("repos list: %d added, %d removed, %d changed\n", added, removed, changed);
+    }
+
+    return added + removed + changed;
+}
+
+/**
+ * Replace the repos of a group which has no rows yet. Return how many of
+ * them differ.
+ */
+int RepoTreeModel::setUnfetchedRepos(RepoCategoryItem *group, std::vector<ServerRepo> *repos)
+{
+    const std::vector<ServerRepo>& old_repos = group->unfetched_;
+    int n = qMin(old_repos.size(), repos->size());
+    int changes = qAbs((int)old_repos.size() - (int)repos->size());
+    for (int i = 0; i < n; i++) {
+        if (isRepoChanged(old_repos[i], (*repos)[i])) {
+            changes++;
+        }
+    }
+
+    bool count_changed = old_repos.size() != repos->size();
+    group->unfetched_.swap(*repos);
+    for (int i = 0, m = group->unfetched_.size(); i < m; i++) {
+        internStrings(&group->unfetched_[i]);
+    }
+    if (changes > 0) {
+        group->unfetched_indexed_ = false;
+    }
+
+    // The number of repos is shown beside the name of the group
+    if (count_changed) {
+        QModelIndex index = indexOf(group);
+        emit dataChanged(index, index);
+    }
+
+    return changes;
+}
+
+/**
+ * Remove the items whose keys are not in the list, a run of adjacent rows
+ * at a time. Return the number of items removed.
+ */
+int RepoTreeModel::removeUnlistedRepos(RepoCategoryItem *category, const QSet<QString>& keys)
+{
+    int removed = 0;
+    int end = -1;
+    for (int row = category->rowCount() - 1; row >= -1; row--) {
+        bool unlisted = false;
+        if (row >= 0) {
+            const ServerRepo& repo = items_[category->rows_[row]].repo();
+            unlisted = !keys.contains(itemKey(category, repo))
+                && !isRecentlyAdded(repoKey(repo));
+        }
+
+        if (unlisted) {
+            if (end < 0) {
+                end = row;
+            }
+        } else if (end >= 0) {
+            qDebug("remove %d repos from \"%s\"\n", end - row, toCStr(category->name()));
+            removeRepoRows(category, row + 1, end - row);
+            removed += end - row;
+            end = -1;
+        }
+    }
+
+    return removed;
+}
+
+void RepoTreeModel::addRepo(const ServerRepo& repo)
+{
+    if (unified_) {
+        return;
+    }
+
+    RepoCategoryItem *category = categoryForRepo(repo);
+    if (slots_.contains(repoKey(repo))) {
+        return;
+    }
+    if (!category->fetched_) {
+        category->unfetched_.push_back(repo);
+        category->unfetched_indexed_ = false;
+        return;
+    }
+
+    added_repos_.insert(repoKey(repo), QDateTime::currentMSecsSinceEpoch());
+    LocalRepo local_repo = localRepoOf(repo.id);
+    insertRepoItem(category, -1, repo, local_repo);
+
+    // It is the most recently updated one
+    insertRepoItem(recent_updated_category_, 0, repo, local_repo);
+    if (recent_updated_category_->rowCount() > kMaxRecentUpdatedRepos) {
+        removeRepoRows(recent_updated_category_, kMaxRecentUpdatedRepos, 1);
+    }
+    forgetLocalRepos();
+}
+
+void RepoTreeModel::addAccountRepo(const Account& account, const ServerRepo& repo)
+{
+    RepoCategoryItem *category = findAccountCategory(account);
+    if (!category || slots_.contains(itemKey(category, repo))) {
+        return;
+    }
+
+    added_repos_.insert(repoKey(repo), QDateTime::currentMSecsSinceEpoch());
+    insertRepoItem(category, -1, repo, localRepoOf(repo.id));
+    forgetLocalRepos();
+}
+
+bool RepoTreeModel::isRecentlyAdded(const QString& key)
+{
+    if (!added_repos_.contains(key)) {
+        return false;
+    }
+
+    if (QDateTime::currentMSecsSinceEpoch() - added_repos_.value(key) > kKeepAddedRepoMsecs) {
+        added_repos_.remove(key);
+        return false;
+    }
+
+    return true;
+}
+
+// A repo shows in "Recent Updated" too
+std::vector<RepoItem*> RepoTreeModel::findRepoItems(const QString& repo_id)
+{
+    std::vector<RepoItem*> items;
+    QList<int> slots = slots_by_repo_id_.values(repo_id);
+    for (int i = 0, n = slots.size(); i < n; i++) {
+        items.push_back(&items_[slots[i]]);
+    }
+
+    return items;
+}
+
+QString RepoTreeModel::itemKey(const RepoCategoryItem *category, const ServerRepo& repo) const
+{
+    if (category == recent_updated_category_) {
+        return "recent\t" + repoKey(repo);
+    }
+    if (category == local_repos_category_) {
+        return "local\t" + repo.id;
+    }
+    // Repos of an account category are listed once, whatever their groups
+    if (category->isAccount()) {
+        return category->account().key() + "\t" + repo.id;
+    }
+    return repoKey(repo);
+}
+
+int RepoTreeModel::allocSlot(RepoCategoryItem *category,
+                             int row,
+                             const ServerRepo& repo,
+                             const LocalRepo& local_repo)
+{
+    int slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        items_[slot] = RepoItem(repo);
+        slot_categories_[slot] = category;
+        slot_rows_[slot] = row;
+    } else {
+        slot = items_.size();
+        items_.push_back(RepoItem(repo));
+        slot_categories_.push_back(category);
+        slot_rows_.push_back(row);
+        slot_sort_keys_.push_back(SortKey());
+        slot_sync_states_.push_back(-1);
+        slot_progress_.push_back(-1);
+    }
+    items_[slot].slot_ = slot;
+    internStrings(&items_[slot].repo_);
+    setSlotLocalRepo(slot, local_repo);
+    slot_sort_keys_[slot].seq = next_sort_seq_++;
+    updateSortKey(slot);
+
+    slots_.insert(itemKey(category, repo), slot);
+    slots_by_repo_id_.insert(repo.id, slot);
+    search_index_.insert(slot, searchTextOf(repo));
+
+    return slot;
+}
+
+void RepoTreeModel::freeSlot(int slot)
+{
+    RepoItem& item = items_[slot];
+    const ServerRepo& repo = item.repo();
+
+    QString key = itemKey(slot_categories_[slot], repo);
+    if (slots_.value(key, -1) == slot) {
+        slots_.remove(key);
+    }
+    slots_by_repo_id_.remove(repo.id, slot);
+    search_index_.remove(slot);
+
+    // Release the strings held by the item
+    item = RepoItem();
+    slot_categories_[slot] = NULL;
+    slot_sort_keys_[slot].name = QString();
+    setSlotLocalRepo(slot, LocalRepo());
+    setSlotCloneTask(slot, CloneTask());
+    free_slots_.push_back(slot);
+}
+
+void RepoTreeModel::setSlotLocalRepo(int slot, const LocalRepo& local_repo)
+{
+    if (local_repo.isValid()) {
+        slot_local_repos_.insert(slot, local_repo);
+        slot_sync_states_[slot] = local_repo.sync_state;
+    } else {
+        slot_local_repos_.remove(slot);
+        slot_sync_states_[slot] = -1;
+    }
+}
+
+void RepoTreeModel::setSlotCloneTask(int slot, const CloneTask& task)
+{
+    if (task.isValid()) {
+        slot_clone_tasks_.insert(slot, task);
+    } else {
+        slot_clone_tasks_.remove(slot);
+    }
+    slot_progress_[slot] = progressOf(task);
+}
+
+void RepoTreeModel::internStrings(ServerRepo *repo)
+{
+    QString *strings[] = { &repo->type, &repo->owner, &repo->permission, &repo->group_name };
+    for (int i = 0, n = sizeof(strings) / sizeof(strings[0]); i < n; i++) {
+        QString& s = *strings[i];
+        if (s.isEmpty()) {
+            continue;
+        }
+        QSet<QString>::const_iterator it = string_pool_.constFind(s);
+        if (it != string_pool_.constEnd()) {
+            s = *it;
         } else {
-            checkGroupRepo(repo);
+            string_pool_.insert(s);
         }
     }
+}
+
+const LocalRepo& RepoTreeModel::localRepo(const RepoItem *item) const
+{
+    if (slot_sync_states_[item->slot_] < 0) {
+        return kNoLocalRepo;
+    }
+    QHash<int, LocalRepo>::const_iterator it = slot_local_repos_.constFind(item->slot_);
+    return it != slot_local_repos_.constEnd() ? it.value() : kNoLocalRepo;
+}
 
-    std::vector<ServerRepo> repos_copy(repos);
-    // sort all repso by timestamp
-    std::sort(repos_copy.begin(), repos_copy.end(), compareRepoByTimestamp);
-    // erase duplidates
-    repos_copy.erase(std::unique(repos_copy.begin(), repos_copy.end(), isSameRepo), repos_copy.end());
+const CloneTask& RepoTreeModel::cloneTask(const RepoItem *item) const
+{
+    QHash<int, CloneTask>::const_iterator it = slot_clone_tasks_.constFind(item->slot_);
+    return it != slot_clone_tasks_.constEnd() ? it.value() : kNoCloneTask;
+}
 
-    n = qMin((int)repos_copy.size(), kMaxRecentUpdatedRepos);
-    for (i = 0; i < n; i++) {
-        RepoItem *item = new RepoItem(repos_copy[i]);
-        recent_updated_category_->appendRow(item);
+bool RepoTreeModel::repoDownloadable(const RepoItem *item) const
+{
+    if (slot_sync_states_[item->slot_] >= 0) {
+        return false;
+    }
+
+    const CloneTask& task = cloneTask(item);
+    if (!task.isValid()) {
+        return true;
     }
+
+    return task.state == "canceled" || task.state == "error" || task.state == "done";
 }
 
-struct DeleteRepoData {
-    QHash<QString, const ServerRepo*> map;
-    QList<RepoItem*> itemsToDelete;
-};
+void RepoTreeModel::renumberRows(RepoCategoryItem *category, int from)
+{
+    for (int row = from, n = category->rowCount(); row < n; row++) {
+        slot_rows_[category->rows_[row]] = row;
+    }
+}
 
-void RepoTreeModel::collectDeletedRepos(RepoItem *item, void *vdata)
+RepoItem* RepoTreeModel::insertRepoItem(RepoCategoryItem *category,
+                                        int row,
+                                        const ServerRepo& repo,
+                                        const LocalRepo& local_repo)
 {
-    DeleteRepoData *data = (DeleteRepoData *)vdata;
-    const ServerRepo* repo = data->map.value(item->repo().id);
-    if (!repo || repo->type != item->repo().type) {
-        data->itemsToDelete << item;
+    int slot = allocSlot(category, -1, repo, local_repo);
+    if (isSorted(category)) {
+        row = sortedRow(category, slot);
+    } else if (row < 0 || row > category->rowCount()) {
+        row = category->rowCount();
     }
+
+    beginInsertRows(indexOf(category), row, row);
+    category->rows_.insert(category->rows_.begin() + row, slot);
+    renumberRows(category, row);
+    endInsertRows();
+
+    return &items_[slot];
 }
 
-void RepoTreeModel::removeReposDeletedOnServer(const std::vector<ServerRepo>& repos)
+void RepoTreeModel::appendRepoItems(RepoCategoryItem *category,
+                                    const std::vector<const ServerRepo*>& repos)
 {
-    int i, n;
-    DeleteRepoData data;
-    n = repos.size();
-    for (i = 0; i < n; i++) {
-        const ServerRepo& repo = repos[i];
-        data.map.insert(repo.id, &repo);
+    if (repos.empty()) {
+        return;
+    }
+
+    std::vector<int> slots;
+    slots.reserve(repos.size());
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        const ServerRepo& repo = *repos[i];
+        slots.push_back(allocSlot(category, -1, repo, localRepoOf(repo.id)));
+    }
+
+    std::vector<int>& rows = category->rows_;
+    bool sorted = isSorted(category);
+    if (sorted) {
+        std::sort(slots.begin(), slots.end(), SlotOrder(this));
+    }
+
+    // A few rows are inserted at their place
+    if (sorted && !rows.empty() && slotLess(slots.front(), rows.back())
+        && (int)slots.size() <= kMaxSortedInserts) {
+        for (int i = 0, n = slots.size(); i < n; i++) {
+            int row = sortedRow(category, slots[i]);
+            beginInsertRows(indexOf(category), row, row);
+            rows.insert(rows.begin() + row, slots[i]);
+            renumberRows(category, row);
+            endInsertRows();
+        }
+        return;
+    }
+
+    int first = rows.size();
+    beginInsertRows(indexOf(category), first, first + slots.size() - 1);
+    rows.insert(rows.end(), slots.begin(), slots.end());
+    renumberRows(category, first);
+    endInsertRows();
+
+    // Many are appended, then merged with the rows before them
+    if (sorted && first > 0 && slotLess(rows[first], rows[first - 1])) {
+        sortRows(std::vector<RepoCategoryItem*>(1, category), first);
+    }
+}
+
+void RepoTreeModel::removeRepoRows(RepoCategoryItem *category, int row, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    beginRemoveRows(indexOf(category), row, row + count - 1);
+    for (int i = row; i < row + count; i++) {
+        freeSlot(category->rows_[i]);
+    }
+    category->rows_.erase(category->rows_.begin() + row,
+                          category->rows_.begin() + row + count);
+    renumberRows(category, row);
+    endRemoveRows();
+}
+
+void RepoTreeModel::insertCategory(int row, RepoCategoryItem *category)
+{
+    if (row < 0 || row > (int)categories_.size()) {
+        row = categories_.size();
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    categories_.insert(categories_.begin() + row, category);
+    for (int i = row, n = categories_.size(); i < n; i++) {
+        categories_[i]->row_ = i;
     }
 
-    forEachRepoItem(&RepoTreeModel::collectDeletedRepos, (void *)&data);
+    if (category->isGroup()) {
+        group_categories_.insert(category->groupId(), category);
+    } else if (category->isAccount()) {
+        account_categories_.insert(category->account().key(), category);
+    }
+    endInsertRows();
+}
 
-    QListIterator<RepoItem*> iter(data.itemsToDelete);
-    while(iter.hasNext()) {
-        RepoItem *item = iter.next();
+void RepoTreeModel::removeCategory(RepoCategoryItem *category)
+{
+    int row = category->row_;
 
-        const ServerRepo& repo = item->repo();
+    beginRemoveRows(QModelIndex(), row, row);
+    for (int i = 0, n = category->rowCount(); i < n; i++) {
+        freeSlot(category->rows_[i]);
+    }
 
-        qDebug("remove repo %s(%s) from \"%s\"\n",
-               toCStr(repo.name), toCStr(repo.id),
-               toCStr(((RepoCategoryItem*)item->parent())->name()));
+    if (category->isGroup()) {
+        group_categories_.remove(category->groupId());
+    } else if (category->isAccount()) {
+        account_categories_.remove(category->account().key());
+    }
 
-        item->parent()->removeRow(item->row());
+    categories_.erase(categories_.begin() + row);
+    for (int i = row, n = categories_.size(); i < n; i++) {
+        categories_[i]->row_ = i;
     }
+    endRemoveRows();
+
+    delete category;
+}
+
+// "Recent Updated" keeps its own order
+bool RepoTreeModel::isSorted(const RepoCategoryItem *category) const
+{
+    return category != recent_updated_category_;
 }
 
+bool RepoTreeModel::slotLess(int a, int b) const
+{
+    const SortKey& x = slot_sort_keys_[a];
+    const SortKey& y = slot_sort_keys_[b];
+
+    switch (sort_order_) {
+    case SORT_BY_SERVER_ORDER:
+        return x.seq < y.seq;
+    case SORT_BY_NAME:
+        break;
+    case SORT_BY_SIZE:
+        if (x.size != y.size) {
+            return x.size > y.size;
+        }
+        break;
+    case SORT_BY_MTIME:
+        if (x.mtime != y.mtime) {
+            return x.mtime > y.mtime;
+        }
+        break;
+    case SORT_BY_SYNC_STATE:
+        if (x.sync_state != y.sync_state) {
+            return x.sync_state < y.sync_state;
+        }
+        break;
+    }
+
+    if (x.name != y.name) {
+        return x.name < y.name;
+    }
+    return x.seq < y.seq;
+}
+
+void RepoTreeModel::updateSortKey(int slot)
+{
+    const RepoItem& item = items_[slot];
+    SortKey& key = slot_sort_keys_[slot];
+
+    key.name = item.repo().name.toLower();
+    key.size = item.repo().size;
+    key.mtime = item.repo().mtime;
+    key.sync_state = syncStateRank(slot_sync_states_[slot], cloneTask(&item));
+}
+
+// The row a slot not in the category yet would take
+int RepoTreeModel::sortedRow(const RepoCategoryItem *category, int slot) const
+{
+    const std::vector<int>& rows = category->rows_;
+    return std::upper_bound(rows.begin(), rows.end(), slot, SlotOrder(this)) - rows.begin();
+}
+
+/**
+ * Move the row of an item whose sort key has changed, if it is out of order
+ * with the rows around it
+ */
+void RepoTreeModel::moveToSortedRow(int slot)
+{
+    RepoCategoryItem *category = slot_categories_[slot];
+    if (!category || !isSorted(category)) {
+        return;
+    }
+
+    std::vector<int>& rows = category->rows_;
+    int row = slot_rows_[slot];
+    int n = rows.size();
+
+    int to;
+    if (row > 0 && slotLess(slot, rows[row - 1])) {
+        to = std::upper_bound(rows.begin(), rows.begin() + row, slot, SlotOrder(this))
+            - rows.begin();
+    } else if (row < n - 1 && slotLess(rows[row + 1], slot)) {
+        to = std::upper_bound(rows.begin() + row + 1, rows.end(), slot, SlotOrder(this))
+            - rows.begin() - 1;
+    } else {
+        return;
+    }
+
+    // The destination of beginMoveRows() is a row before the move
+    QModelIndex parent = indexOf(category);
+    if (!beginMoveRows(parent, row, row, parent, to > row ? to + 1 : to)) {
+        return;
+    }
+    rows.erase(rows.begin() + row);
+    rows.insert(rows.begin() + to, slot);
+    for (int i = qMin(row, to), last = qMax(row, to); i <= last; i++) {
+        slot_rows_[rows[i]] = i;
+    }
+    endMoveRows();
+}
+
+/**
+ * Sort the rows of the categories as one layout change. The first
+ * sorted_rows rows of each are already in order and only merged with the
+ * others.
+ */
+void RepoTreeModel::sortRows(const std::vector<RepoCategoryItem*>& categories, int sorted_rows)
+{
+    emit layoutAboutToBeChanged();
+
+    // The view keeps the selection and the current row on the same repos
+    QModelIndexList from = persistentIndexList();
+    std::vector<int> from_slots(from.size(), -1);
+    for (int i = 0, n = from.size(); i < n; i++) {
+        RepoItem *item = repoItem(from[i]);
+        if (item) {
+            from_slots[i] = item->slot_;
+        }
+    }
+
+    for (int i = 0, n = categories.size(); i < n; i++) {
+        std::vector<int>& rows = categories[i]->rows_;
+        int middle = qMin(sorted_rows, (int)rows.size());
+        std::sort(rows.begin() + middle, rows.end(), SlotOrder(this));
+        if (middle > 0) {
+            std::inplace_merge(rows.begin(), rows.begin() + middle, rows.end(), SlotOrder(this));
+        }
+        renumberRows(categories[i], 0);
+    }
+
+    QModelIndexList to;
+    for (int i = 0, n = from.size(); i < n; i++) {
+        to << (from_slots[i] >= 0 ? indexOf(&items_[from_slots[i]]) : from[i]);
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged();
+}
 
-void RepoTreeModel::checkPersonalRepo(const ServerRepo& repo)
+void RepoTreeModel::setSortOrder(SortOrder order)
 {
-    int row, n = my_repos_catetory_->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(my_repos_catetory_->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
+    if (sort_order_ == order) {
+        return;
+    }
+    sort_order_ = order;
+
+    std::vector<RepoCategoryItem*> categories;
+    for (int i = 0, n = categories_.size(); i < n; i++) {
+        if (isSorted(categories_[i]) && categories_[i]->rowCount() > 1) {
+            categories.push_back(categories_[i]);
         }
     }
 
-    // The repo is new
-    RepoItem *item = new RepoItem(repo);
-    my_repos_catetory_->appendRow(item);
+    if (!categories.empty()) {
+        sortRows(categories, 0);
+    }
 }
 
-void RepoTreeModel::checkSharedRepo(const ServerRepo& repo)
+LocalRepo RepoTreeModel::localRepoOf(const QString& repo_id)
 {
-    int row, n = shared_repos_catetory_->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(shared_repos_catetory_->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
+    if (!local_repos_listed_) {
+        local_repos_listed_ = true;
+        std::vector<LocalRepo> repos;
+        seafApplet->rpcClient()->listLocalRepos(&repos);
+        for (int i = 0, n = repos.size(); i < n; i++) {
+            LocalRepo& repo = repos[i];
+            seafApplet->rpcClient()->getSyncStatus(repo);
+            local_repos_.insert(repo.id, repo);
         }
     }
 
-    // The repo is new
-    RepoItem *item = new RepoItem(repo);
-    shared_repos_catetory_->appendRow(item);
+    return local_repos_.value(repo_id);
+}
+
+// The local repos change, they are only valid for one list of server repos
+void RepoTreeModel::forgetLocalRepos()
+{
+    local_repos_.clear();
+    local_repos_listed_ = false;
+}
+
+void RepoTreeModel::updateLocalRepo(const QString& repo_id, const LocalRepo& local_repo)
+{
+    std::vector<RepoItem*> items = findRepoItems(repo_id);
+    for (int i = 0, n = items.size(); i < n; i++) {
+        setSlotLocalRepo(items[i]->slot_, local_repo);
+        markItemChanged(items[i]);
+    }
+}
+
+void RepoTreeModel::setLocalRepo(const RepoItem *item, const LocalRepo& local_repo)
+{
+    if (local_repo != localRepo(item)) {
+        setSlotLocalRepo(item->slot_, local_repo);
+        markItemChanged(item);
+    }
+}
+
+void RepoTreeModel::updateCloneTask(const QString& repo_id, const CloneTask& task)
+{
+    std::vector<RepoItem*> items = findRepoItems(repo_id);
+    for (int i = 0, n = items.size(); i < n; i++) {
+        setSlotCloneTask(items[i]->slot_, task);
+        markItemChanged(items[i]);
+    }
 }
 
-void RepoTreeModel::checkGroupRepo(const ServerRepo& repo)
+RepoCategoryItem* RepoTreeModel::categoryForRepo(const ServerRepo& repo)
 {
-    QStandardItem *root = invisibleRootItem();
-    RepoCategoryItem *group = NULL;
+    if (repo.isPersonalRepo()) {
+        return my_repos_catetory_;
+    }
+    if (repo.isSharedRepo()) {
+        return shared_repos_catetory_;
+    }
+
+    RepoCategoryItem *group = group_categories_.value(repo.group_id);
+    if (group) {
+        return group;
+    }
 
-    int row, n = root->rowCount();
+    if (repo.group_name == "Organization") {
+        group = new RepoCategoryItem(tr("Organization"), repo.group_id);
+        // Insert pub repos after "recent updated", "my libraries", "shared libraries"
+        insertCategory(shared_repos_catetory_->row_ + 1, group);
+    } else {
+        group = new RepoCategoryItem(repo.group_name, repo.group_id);
+        insertCategory(-1, group);
+    }
+    // Its rows are created when it is expanded
+    group->fetched_ = false;
 
-    // First find for create the group
-    // Starts from row 2 because the first two rows are "My Libraries" and "Shared Libraries"
-    for (row = 2; row < n; row ++) {
-        RepoCategoryItem *item = (RepoCategoryItem *)(root->child(row));
-        if (item->groupId() == repo.group_id) {
-            group = item;
-            break;
+    return group;
+}
+
+/**
+ * Pick the newest repos with a heap of kMaxRecentUpdatedRepos, instead of
+ * sorting the whole list
+ */
+void RepoTreeModel::updateRecentUpdatedRepos(const std::vector<ServerRepo>& repos)
+{
+    std::vector<const ServerRepo*> heap;
+    heap.reserve(kMaxRecentUpdatedRepos + 1);
+    // A repo shared to several groups is listed several times
+    QSet<QString> ids;
+
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        const ServerRepo *repo = &repos[i];
+        if (ids.contains(repo->id)) {
+            continue;
         }
+        if ((int)heap.size() == kMaxRecentUpdatedRepos) {
+            if (!isNewerRepo(repo, heap.front())) {
+                continue;
+            }
+            std::pop_heap(heap.begin(), heap.end(), isNewerRepo);
+            ids.remove(heap.back()->id);
+            heap.pop_back();
+        }
+        heap.push_back(repo);
+        std::push_heap(heap.begin(), heap.end(), isNewerRepo);
+        ids.insert(repo->id);
     }
-    if (!group) {
-        if (repo.group_name == "Organization") {
-            group = new RepoCategoryItem(tr("Organization"), repo.group_id);
-            // Insert pub repos after "recent updated", "my libraries", "shared libraries"
-            insertRow(3, group);
-        } else {
-            group = new RepoCategoryItem(repo.group_name, repo.group_id);
-            appendRow(group);
+
+    // Newest first
+    std::sort_heap(heap.begin(), heap.end(), isNewerRepo);
+
+    int i, n = heap.size();
+    RepoCategoryItem *recent = recent_updated_category_;
+
+    bool same_repos = recent->rowCount() == n;
+    for (i = 0; same_repos && i < n; i++) {
+        same_repos = items_[recent->rows_[i]].repo().id == heap[i]->id;
+    }
+
+    if (same_repos) {
+        for (i = 0; i < n; i++) {
+            RepoItem *item = &items_[recent->rows_[i]];
+            if (isRepoChanged(item->repo(), *heap[i])) {
+                updateRepoItem(item, *heap[i]);
+            }
+        }
+        return;
+    }
+
+    removeRepoRows(recent, 0, recent->rowCount());
+    appendRepoItems(recent, heap);
+}
+
+void RepoTreeModel::setLocalRepos(const std::vector<LocalRepo>& repos)
+{
+    if (unified_ || loaded_) {
+        return;
+    }
+
+    removeLocalRepos();
+    if (repos.empty()) {
+        return;
+    }
+
+    local_repos_category_ = new RepoCategoryItem(tr("Synced Libraries"));
+    insertCategory(0, local_repos_category_);
+
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        insertRepoItem(local_repos_category_, -1, serverRepoFromLocal(repos[i]), repos[i]);
+    }
+
+    expand(local_repos_category_);
+}
+
+void RepoTreeModel::removeLocalRepos()
+{
+    if (local_repos_category_) {
+        removeCategory(local_repos_category_);
+        local_repos_category_ = NULL;
+    }
+}
+
+// Drop the local repos now listed by the server
+void RepoTreeModel::mergeLocalRepos(const std::vector<ServerRepo>& repos)
+{
+    if (!local_repos_category_) {
+        return;
+    }
+
+    QSet<QString> ids;
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        ids.insert(repos[i].id);
+    }
+
+    for (int row = local_repos_category_->rowCount() - 1; row >= 0; row--) {
+        const ServerRepo& repo = items_[local_repos_category_->rows_[row]].repo();
+        if (ids.contains(repo.id)) {
+            removeRepoRows(local_repos_category_, row, 1);
         }
     }
 
-    // Find the repo in this group
-    n = group->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(group->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
+    if (local_repos_category_->rowCount() == 0) {
+        removeLocalRepos();
+    }
+}
+
+RepoCategoryItem* RepoTreeModel::findAccountCategory(const Account& account)
+{
+    return account_categories_.value(account.key());
+}
+
+void RepoTreeModel::setAccountRepos(const Account& account,
+                                    const std::vector<ServerRepo>& repos)
+{
+    RepoCategoryItem *category = findAccountCategory(account);
+    if (!category) {
+        category = new RepoCategoryItem(account);
+        insertCategory(-1, category);
+    }
+
+    // A repo shared to several groups is listed once for each group
+    std::vector<const ServerRepo*> new_repos;
+    QSet<QString> keys;
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        const ServerRepo& repo = repos[i];
+        const QString key = itemKey(category, repo);
+        if (keys.contains(key)) {
+            continue;
+        }
+        keys.insert(key);
+        added_repos_.remove(repoKey(repo));
+
+        int slot = slots_.value(key, -1);
+        if (slot < 0) {
+            new_repos.push_back(&repo);
+        } else if (isRepoChanged(items_[slot].repo(), repo)) {
+            updateRepoItem(&items_[slot], repo);
         }
     }
 
-    // Current repo not in this group yet
-    RepoItem *item = new RepoItem(repo);
-    group->appendRow(item);
+    appendRepoItems(category, new_repos);
+    removeUnlistedRepos(category, keys);
+    forgetLocalRepos();
+
+    loaded_ = true;
+}
+
+void RepoTreeModel::removeAccount(const Account& account)
+{
+    RepoCategoryItem *category = findAccountCategory(account);
+    if (category) {
+        removeCategory(category);
+    }
 }
 
 void RepoTreeModel::updateRepoItem(RepoItem *item, const ServerRepo& repo)
 {
+    QString text = searchTextOf(repo);
+    bool text_changed = text != searchTextOf(item->repo());
+
     item->setRepo(repo);
+    internStrings(&item->repo_);
+    search_index_.insert(item->slot_, text);
+    markItemChanged(item);
+
+    if (text_changed) {
+        emit searchTextChanged();
+    }
 }
 
-void RepoTreeModel::forEachRepoItem(void (RepoTreeModel::*func)(RepoItem *, void *),
-                                    void *data)
+void RepoTreeModel::markItemChanged(const RepoItem *item)
 {
-    int row;
-    int n;
-    QStandardItem *root = invisibleRootItem();
-    n = root->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoCategoryItem *category = (RepoCategoryItem *)root->child(row);
-        int j, total;
-        total = category->rowCount();
-        for (j = 0; j < total; j++) {
-            RepoItem *item = (RepoItem *)category->child(j);
-            (this->*func)(item, data);
+    int slot = item->slot_;
+    updateSortKey(slot);
+    moveToSortedRow(slot);
+
+    changed_slots_.push_back(slot);
+    if (!pending_changes_timer_->isActive()) {
+        pending_changes_timer_->start(kPendingChangesDelay);
+    }
+}
+
+void RepoTreeModel::emitPendingChanges()
+{
+    std::vector<int> slots;
+    slots.swap(changed_slots_);
+
+    QHash<RepoCategoryItem*, std::vector<int> > changed_rows;
+    for (int i = 0, n = slots.size(); i < n; i++) {
+        RepoCategoryItem *category = slot_categories_[slots[i]];
+        // Removed since
+        if (category) {
+            changed_rows[category].push_back(slot_rows_[slots[i]]);
+        }
+    }
+
+    QHash<RepoCategoryItem*, std::vector<int> >::iterator it;
+    for (it = changed_rows.begin(); it != changed_rows.end(); ++it) {
+        QModelIndex parent = indexOf(it.key());
+        std::vector<int>& rows = it.value();
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        int first = rows[0];
+        for (int i = 1, n = rows.size(); i <= n; i++) {
+            if (i < n && rows[i] == rows[i - 1] + 1) {
+                continue;
+            }
+            emit dataChanged(index(first, 0, parent), index(rows[i - 1], 0, parent));
+            if (i < n) {
+                first = rows[i];
+            }
         }
     }
 }
@@ -240,38 +1484,86 @@ void RepoTreeModel::refreshLocalRepos()
         return;
     }
 
+    // Only the model shown in the view needs to be kept up to date
+    if (!isShown()) {
+        return;
+    }
+
     std::vector<CloneTask> tasks;
     seafApplet->rpcClient()->getCloneTasks(&tasks);
 
-    forEachRepoItem(&RepoTreeModel::refreshRepoItem, (void*) &tasks);
+    // Rows out of view have to keep their sync state too, or they would be
+    // sorted by a stale one
+    if (sort_order_ == SORT_BY_SYNC_STATE) {
+        refreshAllLocalRepos(tasks);
+        return;
+    }
+
+    QModelIndexList indexes = tree_view_->visibleRepoIndexes();
+    if (indexes.isEmpty()) {
+        return;
+    }
+
+    // Refreshing an item may move it, so collect them first
+    std::vector<RepoItem*> items;
+    for (int i = 0, n = indexes.size(); i < n; i++) {
+        RepoItem *item = repoItem(indexes[i]);
+        if (item) {
+            items.push_back(item);
+        }
+    }
+
+    for (int i = 0, n = items.size(); i < n; i++) {
+        LocalRepo local_repo;
+        seafApplet->rpcClient()->getLocalRepo(items[i]->repo().id, &local_repo);
+        refreshRepoItem(items[i], local_repo, tasks);
+    }
 }
 
-void RepoTreeModel::refreshRepoItem(RepoItem *item, void *data)
+/**
+ * One listing of the local repos covers every row, so only the synced repos
+ * cost an RPC each, for their sync task, however many rows there are
+ */
+void RepoTreeModel::refreshAllLocalRepos(const std::vector<CloneTask>& tasks)
 {
-    if (!tree_view_->isExpanded(indexFromItem(item->parent()))) {
+    std::vector<LocalRepo> repos;
+    if (seafApplet->rpcClient()->listLocalRepos(&repos) < 0) {
         return;
     }
 
-    LocalRepo local_repo;
-    seafApplet->rpcClient()->getLocalRepo(item->repo().id, &local_repo);
-    if (local_repo != item->localRepo()) {
-        item->setLocalRepo(local_repo);
-        QModelIndex index = indexFromItem(item);
-        emit dataChanged(index,index);
-        // qDebug("repo %s is changed\n", toCStr(item->repo().name));
+    QHash<QString, LocalRepo> local_repos;
+    for (int i = 0, n = repos.size(); i < n; i++) {
+        seafApplet->rpcClient()->getSyncStatus(repos[i]);
+        local_repos.insert(repos[i].id, repos[i]);
     }
 
-    item->setCloneTask();
+    // Refreshing an item may move it, so collect them first
+    std::vector<RepoItem*> items;
+    for (int slot = 0, n = items_.size(); slot < n; slot++) {
+        if (slot_categories_[slot]) {
+            items.push_back(&items_[slot]);
+        }
+    }
+
+    for (int i = 0, n = items.size(); i < n; i++) {
+        refreshRepoItem(items[i], local_repos.value(items[i]->repo().id), tasks);
+    }
+}
+
+void RepoTreeModel::refreshRepoItem(RepoItem *item,
+                                    const LocalRepo& local_repo,
+                                    const std::vector<CloneTask>& tasks)
+{
+    setLocalRepo(item, local_repo);
+
+    setSlotCloneTask(item->slot_, CloneTask());
 
-    CloneTask clone_task;
-    std::vector<CloneTask>* tasks = (std::vector<CloneTask>*)data;
     if (!local_repo.isValid()) {
-        for (size_t i=0; i < tasks->size(); ++i) {
-            clone_task = tasks->at(i);
+        for (size_t i=0; i < tasks.size(); ++i) {
+            const CloneTask& clone_task = tasks[i];
             if (clone_task.repo_id == item->repo().id) {
-                item->setCloneTask(clone_task);
-                QModelIndex index = indexFromItem(item);
-                emit dataChanged(index,index);
+                setSlotCloneTask(item->slot_, clone_task);
+                markItemChanged(item);
             }
         }
     }
@@ -2,12 +2,22 @@
 #define SEAFILE_CLIENT_REPO_TREE_MODEL_H
 
 #include <vector>
-#include <QStandardItemModel>
+#include <deque>
+#include <QAbstractItemModel>
+#include <QStringList>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+
+#include "rpc/local-repo.h"
+#include "rpc/clone-task.h"
+#include "repo-item.h"
+#include "repo-search-index.h"
+
 class QModelIndex;
 
+struct Account;
 class ServerRepo;
-class RepoCategoryItem;
-class RepoItem;
 class QTimer;
 class RepoTreeView;
 
@@ -27,44 +37,306 @@ class RepoTreeView;
  *    - Notes
  *    - Musics
  *    - Logs
+ *
+ * In unified mode the first level items are accounts instead, each holding
+ * all the libraries of that account:
+ *
+ *  - foo@example.com(seacloud.cc)
+ *  - bar@example.com(cloud.example.com)
+ *
+ * The repo items are kept by value in slots of one array, with the category,
+ * row, sync state and download progress of each slot in arrays beside it.
+ * Categories only hold the slots of their rows, so finding the index of an
+ * item, e.g. for dataChanged(), takes no search.
  */
-class RepoTreeModel : public QStandardItemModel {
+class RepoTreeModel : public QAbstractItemModel {
     Q_OBJECT
 
 public:
-    RepoTreeModel(QObject *parent=0);
-    void setRepos(const std::vector<ServerRepo>& repos);
+    /**
+     * How the repos of a category are ordered. "Recent Updated" is always
+     * ordered by the last modified time.
+     */
+    enum SortOrder {
+        // As listed by the server
+        SORT_BY_SERVER_ORDER = 0,
+        SORT_BY_NAME,
+        // Largest first
+        SORT_BY_SIZE,
+        // Most recently modified first
+        SORT_BY_MTIME,
+        // Errors first, then syncing, then synced, then not synced
+        SORT_BY_SYNC_STATE,
+    };
+
+    explicit RepoTreeModel(bool unified=false, QObject *parent=0);
+    ~RepoTreeModel();
+
+    /**
+     * The first list fills the tree, later ones only add, remove and update
+     * the repos that differ from the tree.
+     *
+     * Return the number of repos added, removed or changed.
+     */
+    int setRepos(const std::vector<ServerRepo>& repos);
+
+    /**
+     * Show the libraries synced by seaf-daemon while the list from the server
+     * is loading. The server repos replace them as they arrive.
+     */
+    void setLocalRepos(const std::vector<LocalRepo>& repos);
+    void removeLocalRepos();
+
+    /**
+     * Show a repo the user has just created, without reloading the list. It
+     * is kept until a list from the server includes it.
+     */
+    void addRepo(const ServerRepo& repo);
+
+    /**
+     * Update the items of a repo right after the user changed it locally,
+     * instead of waiting for the next poll of seaf-daemon. An invalid local
+     * repo marks the repo as not synced.
+     */
+    void updateLocalRepo(const QString& repo_id, const LocalRepo& local_repo);
+    void updateCloneTask(const QString& repo_id, const CloneTask& task);
+
+    // Update one item, e.g. with the local repo just read for its menu
+    void setLocalRepo(const RepoItem *item, const LocalRepo& local_repo);
+
+    // Invalid if the repo is not synced, or not being downloaded
+    const LocalRepo& localRepo(const RepoItem *item) const;
+    const CloneTask& cloneTask(const RepoItem *item) const;
+
+    // The LocalRepo::SyncState of a synced repo, -1 if it is not synced
+    int syncState(const RepoItem *item) const { return slot_sync_states_[item->slot_]; }
+    // Percent done of the download of a repo, -1 if none is shown
+    int downloadProgress(const RepoItem *item) const { return slot_progress_[item->slot_]; }
+
+    bool repoDownloadable(const RepoItem *item) const;
+
+    // Used in unified mode
+    void addAccountRepo(const Account& account, const ServerRepo& repo);
+    void setAccountRepos(const Account& account, const std::vector<ServerRepo>& repos);
+    void removeAccount(const Account& account);
 
     void clear();
 
+    /**
+     * Reorder the rows of every category. The rows of new and changed repos
+     * are then moved to their place as they arrive.
+     */
+    void setSortOrder(SortOrder order);
+    SortOrder sortOrder() const { return sort_order_; }
+
+    QModelIndex index(int row, int column, const QModelIndex& parent=QModelIndex()) const;
+    QModelIndex parent(const QModelIndex& index) const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    int columnCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role=Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+
+    /**
+     * Group categories start without rows. The view asks for them when it
+     * expands one, and they are released again after the group has stayed
+     * collapsed for a while.
+     */
+    bool hasChildren(const QModelIndex& parent=QModelIndex()) const;
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
+
+    // NULL if the index is not of a repo, or of a category
+    RepoItem *repoItem(const QModelIndex& index) const;
+    RepoCategoryItem *categoryItem(const QModelIndex& index) const;
+
+    /**
+     * The view shows the model through a proxy. Map an index of the view to
+     * the index of the RepoTreeModel behind it.
+     */
+    static QModelIndex sourceIndex(const QModelIndex& index);
+
+    // The category listing the item
+    const RepoCategoryItem *categoryOf(const RepoItem *item) const;
+    QModelIndex indexOf(const RepoCategoryItem *category) const;
+    QModelIndex indexOf(const RepoItem *item) const;
+
+    bool isUnified() const { return unified_; }
+
+    // Whether the repos list has been set at least once
+    bool isLoaded() const { return loaded_; }
+
+    /**
+     * The view forgets which categories are expanded when its model is
+     * replaced, or when the model is reset.
+     */
+    void saveExpandedState();
+    void restoreExpandedState();
+
+    /**
+     * The keys, see itemKey(), of the repos whose name, description, owner
+     * or group contains every word of the query. Groups not expanded yet are
+     * searched through an index of their repos, and only those with matches
+     * get their rows, so that every match has a row to show.
+     */
+    void searchRepos(const QString& query, QSet<QString> *keys);
+
+    // Identifies the row of a repo for as long as it is listed, unlike the
+    // item whose slot may be reused by another repo
+    QString itemKey(const RepoItem *item) const;
+
     void setTreeView(RepoTreeView *view) { tree_view_ = view; }
     RepoTreeView* treeView() { return tree_view_; }
 
-private slots:
+signals:
+    // The name, description, owner or group of a listed repo has changed
+    void searchTextChanged();
+
+public slots:
+    /**
+     * Poll seaf-daemon for the state of the repos in the viewport of the
+     * view. Rows out of view are left as they are until scrolled into it,
+     * unless the rows are sorted by sync state.
+     */
     void refreshLocalRepos();
 
+private slots:
+    void emitPendingChanges();
+    void releaseCollapsedGroups();
+
 private:
-    void checkPersonalRepo(const ServerRepo& repo);
-    void checkSharedRepo(const ServerRepo& repo);
-    void checkGroupRepo(const ServerRepo& repo);
+    int applyReposDelta(const std::vector<ServerRepo>& repos);
+    int setUnfetchedRepos(RepoCategoryItem *group, std::vector<ServerRepo> *repos);
+    void updateRecentUpdatedRepos(const std::vector<ServerRepo>& repos);
+    RepoCategoryItem *categoryForRepo(const ServerRepo& repo);
+    void mergeLocalRepos(const std::vector<ServerRepo>& repos);
     void initialize();
+    bool isRecentlyAdded(const QString& key);
     void updateRepoItem(RepoItem *item, const ServerRepo& repo);
-    void refreshRepoItem(RepoItem *item, void *data);
+    void markItemChanged(const RepoItem *item);
+    void refreshAllLocalRepos(const std::vector<CloneTask>& tasks);
+    void refreshRepoItem(RepoItem *item,
+                         const LocalRepo& local_repo,
+                         const std::vector<CloneTask>& tasks);
+
+    RepoCategoryItem *findAccountCategory(const Account& account);
+    std::vector<RepoItem*> findRepoItems(const QString& repo_id);
+
+    /**
+     * All items and categories are added and removed through these, which
+     * keep the slots and the indexes below up to date. A row of -1 appends.
+     */
+    RepoItem *insertRepoItem(RepoCategoryItem *category, int row,
+                             const ServerRepo& repo, const LocalRepo& local_repo);
+    void appendRepoItems(RepoCategoryItem *category, const std::vector<const ServerRepo*>& repos);
+    void removeRepoRows(RepoCategoryItem *category, int row, int count);
+    int removeUnlistedRepos(RepoCategoryItem *category, const QSet<QString>& keys);
+    void insertCategory(int row, RepoCategoryItem *category);
+    void removeCategory(RepoCategoryItem *category);
+    int allocSlot(RepoCategoryItem *category, int row,
+                  const ServerRepo& repo, const LocalRepo& local_repo);
+    void freeSlot(int slot);
+    void setSlotLocalRepo(int slot, const LocalRepo& local_repo);
+    void setSlotCloneTask(int slot, const CloneTask& task);
+    void internStrings(ServerRepo *repo);
+    void renumberRows(RepoCategoryItem *category, int from);
+    QString itemKey(const RepoCategoryItem *category, const ServerRepo& repo) const;
+
+    /**
+     * The rows of a category are kept in sort order, compared by the sort
+     * keys of their slots. Keys are computed when an item is added or
+     * changed, never while comparing.
+     */
+    struct SortKey {
+        // Lowercased name
+        QString name;
+        qint64 size;
+        qint64 mtime;
+        int sync_state;
+        // Order in which the slot was listed, which breaks ties so that
+        // sorting is stable
+        quint64 seq;
+    };
+    class SlotOrder;
 
-    void forEachRepoItem(void (RepoTreeModel::*func)(RepoItem *, void *), void *data);
+    bool isSorted(const RepoCategoryItem *category) const;
+    bool slotLess(int a, int b) const;
+    void updateSortKey(int slot);
+    int sortedRow(const RepoCategoryItem *category, int slot) const;
+    void moveToSortedRow(int slot);
+    void sortRows(const std::vector<RepoCategoryItem*>& categories, int sorted_rows);
 
-    void removeReposDeletedOnServer(const std::vector<ServerRepo>& repos);
+    // Whether this model is the one shown in the tree view
+    bool isShown() const;
+    bool isExpanded(const RepoCategoryItem *category) const;
+    void expand(const RepoCategoryItem *category);
 
-    void collectDeletedRepos(RepoItem *item, void *vdata);
+    // Local repos by id, listed once for a whole list of server repos
+    LocalRepo localRepoOf(const QString& repo_id);
+    void forgetLocalRepos();
 
     RepoCategoryItem *recent_updated_category_;
     RepoCategoryItem *my_repos_catetory_;
     RepoCategoryItem *shared_repos_catetory_;
+    RepoCategoryItem *local_repos_category_;
 
     QTimer *refresh_local_timer_;
+    QTimer *release_groups_timer_;
+
+    // Slots of the items changed since the last dataChanged(), which is
+    // emitted once per frame for each run of adjacent rows
+    std::vector<int> changed_slots_;
+    QTimer *pending_changes_timer_;
+
+    // Categories in the order they are shown
+    std::vector<RepoCategoryItem*> categories_;
+
+    // The items, which keep their address as the deque grows. Slots of
+    // removed items are reused.
+    std::deque<RepoItem> items_;
+    std::vector<RepoCategoryItem*> slot_categories_;
+    std::vector<int> slot_rows_;
+    std::vector<SortKey> slot_sort_keys_;
+    // What the view paints for every row, see syncState() and
+    // downloadProgress()
+    std::vector<qint8> slot_sync_states_;
+    std::vector<qint8> slot_progress_;
+    std::vector<int> free_slots_;
+
+    // Most repos are neither synced nor being downloaded, so the local repos
+    // and clone tasks are only kept for the slots of those which are
+    QHash<int, LocalRepo> slot_local_repos_;
+    QHash<int, CloneTask> slot_clone_tasks_;
+
+    // The type, owner, permission and group of the repos take a handful of
+    // values, the items share the data of the strings here
+    QSet<QString> string_pool_;
+
+    // Slots by itemKey()
+    QHash<QString, int> slots_;
+    // All slots of a repo, by repo id
+    QMultiHash<QString, int> slots_by_repo_id_;
+    QHash<int, RepoCategoryItem*> group_categories_;
+    QHash<QString, RepoCategoryItem*> account_categories_;
+
+    // Text of the items by slot, for the filter of the view
+    RepoSearchIndex search_index_;
+
+    QHash<QString, LocalRepo> local_repos_;
+    bool local_repos_listed_;
+
+    // Keys of the repos added by addRepo() => when they were added
+    QHash<QString, qint64> added_repos_;
 
     RepoTreeView *tree_view_;
 
+    SortOrder sort_order_;
+    quint64 next_sort_seq_;
+
+    bool unified_;
+    bool loaded_;
+
+    bool expanded_state_saved_;
+    QStringList expanded_categories_;
 };
 
 #endif // SEAFILE_CLIENT_REPO_TREE_MODEL_H
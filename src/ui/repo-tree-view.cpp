@@ -4,20 +4,40 @@
 #include <QEvent>
 #include <QShowEvent>
 #include <QHideEvent>
+#include <QDragEnterEvent>
+#include <QDragMoveEvent>
+#include <QDropEvent>
+#include <QFileInfo>
 
 #include "QtAwesome.h"
 #include "utils/utils.h"
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
 #include "rpc/local-repo.h"
+#include "api/requests.h"
+#include "api/api-cache.h"
 #include "download-repo-dialog.h"
+#include "bulk-download-dialog.h"
 #include "clone-tasks-dialog.h"
 #include "cloud-view.h"
 #include "repo-item.h"
 #include "repo-item-delegate.h"
 #include "repo-tree-model.h"
+#include "repo-filter-proxy-model.h"
 #include "repo-tree-view.h"
 #include "repo-detail-dialog.h"
+#include "repo-browser-dialog.h"
+#include "upload-dialog.h"
+
+namespace {
+
+// Only prefetch for an item the mouse rests on
+const int kHoverPrefetchDelay = 300;
+const int kMaxDownloadInfoPrefetches = 4;
+// Wait for scrolling to settle before refreshing the rows in view
+const int kVisibleRefreshDelay = 100;
+
+} // namespace
 
 RepoTreeView::RepoTreeView(CloudView *cloud_view, QWidget *parent)
     : QTreeView(parent),
@@ -31,11 +51,115 @@ RepoTreeView::RepoTreeView(CloudView *cloud_view, QWidget *parent)
     // We handle the click oursevles
     setExpandsOnDoubleClick(false);
 
+    // Ctrl/Shift click selects several libraries to download at once
+    setSelectionMode(QAbstractItemView::ExtendedSelection);
+
     connect(this, SIGNAL(clicked(const QModelIndex&)),
             this, SLOT(onItemClicked(const QModelIndex&)));
 
     connect(this, SIGNAL(doubleClicked(const QModelIndex&)),
             this, SLOT(onItemDoubleClicked(const QModelIndex&)));
+
+    // Files dropped on a library are uploaded to it
+    viewport()->setAcceptDrops(true);
+    setDropIndicatorShown(true);
+
+    // Needed for the entered() signal
+    setMouseTracking(true);
+    connect(this, SIGNAL(entered(const QModelIndex&)),
+            this, SLOT(onItemEntered(const QModelIndex&)));
+
+    hover_timer_ = new QTimer(this);
+    hover_timer_->setSingleShot(true);
+    connect(hover_timer_, SIGNAL(timeout()), this, SLOT(prefetchHoveredRepo()));
+
+    // Only the rows in view are kept up to date, see RepoTreeModel
+    visible_refresh_timer_ = new QTimer(this);
+    visible_refresh_timer_->setSingleShot(true);
+    connect(visible_refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshVisibleRepos()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)),
+            this, SLOT(scheduleVisibleRefresh()));
+    connect(this, SIGNAL(expanded(const QModelIndex&)),
+            this, SLOT(scheduleVisibleRefresh()));
+
+    // Every category with a match is shown expanded
+    filter_model_ = new RepoFilterProxyModel(this);
+    connect(filter_model_, SIGNAL(refiltered()), this, SLOT(expandAll()));
+    setModel(filter_model_);
+}
+
+void RepoTreeView::setTreeModel(RepoTreeModel *model)
+{
+    filter_model_->setSourceModel(model);
+}
+
+RepoTreeModel* RepoTreeView::treeModel() const
+{
+    return filter_model_->treeModel();
+}
+
+QModelIndex RepoTreeView::viewIndex(const QModelIndex& source_index) const
+{
+    return filter_model_->mapFromSource(source_index);
+}
+
+void RepoTreeView::setFilterText(const QString& text)
+{
+    RepoTreeModel *tree_model = treeModel();
+    bool was_filtering = isFiltering();
+    if (!was_filtering && tree_model) {
+        tree_model->saveExpandedState();
+    }
+
+    filter_model_->setFilterText(text);
+
+    if (was_filtering && !isFiltering()) {
+        collapseAll();
+        if (tree_model) {
+            tree_model->restoreExpandedState();
+        }
+    }
+    scheduleVisibleRefresh();
+}
+
+bool RepoTreeView::isFiltering() const
+{
+    return filter_model_->isFiltering();
+}
+
+QModelIndexList RepoTreeView::visibleRepoIndexes() const
+{
+    QModelIndexList indexes;
+    if (!treeModel()) {
+        return indexes;
+    }
+
+    const QRect rect = viewport()->rect();
+    for (QModelIndex index = indexAt(rect.topLeft());
+         index.isValid();
+         index = indexBelow(index)) {
+        if (visualRect(index).top() > rect.bottom()) {
+            break;
+        }
+        if (repoItemAt(index)) {
+            indexes << filter_model_->mapToSource(index);
+        }
+    }
+
+    return indexes;
+}
+
+void RepoTreeView::scheduleVisibleRefresh()
+{
+    visible_refresh_timer_->start(kVisibleRefreshDelay);
+}
+
+void RepoTreeView::refreshVisibleRepos()
+{
+    RepoTreeModel *tree_model = treeModel();
+    if (tree_model) {
+        tree_model->refreshLocalRepos();
+    }
 }
 
 void RepoTreeView::contextMenuEvent(QContextMenuEvent *event)
@@ -47,30 +171,51 @@ void RepoTreeView::contextMenuEvent(QContextMenuEvent *event)
         return;
     }
 
-    QStandardItem *item = getRepoItem(index);
-    if (!item || item->type() != REPO_ITEM_TYPE) {
+    RepoItem *item = repoItemAt(index);
+    if (!item) {
         return;
     }
+
+    // Several libraries to download are selected
+    int downloadable = 0;
+    std::vector<RepoItem*> items = selectedRepoItems();
+    for (int i = 0, n = items.size(); i < n; i++) {
+        if (treeModel()->repoDownloadable(items[i])) {
+            downloadable++;
+        }
+    }
+    if (downloadable > 1) {
+        bulk_download_action_->setText(tr("&Download %n libraries", "", downloadable));
+        QMenu menu(this);
+        menu.addAction(bulk_download_action_);
+        menu.exec(viewport()->mapToGlobal(pos));
+        return;
+    }
+
     updateRepoActions();
-    QMenu *menu = prepareContextMenu((RepoItem *)item);
+    QMenu *menu = prepareContextMenu(item);
     pos = viewport()->mapToGlobal(pos);
     menu->exec(pos);
 }
 
 QMenu* RepoTreeView::prepareContextMenu(const RepoItem *item)
 {
+    RepoTreeModel *tree_model = treeModel();
+    bool synced = tree_model->localRepo(item).isValid();
+
     QMenu *menu = new QMenu(this);
-    if (item->localRepo().isValid()) {
+    if (synced) {
         menu->addAction(open_local_folder_action_);
     }
 
-    if (item->repoDownloadable()) {
+    if (tree_model->repoDownloadable(item)) {
         menu->addAction(download_action_);
     }
 
     menu->addAction(view_on_web_action_);
+    menu->addAction(browse_action_);
 
-    if (item->localRepo().isValid()) {
+    if (synced) {
         menu->addSeparator();
         menu->addAction(toggle_auto_sync_action_);
         menu->addAction(sync_now_action_);
@@ -79,29 +224,72 @@ QMenu* RepoTreeView::prepareContextMenu(const RepoItem *item)
 
     menu->addAction(show_detail_action_);
 
-    if (item->cloneTask().isCancelable()) {
+    if (tree_model->cloneTask(item).isCancelable()) {
         menu->addAction(cancel_download_action_);
     }
-    if (item->localRepo().isValid()) {
+    if (synced) {
         menu->addAction(unsync_action_);
     }
 
     return menu;
 }
 
-void RepoTreeView::updateRepoActions()
+RepoItem* RepoTreeView::selectedRepoItem() const
 {
-    RepoItem *item = NULL;
     QItemSelection selected = selectionModel()->selection();
     QModelIndexList indexes = selected.indexes();
     if (indexes.size() != 0) {
-        const QModelIndex& index = indexes.at(0);
-        QStandardItem *it = ((RepoTreeModel *)model())->itemFromIndex(index);
-        if (it && it->type() == REPO_ITEM_TYPE) {
-            item = (RepoItem *)it;
+        return repoItemAt(indexes.at(0));
+    }
+
+    return NULL;
+}
+
+/**
+ * A repo is listed in "Recent Updated" and in its own category, it is only
+ * returned once
+ */
+std::vector<RepoItem*> RepoTreeView::selectedRepoItems() const
+{
+    std::vector<RepoItem*> items;
+    QSet<QString> keys;
+    QModelIndexList indexes = selectionModel()->selectedRows();
+    for (int i = 0, n = indexes.size(); i < n; i++) {
+        RepoItem *item = repoItemAt(indexes.at(i));
+        if (!item) {
+            continue;
+        }
+
+        QString key = accountOfItem(item).key() + "\t" + item->repo().id;
+        if (!keys.contains(key)) {
+            keys.insert(key);
+            items.push_back(item);
         }
     }
 
+    return items;
+}
+
+/**
+ * In the unified view a repo belongs to the account of its category,
+ * otherwise to the current account
+ */
+Account RepoTreeView::accountOfItem(const RepoItem *item) const
+{
+    if (item) {
+        const RepoCategoryItem *category = treeModel()->categoryOf(item);
+        if (category && category->isAccount()) {
+            return category->account();
+        }
+    }
+
+    return cloud_view_->currentAccount();
+}
+
+void RepoTreeView::updateRepoActions()
+{
+    RepoItem *item = selectedRepoItem();
+
     if (!item) {
         // No repo item is selected
         download_action_->setEnabled(false);
@@ -110,16 +298,17 @@ void RepoTreeView::updateRepoActions()
         unsync_action_->setEnabled(false);
         toggle_auto_sync_action_->setEnabled(false);
         view_on_web_action_->setEnabled(false);
+        browse_action_->setEnabled(false);
         show_detail_action_->setEnabled(false);
         return;
     }
 
-    LocalRepo r;
-    seafApplet->rpcClient()->getLocalRepo(item->repo().id, &r);
-    item->setLocalRepo(r);
+    RepoTreeModel *tree_model = treeModel();
+    LocalRepo local_repo;
+    seafApplet->rpcClient()->getLocalRepo(item->repo().id, &local_repo);
+    tree_model->setLocalRepo(item, local_repo);
 
-    if (item->localRepo().isValid()) {
-        const LocalRepo& local_repo = item->localRepo();
+    if (local_repo.isValid()) {
         download_action_->setEnabled(false);
 
         sync_now_action_->setEnabled(true);
@@ -144,7 +333,7 @@ void RepoTreeView::updateRepoActions()
         }
 
     } else {
-        if (item->repoDownloadable()) {
+        if (tree_model->repoDownloadable(item)) {
             download_action_->setEnabled(true);
             download_action_->setData(QVariant::fromValue(item->repo()));
         } else {
@@ -160,10 +349,13 @@ void RepoTreeView::updateRepoActions()
 
     view_on_web_action_->setEnabled(true);
     view_on_web_action_->setData(item->repo().id);
+    // Listing an encrypted library needs its password on the server
+    browse_action_->setEnabled(!item->repo().encrypted);
+    browse_action_->setData(QVariant::fromValue(item->repo()));
     show_detail_action_->setEnabled(true);
     show_detail_action_->setData(QVariant::fromValue(item->repo()));
 
-    if (item->cloneTask().isCancelable()) {
+    if (tree_model->cloneTask(item).isCancelable()) {
         cancel_download_action_->setEnabled(true);
         cancel_download_action_->setData(QVariant::fromValue(item->repo()));
     } else {
@@ -171,18 +363,22 @@ void RepoTreeView::updateRepoActions()
     }
 }
 
-QStandardItem* RepoTreeView::getRepoItem(const QModelIndex &index) const
+RepoItem* RepoTreeView::repoItemAt(const QModelIndex &index) const
 {
     if (!index.isValid()) {
         return NULL;
     }
-    const RepoTreeModel *model = (const RepoTreeModel*)index.model();
-    QStandardItem *item = model->itemFromIndex(index);
-    if (item->type() != REPO_ITEM_TYPE &&
-        item->type() != REPO_CATEGORY_TYPE) {
+    QModelIndex source = RepoTreeModel::sourceIndex(index);
+    return ((const RepoTreeModel *)source.model())->repoItem(source);
+}
+
+RepoCategoryItem* RepoTreeView::categoryItemAt(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
         return NULL;
     }
-    return item;
+    QModelIndex source = RepoTreeModel::sourceIndex(index);
+    return ((const RepoTreeModel *)source.model())->categoryItem(source);
 }
 
 void RepoTreeView::createActions()
@@ -199,6 +395,12 @@ void RepoTreeView::createActions()
     download_action_->setIconVisibleInMenu(true);
     connect(download_action_, SIGNAL(triggered()), this, SLOT(downloadRepo()));
 
+    bulk_download_action_ = new QAction(tr("&Download libraries"), this);
+    bulk_download_action_->setIcon(QIcon(":/images/download.png"));
+    bulk_download_action_->setStatusTip(tr("Download the selected libraries"));
+    bulk_download_action_->setIconVisibleInMenu(true);
+    connect(bulk_download_action_, SIGNAL(triggered()), this, SLOT(downloadSelectedRepos()));
+
     sync_now_action_ = new QAction(tr("&Sync now"), this);
     sync_now_action_->setIcon(QIcon(":/images/sync_now.png"));
     sync_now_action_->setStatusTip(tr("Sync this library immediately"));
@@ -234,18 +436,133 @@ void RepoTreeView::createActions()
     view_on_web_action_->setIconVisibleInMenu(true);
 
     connect(view_on_web_action_, SIGNAL(triggered()), this, SLOT(viewRepoOnWeb()));
+
+    browse_action_ = new QAction(tr("&Browse files"), this);
+    browse_action_->setIcon(QIcon(":/images/folder-open.png"));
+    browse_action_->setStatusTip(tr("Browse the files of this library without downloading it"));
+    browse_action_->setIconVisibleInMenu(true);
+    connect(browse_action_, SIGNAL(triggered()), this, SLOT(browseRepo()));
 }
 
 void RepoTreeView::downloadRepo()
 {
     ServerRepo repo = qvariant_cast<ServerRepo>(download_action_->data());
-    DownloadRepoDialog dialog(cloud_view_->currentAccount(), repo, this);
+    DownloadRepoDialog dialog(accountOfItem(selectedRepoItem()), repo, this);
+
+    if (dialog.exec() == QDialog::Accepted) {
+        // Show the download as started, the next poll of seaf-daemon
+        // replaces it with the real task
+        CloneTask task;
+        task.repo_id = repo.id;
+        task.repo_name = repo.name;
+        task.state = "init";
+        task.block_done = task.block_total = 0;
+        task.checkout_done = task.checkout_total = 0;
+        task.translateStateInfo();
+        treeModel()->updateCloneTask(repo.id, task);
+    }
 
-    dialog.exec();
+    updateRepoActions();
+}
+
+void RepoTreeView::downloadSelectedRepos()
+{
+    std::vector<BulkDownloadDialog::Library> libraries;
+    std::vector<RepoItem*> items = selectedRepoItems();
+    for (int i = 0, n = items.size(); i < n; i++) {
+        if (!treeModel()->repoDownloadable(items[i])) {
+            continue;
+        }
+        BulkDownloadDialog::Library library;
+        library.account = accountOfItem(items[i]);
+        library.repo = items[i]->repo();
+        libraries.push_back(library);
+    }
+
+    if (libraries.empty()) {
+        return;
+    }
+
+    // Not modal, the queue may take long
+    BulkDownloadDialog *dialog = new BulkDownloadDialog(libraries, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
 
     updateRepoActions();
 }
 
+QStringList RepoTreeView::droppedFiles(const QMimeData *mime_data) const
+{
+    QStringList paths;
+    if (!mime_data->hasUrls()) {
+        return paths;
+    }
+
+    foreach (const QUrl& url, mime_data->urls()) {
+        QString path = url.toLocalFile();
+        // Folders are not supported
+        if (path.isEmpty() || !QFileInfo(path).isFile()) {
+            return QStringList();
+        }
+        paths << path;
+    }
+
+    return paths;
+}
+
+RepoItem* RepoTreeView::uploadTargetAt(const QPoint& pos) const
+{
+    RepoItem *item = repoItemAt(indexAt(pos));
+    if (!item) {
+        return NULL;
+    }
+
+    const ServerRepo& repo = item->repo();
+    // Uploading to an encrypted library needs its password on the server
+    if (repo.encrypted || repo.permission != "rw") {
+        return NULL;
+    }
+
+    return item;
+}
+
+void RepoTreeView::dragEnterEvent(QDragEnterEvent *event)
+{
+    if (droppedFiles(event->mimeData()).isEmpty()) {
+        event->ignore();
+        return;
+    }
+
+    event->acceptProposedAction();
+}
+
+void RepoTreeView::dragMoveEvent(QDragMoveEvent *event)
+{
+    if (!uploadTargetAt(event->pos()) || droppedFiles(event->mimeData()).isEmpty()) {
+        event->ignore();
+        return;
+    }
+
+    event->acceptProposedAction();
+}
+
+void RepoTreeView::dropEvent(QDropEvent *event)
+{
+    RepoItem *item = uploadTargetAt(event->pos());
+    QStringList paths = droppedFiles(event->mimeData());
+    if (!item || paths.isEmpty()) {
+        event->ignore();
+        return;
+    }
+
+    event->acceptProposedAction();
+
+    // Not modal, the drag source waits for the drop to return
+    UploadDialog *dialog = new UploadDialog(accountOfItem(item), item->repo(), paths, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
 void RepoTreeView::showRepoDetail()
 {
     ServerRepo repo = qvariant_cast<ServerRepo>(show_detail_action_->data());
@@ -253,6 +570,13 @@ void RepoTreeView::showRepoDetail()
     dialog.exec();
 }
 
+void RepoTreeView::browseRepo()
+{
+    ServerRepo repo = qvariant_cast<ServerRepo>(browse_action_->data());
+    RepoBrowserDialog dialog(accountOfItem(selectedRepoItem()), repo, this);
+    dialog.exec();
+}
+
 void RepoTreeView::openLocalFolder()
 {
     LocalRepo repo = qvariant_cast<LocalRepo>(open_local_folder_action_->data());
@@ -262,8 +586,18 @@ void RepoTreeView::openLocalFolder()
 void RepoTreeView::toggleRepoAutoSync()
 {
     LocalRepo repo = qvariant_cast<LocalRepo>(toggle_auto_sync_action_->data());
+    RepoTreeModel *tree_model = treeModel();
+
+    LocalRepo toggled(repo);
+    toggled.auto_sync = !repo.auto_sync;
+    tree_model->updateLocalRepo(repo.id, toggled);
 
-    seafApplet->rpcClient()->setRepoAutoSync(repo.id, !repo.auto_sync);
+    if (seafApplet->rpcClient()->setRepoAutoSync(repo.id, toggled.auto_sync) < 0) {
+        tree_model->updateLocalRepo(repo.id, repo);
+        QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
+                             tr("Failed to change auto sync of library \"%1\"").arg(repo.name),
+                             QMessageBox::Ok);
+    }
 
     updateRepoActions();
 }
@@ -282,7 +616,11 @@ void RepoTreeView::unsyncRepo()
         return;
     }
 
+    RepoTreeModel *tree_model = treeModel();
+    tree_model->updateLocalRepo(repo.id, LocalRepo());
+
     if (seafApplet->rpcClient()->unsync(repo.id) < 0) {
+        tree_model->updateLocalRepo(repo.id, repo);
         QMessageBox::warning(this, tr(SEAFILE_CLIENT_BRAND),
                              tr("Failed to unsync library \"%1\"").arg(repo.name),
                              QMessageBox::Ok);
@@ -293,14 +631,8 @@ void RepoTreeView::unsyncRepo()
 
 void RepoTreeView::onItemClicked(const QModelIndex& index)
 {
-    QStandardItem *item = getRepoItem(index);
-    if (!item) {
-        return;
-    }
-    if (item->type() == REPO_ITEM_TYPE) {
-        return;
-    } else {
-        // A repo category item
+    // A repo category item
+    if (categoryItemAt(index)) {
         if (isExpanded(index)) {
             collapse(index);
         } else {
@@ -311,23 +643,21 @@ void RepoTreeView::onItemClicked(const QModelIndex& index)
 
 void RepoTreeView::onItemDoubleClicked(const QModelIndex& index)
 {
-    QStandardItem *item = getRepoItem(index);
+    RepoItem *item = repoItemAt(index);
     if (!item) {
         return;
     }
-    if (item->type() == REPO_ITEM_TYPE) {
-        RepoItem *it = (RepoItem *)item;
-        const LocalRepo& local_repo = it->localRepo();
-        if (local_repo.isValid()) {
-            QDesktopServices::openUrl(QUrl::fromLocalFile(local_repo.worktree));
-        }
+
+    const LocalRepo& local_repo = treeModel()->localRepo(item);
+    if (local_repo.isValid()) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(local_repo.worktree));
     }
 }
 
 void RepoTreeView::viewRepoOnWeb()
 {
     QString repo_id = view_on_web_action_->data().toString();
-    const Account& account = cloud_view_->currentAccount();
+    const Account account = accountOfItem(selectedRepoItem());
     if (account.isValid()) {
         QUrl url = account.serverUrl;
         url.setPath(url.path() + "/repo/" + repo_id);
@@ -348,16 +678,16 @@ bool RepoTreeView::viewportEvent(QEvent *event)
         return true;
     }
 
-    QStandardItem *item = getRepoItem(index);
-    if (!item) {
+    QRect item_rect = visualRect(index);
+    RepoItem *item = repoItemAt(index);
+    if (item) {
+        showRepoItemToolTip(item, global_pos, item_rect);
         return true;
     }
 
-    QRect item_rect = visualRect(index);
-    if (item->type() == REPO_ITEM_TYPE) {
-        showRepoItemToolTip((RepoItem *)item, global_pos, item_rect);
-    } else {
-        showRepoCategoryItemToolTip((RepoCategoryItem *)item, global_pos, item_rect);
+    RepoCategoryItem *category = categoryItemAt(index);
+    if (category) {
+        showRepoCategoryItemToolTip(category, global_pos, item_rect);
     }
 
     return true;
@@ -368,7 +698,7 @@ void RepoTreeView::showRepoItemToolTip(const RepoItem *item,
                                        const QRect& rect)
 {
     RepoItemDelegate *delegate = (RepoItemDelegate *)itemDelegate();
-    delegate->showRepoItemToolTip(item, pos, viewport(), rect);
+    delegate->showRepoItemToolTip(treeModel(), item, pos, viewport(), rect);
 }
 
 void RepoTreeView::showRepoCategoryItemToolTip(const RepoCategoryItem *item,
@@ -394,6 +724,68 @@ void RepoTreeView::selectionChanged(const QItemSelection &selected,
                                     const QItemSelection &deselected)
 {
     updateRepoActions();
+    prefetchDownloadInfo(selectedRepoItem());
+}
+
+void RepoTreeView::onItemEntered(const QModelIndex& index)
+{
+    hovered_index_ = index;
+    hover_timer_->start(kHoverPrefetchDelay);
+}
+
+void RepoTreeView::prefetchHoveredRepo()
+{
+    if (!hovered_index_.isValid() || hovered_index_.model() != model()) {
+        return;
+    }
+
+    prefetchDownloadInfo(repoItemAt(hovered_index_));
+}
+
+void RepoTreeView::prefetchDownloadInfo(const RepoItem *item)
+{
+    if (!item || !treeModel()->repoDownloadable(item)) {
+        return;
+    }
+
+    const Account account = accountOfItem(item);
+    if (!account.isValid()) {
+        return;
+    }
+
+    const ServerRepo& repo = item->repo();
+    const QString key = account.key() + "\t" + repo.id;
+    if (download_info_reqs_.contains(key)
+        || download_info_reqs_.size() >= kMaxDownloadInfoPrefetches
+        || ApiCache::instance()->hasDownloadInfo(account, repo.id)) {
+        return;
+    }
+
+    DownloadRepoRequest *req = new DownloadRepoRequest(account, repo);
+    req->setParent(this);
+    req->setPriority(QNetworkRequest::LowPriority);
+    req->setMaxRetries(0);
+    connect(req, SIGNAL(success(const RepoDownloadInfo&)),
+            this, SLOT(onDownloadInfoPrefetched(const RepoDownloadInfo&)));
+    connect(req, SIGNAL(failed(int)), this, SLOT(onDownloadInfoPrefetchFailed()));
+    download_info_reqs_.insert(key, req);
+    req->send();
+}
+
+void RepoTreeView::onDownloadInfoPrefetched(const RepoDownloadInfo& info)
+{
+    DownloadRepoRequest *req = qobject_cast<DownloadRepoRequest *>(sender());
+    download_info_reqs_.remove(req->account().key() + "\t" + req->repo().id);
+    req->deleteLater();
+
+    ApiCache::instance()->setDownloadInfo(req->account(), info);
+}
+
+void RepoTreeView::onDownloadInfoPrefetchFailed()
+{
+    DownloadRepoRequest *req = qobject_cast<DownloadRepoRequest *>(sender());
+    download_info_reqs_.remove(req->account().key() + "\t" + req->repo().id);
+    req->deleteLater();
 }
 
 void RepoTreeView::hideEvent(QHideEvent *event)
@@ -3,20 +3,32 @@
 
 #include <vector>
 #include <QTreeView>
+#include <QHash>
+#include <QPersistentModelIndex>
+#include <QStringList>
 
 class QAction;
 class QContextMenuEvent;
 class QEvent;
 class QShowEvent;
 class QHideEvent;
+class QDragEnterEvent;
+class QDragMoveEvent;
+class QDropEvent;
 class QModelIndex;
-class QStandardItem;
+class QTimer;
+class QMimeData;
 
+struct Account;
 class RepoItem;
 class RepoCategoryItem;
+class RepoTreeModel;
+class RepoFilterProxyModel;
 class CloudView;
 
 class CloneTasksDialog;
+class DownloadRepoRequest;
+class RepoDownloadInfo;
 
 class RepoTreeView : public QTreeView {
     Q_OBJECT
@@ -25,17 +37,40 @@ public:
 
     std::vector<QAction*> getToolBarActions();
 
+    /**
+     * The view always shows its RepoTreeModel through a filter proxy, so
+     * indexes of the view and of the model differ
+     */
+    void setTreeModel(RepoTreeModel *model);
+    RepoTreeModel *treeModel() const;
+    QModelIndex viewIndex(const QModelIndex& source_index) const;
+
+    bool isFiltering() const;
+
+    // Indexes of RepoTreeModel of the repo rows shown in the viewport,
+    // from top to bottom
+    QModelIndexList visibleRepoIndexes() const;
+
+public slots:
+    // Only show the repos matching the text, see RepoFilterProxyModel
+    void setFilterText(const QString& text);
+
 protected:
     void contextMenuEvent(QContextMenuEvent *event);
     bool viewportEvent(QEvent *event);
     void showEvent(QShowEvent *event);
     void hideEvent(QHideEvent *event);
+    void dragEnterEvent(QDragEnterEvent *event);
+    void dragMoveEvent(QDragMoveEvent *event);
+    void dropEvent(QDropEvent *event);
     void selectionChanged(const QItemSelection &selected,
                           const QItemSelection &deselected);
 
 private slots:
     void downloadRepo();
+    void downloadSelectedRepos();
     void showRepoDetail();
+    void browseRepo();
     void openLocalFolder();
     void viewRepoOnWeb();
     void onItemClicked(const QModelIndex& index);
@@ -44,9 +79,26 @@ private slots:
     void unsyncRepo();
     void syncRepoImmediately();
     void cancelDownload();
+    void onItemEntered(const QModelIndex& index);
+    void prefetchHoveredRepo();
+    void onDownloadInfoPrefetched(const RepoDownloadInfo& info);
+    void onDownloadInfoPrefetchFailed();
+    void scheduleVisibleRefresh();
+    void refreshVisibleRepos();
 
 private:
-    QStandardItem* getRepoItem(const QModelIndex &index) const;
+    // NULL if the index is not of a repo, or of a category
+    RepoItem* repoItemAt(const QModelIndex &index) const;
+    RepoCategoryItem* categoryItemAt(const QModelIndex &index) const;
+    RepoItem* selectedRepoItem() const;
+    std::vector<RepoItem*> selectedRepoItems() const;
+    Account accountOfItem(const RepoItem *item) const;
+
+    void prefetchDownloadInfo(const RepoItem *item);
+
+    // The library files dropped at pos would be uploaded to, if any
+    RepoItem *uploadTargetAt(const QPoint& pos) const;
+    QStringList droppedFiles(const QMimeData *mime_data) const;
 
     void createActions();
     QMenu *prepareContextMenu(const RepoItem *item);
@@ -61,15 +113,28 @@ private:
                                      const QRect& rect);
 
     QAction *download_action_;
+    QAction *bulk_download_action_;
     QAction *show_detail_action_;
     QAction *open_local_folder_action_;
     QAction *unsync_action_;
     QAction *view_on_web_action_;
+    QAction *browse_action_;
     QAction *toggle_auto_sync_action_;
     QAction *sync_now_action_;
     QAction *cancel_download_action_;
 
     CloudView *cloud_view_;
+
+    // Download info of the libraries the user hovers or selects is fetched
+    // ahead, so starting a download or sync needs no round trip
+    QTimer *hover_timer_;
+    QPersistentModelIndex hovered_index_;
+    QHash<QString, DownloadRepoRequest*> download_info_reqs_;
+
+    // Rows scrolled or expanded into view are refreshed once it settles
+    QTimer *visible_refresh_timer_;
+
+    RepoFilterProxyModel *filter_model_;
 };
 
 #endif // SEAFILE_CLIENT_REPO_TREE_VIEW_H
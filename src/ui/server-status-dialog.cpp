@@ -9,6 +9,8 @@ extern "C" {
 #include "QtAwesome.h"
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
+#include "api/circuit-breaker.h"
+#include "api-diagnostics-dialog.h"
 #include "server-status-dialog.h"
 
 
@@ -24,6 +26,9 @@ ServerStatusDialog::ServerStatusDialog(QWidget *parent) : QDialog(parent)
 
     setWindowTitle(tr("Servers connection status"));
 
+    mDetailsBtn->setToolTip(tr("Show the timings and traffic of the web api"));
+    connect(mDetailsBtn, SIGNAL(clicked()), this, SLOT(showApiDiagnostics()));
+
     refresh_timer_ = new QTimer(this);
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshStatus()));
 
@@ -41,6 +46,8 @@ void ServerStatusDialog::refreshStatus()
 
     mList->clear();
 
+    refreshApiServersStatus();
+
     if (!servers) {
         return;
     }
@@ -69,4 +76,43 @@ void ServerStatusDialog::refreshStatus()
     g_list_free (servers);
 }
 
+/**
+ * Show the circuit breaker state of the seahub web api servers
+ */
+void ServerStatusDialog::refreshApiServersStatus()
+{
+    ApiCircuitBreaker *breaker = ApiCircuitBreaker::instance();
+    QStringList servers = breaker->servers();
+    for (int i = 0, n = servers.size(); i < n; i++) {
+        const QString& server = servers[i];
+
+        QListWidgetItem *item = new QListWidgetItem(mList);
+        item->setData(Qt::DisplayRole, tr("%1 (web api)").arg(server));
 
+        switch (breaker->state(server)) {
+        case ApiCircuitBreaker::STATE_CLOSED:
+            item->setData(Qt::DecorationRole, awesome->icon(icon_ok, QColor("green")));
+            item->setData(Qt::ToolTipRole, tr("reachable"));
+            break;
+        case ApiCircuitBreaker::STATE_OPEN:
+            item->setData(Qt::DecorationRole, awesome->icon(icon_remove, QColor("red")));
+            item->setData(Qt::ToolTipRole,
+                          tr("unreachable after %1 failed requests, retry in %2 seconds")
+                          .arg(breaker->consecutiveFailures(server))
+                          .arg(breaker->secondsToRetry(server)));
+            break;
+        case ApiCircuitBreaker::STATE_HALF_OPEN:
+            item->setData(Qt::DecorationRole, awesome->icon(icon_refresh, QColor("orange")));
+            item->setData(Qt::ToolTipRole, tr("checking if the server is reachable again"));
+            break;
+        }
+
+        mList->addItem(item);
+    }
+}
+
+void ServerStatusDialog::showApiDiagnostics()
+{
+    ApiDiagnosticsDialog dialog(this);
+    dialog.exec();
+}
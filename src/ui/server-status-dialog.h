@@ -15,10 +15,13 @@ public:
 
 private slots:
     void refreshStatus();
+    void showApiDiagnostics();
 
 private:
     Q_DISABLE_COPY(ServerStatusDialog)
 
+    void refreshApiServersStatus();
+
     QTimer *refresh_timer_;
 };
 
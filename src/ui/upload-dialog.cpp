@@ -0,0 +1,247 @@
+#include <QtGui>
+#include <QTimer>
+#include <QFileInfo>
+
+#include "utils/utils.h"
+#include "seafile-applet.h"
+#include "api/file-uploader.h"
+#include "upload-dialog.h"
+
+namespace {
+
+const int kRefreshRateInterval = 1000; // 1 sec
+const int kDefaultParallelChunks = 1;
+const int kMaxParallelChunks = 4;
+
+const char *kSettingsGroup = "Upload";
+const char *kParallelChunksKey = "parallel_chunks";
+
+// Files are uploaded to the top folder of the library
+const char *kParentDir = "/";
+
+enum {
+    COLUMN_NAME = 0,
+    COLUMN_SIZE,
+    COLUMN_STATUS,
+    MAX_COLUMN
+};
+
+} // namespace
+
+UploadDialog::UploadDialog(const Account& account,
+                           const ServerRepo& repo,
+                           const QStringList& paths,
+                           QWidget *parent)
+    : QDialog(parent),
+      account_(account),
+      repo_(repo),
+      paths_(paths),
+      current_(-1),
+      uploader_(NULL),
+      failed_(0)
+{
+    setWindowTitle(tr("Upload to \"%1\"").arg(repo.name));
+    setWindowIcon(QIcon(":/images/seafile.png"));
+    setMinimumSize(QSize(500, 300));
+
+    createLayout();
+    readSettings();
+
+    rate_timer_ = new QTimer(this);
+    connect(rate_timer_, SIGNAL(timeout()), this, SLOT(updateRate()));
+}
+
+void UploadDialog::createLayout()
+{
+    parallel_spin_ = new QSpinBox;
+    parallel_spin_->setRange(1, kMaxParallelChunks);
+    parallel_spin_->setToolTip(tr("How many parts of a file are sent at the same time"));
+
+    QHBoxLayout *parallel_layout = new QHBoxLayout;
+    parallel_layout->addWidget(new QLabel(tr("Parallel uploads:")));
+    parallel_layout->addWidget(parallel_spin_);
+    parallel_layout->addStretch();
+
+    table_ = new QTableWidget(paths_.size(), MAX_COLUMN);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setSelectionMode(QAbstractItemView::NoSelection);
+    table_->verticalHeader()->hide();
+    table_->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft);
+    table_->horizontalHeader()->setStretchLastSection(true);
+
+    QStringList headers;
+    headers << tr("File") << tr("Size") << tr("Status");
+    table_->setHorizontalHeaderLabels(headers);
+
+    for (int row = 0, n = paths_.size(); row < n; row++) {
+        QFileInfo info(paths_[row]);
+        table_->setItem(row, COLUMN_NAME, new QTableWidgetItem(info.fileName()));
+        table_->setItem(row, COLUMN_SIZE, new QTableWidgetItem(readableFileSize(info.size())));
+        table_->setItem(row, COLUMN_STATUS, new QTableWidgetItem(tr("Waiting")));
+    }
+
+    progress_bar_ = new QProgressBar;
+    progress_bar_->setRange(0, 100);
+    progress_bar_->setValue(0);
+    rate_label_ = new QLabel;
+
+    start_btn_ = new QPushButton(tr("Upload"));
+    start_btn_->setDefault(true);
+    connect(start_btn_, SIGNAL(clicked()), this, SLOT(start()));
+
+    retry_btn_ = new QPushButton(tr("Resume"));
+    retry_btn_->setVisible(false);
+    connect(retry_btn_, SIGNAL(clicked()), this, SLOT(retry()));
+
+    skip_btn_ = new QPushButton(tr("Skip"));
+    skip_btn_->setVisible(false);
+    connect(skip_btn_, SIGNAL(clicked()), this, SLOT(skip()));
+
+    close_btn_ = new QPushButton(tr("Close"));
+    connect(close_btn_, SIGNAL(clicked()), this, SLOT(reject()));
+
+    QHBoxLayout *btn_layout = new QHBoxLayout;
+    btn_layout->addWidget(rate_label_);
+    btn_layout->addStretch();
+    btn_layout->addWidget(start_btn_);
+    btn_layout->addWidget(retry_btn_);
+    btn_layout->addWidget(skip_btn_);
+    btn_layout->addWidget(close_btn_);
+
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->addLayout(parallel_layout);
+    vlayout->addWidget(table_);
+    vlayout->addWidget(progress_bar_);
+    vlayout->addLayout(btn_layout);
+    setLayout(vlayout);
+}
+
+void UploadDialog::readSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup(kSettingsGroup);
+    parallel_spin_->setValue(settings.value(kParallelChunksKey, kDefaultParallelChunks).toInt());
+    settings.endGroup();
+}
+
+void UploadDialog::writeSettings()
+{
+    QSettings settings;
+
+    settings.beginGroup(kSettingsGroup);
+    settings.setValue(kParallelChunksKey, parallel_spin_->value());
+    settings.endGroup();
+}
+
+void UploadDialog::start()
+{
+    writeSettings();
+
+    start_btn_->setEnabled(false);
+    parallel_spin_->setEnabled(false);
+    rate_timer_->start(kRefreshRateInterval);
+
+    startNext();
+}
+
+void UploadDialog::startNext()
+{
+    if (uploader_) {
+        uploader_->deleteLater();
+        uploader_ = NULL;
+    }
+
+    current_++;
+    if (current_ >= paths_.size()) {
+        rate_timer_->stop();
+        rate_label_->setText(failed_ > 0 ? tr("%n files failed", "", failed_) : tr("Done"));
+        close_btn_->setFocus();
+        return;
+    }
+
+    uploader_ = new FileUploader(account_, repo_.id, kParentDir, paths_[current_], this);
+    uploader_->setParallelChunks(parallel_spin_->value());
+    connect(uploader_, SIGNAL(progress(qint64, qint64)),
+            this, SLOT(onProgress(qint64, qint64)));
+    connect(uploader_, SIGNAL(finished()), this, SLOT(onFinished()));
+    connect(uploader_, SIGNAL(failed(const QString&)), this, SLOT(onFailed(const QString&)));
+
+    setStatus(current_, tr("Uploading"));
+    progress_bar_->setValue(0);
+    uploader_->start();
+}
+
+void UploadDialog::retry()
+{
+    retry_btn_->setVisible(false);
+    skip_btn_->setVisible(false);
+    failed_--;
+    setStatus(current_, tr("Resuming"));
+    rate_timer_->start(kRefreshRateInterval);
+    uploader_->start();
+}
+
+void UploadDialog::skip()
+{
+    retry_btn_->setVisible(false);
+    skip_btn_->setVisible(false);
+    rate_timer_->start(kRefreshRateInterval);
+    startNext();
+}
+
+void UploadDialog::onProgress(qint64 uploaded, qint64 total)
+{
+    int percent = total > 0 ? uploaded * 100 / total : 100;
+    progress_bar_->setValue(percent);
+    setStatus(current_, tr("Uploading %1%").arg(percent));
+}
+
+void UploadDialog::onFinished()
+{
+    setStatus(current_, tr("Done"));
+    startNext();
+}
+
+void UploadDialog::onFailed(const QString& error)
+{
+    failed_++;
+    setStatus(current_, error);
+    rate_timer_->stop();
+    rate_label_->setText("");
+
+    // The user may resume it, go on with the next files, or close the dialog
+    retry_btn_->setVisible(true);
+    skip_btn_->setVisible(current_ + 1 < paths_.size());
+    retry_btn_->setFocus();
+}
+
+void UploadDialog::updateRate()
+{
+    if (uploader_ && uploader_->isRunning()) {
+        rate_label_->setText(tr("%1/s").arg(readableFileSize(uploader_->rate())));
+    }
+}
+
+void UploadDialog::setStatus(int row, const QString& status)
+{
+    table_->item(row, COLUMN_STATUS)->setText(status);
+}
+
+void UploadDialog::reject()
+{
+    if (uploader_ && uploader_->isRunning()) {
+        QString question = tr("Stop uploading?<br>"
+                              "An unfinished file can be resumed by dropping it again.");
+        if (QMessageBox::question(this,
+                                  tr(SEAFILE_CLIENT_BRAND),
+                                  question,
+                                  QMessageBox::Ok | QMessageBox::Cancel,
+                                  QMessageBox::Cancel) != QMessageBox::Ok) {
+            return;
+        }
+        uploader_->cancel();
+    }
+
+    QDialog::reject();
+}
@@ -0,0 +1,72 @@
+#ifndef SEAFILE_CLIENT_UPLOAD_DIALOG_H
+#define SEAFILE_CLIENT_UPLOAD_DIALOG_H
+
+#include <QDialog>
+#include <QStringList>
+
+#include "account.h"
+#include "api/server-repo.h"
+
+class QTimer;
+class QSpinBox;
+class QTableWidget;
+class QProgressBar;
+class QLabel;
+class QPushButton;
+class FileUploader;
+
+/**
+ * Upload files dropped on a library, one after another, see FileUploader
+ */
+class UploadDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    UploadDialog(const Account& account,
+                 const ServerRepo& repo,
+                 const QStringList& paths,
+                 QWidget *parent=0);
+
+public slots:
+    void reject();
+
+private slots:
+    void start();
+    void retry();
+    void skip();
+    void onProgress(qint64 uploaded, qint64 total);
+    void onFinished();
+    void onFailed(const QString& error);
+    void updateRate();
+
+private:
+    Q_DISABLE_COPY(UploadDialog)
+
+    void createLayout();
+    void startNext();
+    void setStatus(int row, const QString& status);
+    void readSettings();
+    void writeSettings();
+
+    Account account_;
+    ServerRepo repo_;
+    QStringList paths_;
+
+    // The file being uploaded
+    int current_;
+    FileUploader *uploader_;
+    int failed_;
+
+    QTimer *rate_timer_;
+
+    QSpinBox *parallel_spin_;
+    QTableWidget *table_;
+    QProgressBar *progress_bar_;
+    QLabel *rate_label_;
+    QPushButton *start_btn_;
+    QPushButton *retry_btn_;
+    QPushButton *skip_btn_;
+    QPushButton *close_btn_;
+};
+
+#endif // SEAFILE_CLIENT_UPLOAD_DIALOG_H
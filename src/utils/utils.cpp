@@ -270,6 +270,18 @@ bool parse_key_value_pairs (char *string, KeyValueFunc func, void *data)
     return true;
 }
 
+QString readableFileSize(qint64 size)
+{
+    if (size < 1024) {
+        return QString("%1 B").arg(size);
+    } else if (size < 1024 * 1024) {
+        return QString("%1 KB").arg(size / 1024);
+    } else if (size < 1024 * 1024 * 1024) {
+        return QString("%1 MB").arg(size / 1024 / 1024);
+    }
+    return QString("%1 GB").arg(size / 1024 / 1024 / 1024);
+}
+
 QMap<QString, QVariant> mapFromJSON(json_t *json, json_error_t *error)
 {
     QMap<QString, QVariant> dict;
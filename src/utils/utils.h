@@ -39,6 +39,9 @@ bool parse_key_value_pairs (char *string, KeyValueFunc func, void *data);
 
 QString translateCommitTime(qint64 timestamp);
 
+// e.g. "12 KB", "3 MB"
+QString readableFileSize(qint64 size);
+
 QMap<QString, QVariant> mapFromJSON(json_t *json, json_error_t *error);
 
 #endif